@@ -0,0 +1,45 @@
+// Compile-time benchmark: single subgroup GEMM with large 32x64 C blocks.
+// Blocking and linearization of the 32x64 vectors dominate compile time.
+module @gemm attributes {gpu.container_module} {
+  func.func @test(%A: memref<4096x4096xf16>, %B: memref<4096x4096xf16>, %C: memref<4096x4096xf16>) attributes {llvm.emit_c_interface} {
+    %c1 = arith.constant 1 : index
+    %c64 = arith.constant 64 : index
+    %c128 = arith.constant 128 : index
+    gpu.launch_func  @test_kernel::@test_kernel blocks in (%c128, %c64, %c1) threads in (%c1, %c1, %c1) args(%A : memref<4096x4096xf16>, %B : memref<4096x4096xf16>, %C : memref<4096x4096xf16>)
+    return
+  }
+  gpu.module @test_kernel attributes {spirv.target_env = #spirv.target_env<#spirv.vce<v1.4, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR, SubgroupDispatch, VectorComputeINTEL, VectorAnyINTEL], [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume, SPV_INTEL_vector_compute]>, api=OpenCL, #spirv.resource_limits<>>} {
+    gpu.func @test_kernel(%A: memref<4096x4096xf16>, %B: memref<4096x4096xf16>, %C: memref<4096x4096xf16>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %c32 = arith.constant 32 : index
+      %c64 = arith.constant 64 : index
+      %c4096 = arith.constant 4096 : index
+      %block_id_x = gpu.block_id x
+      %block_id_y = gpu.block_id y
+      %m = arith.muli %block_id_x, %c32 : index
+      %n = arith.muli %block_id_y, %c64 : index
+      %c_init_value = arith.constant dense<0.0> : vector<32x64xf32>
+      %a_init_tile = xetile.init_tile %A[%m, %c0] : memref<4096x4096xf16> -> !xetile.tile<32x32xf16>
+      %b_init_tile = xetile.init_tile %B[%c0, %n] : memref<4096x4096xf16> -> !xetile.tile<32x64xf16>
+      %out:3 = scf.for %k = %c0 to %c4096 step %c32
+        iter_args(%a_tile = %a_init_tile, %b_tile = %b_init_tile, %c_value = %c_init_value)
+        -> (!xetile.tile<32x32xf16>, !xetile.tile<32x64xf16>, vector<32x64xf32>) {
+        %a_value = xetile.load_tile %a_tile  : !xetile.tile<32x32xf16> -> vector<32x32xf16>
+        %b_value = xetile.load_tile %b_tile  : !xetile.tile<32x64xf16> -> vector<32x64xf16>
+        %c_new_value = xetile.tile_mma %a_value, %b_value, %c_value
+          : vector<32x32xf16>, vector<32x64xf16>, vector<32x64xf32> -> vector<32x64xf32>
+        %a_next_tile = xetile.update_tile_offset %a_tile, [%c0, %c32]
+          : !xetile.tile<32x32xf16>, index, index -> !xetile.tile<32x32xf16>
+        %b_next_tile = xetile.update_tile_offset %b_tile, [%c32, %c0]
+          : !xetile.tile<32x64xf16>, index, index -> !xetile.tile<32x64xf16>
+        scf.yield %a_next_tile, %b_next_tile, %c_new_value
+          : !xetile.tile<32x32xf16>, !xetile.tile<32x64xf16>, vector<32x64xf32>
+      }
+      %relu = arith.maximumf %out#2, %c_init_value : vector<32x64xf32>
+      %value = arith.truncf %relu : vector<32x64xf32> to vector<32x64xf16>
+      %c_tile = xetile.init_tile %C[%m, %n] : memref<4096x4096xf16> -> !xetile.tile<32x64xf16>
+      xetile.store_tile %value, %c_tile: vector<32x64xf16>, !xetile.tile<32x64xf16>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,30 @@
+// Compile-time benchmark: 32x64 block softmax along dim-1.
+// Reduction and broadcast over large blocks generate many extract/insert ops.
+module @block_softmax attributes {gpu.container_module} {
+  func.func @test(%a: memref<4096x4096xf32>, %b: memref<4096x4096xf32>) attributes {llvm.emit_c_interface} {
+    %c1 = arith.constant 1 : index
+    %c64 = arith.constant 64 : index
+    %c128 = arith.constant 128 : index
+    gpu.launch_func @kernel::@block_softmax_dim_1 blocks in (%c128, %c64, %c1) threads in (%c1, %c1, %c1) args(%a : memref<4096x4096xf32>, %b : memref<4096x4096xf32>)
+    return
+  }
+  gpu.module @kernel attributes {spirv.target_env = #spirv.target_env<#spirv.vce<v1.4, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR, SubgroupDispatch, VectorComputeINTEL, VectorAnyINTEL], [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume, SPV_INTEL_vector_compute]>, api=OpenCL, #spirv.resource_limits<>>} {
+    gpu.func @block_softmax_dim_1(%a: memref<4096x4096xf32>, %b: memref<4096x4096xf32>) kernel attributes {VectorComputeFunctionINTEL, spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c32 = arith.constant 32 : index
+      %c64 = arith.constant 64 : index
+      %block_id_x = gpu.block_id x
+      %block_id_y = gpu.block_id y
+      %m = arith.muli %block_id_x, %c32 : index
+      %n = arith.muli %block_id_y, %c64 : index
+      %1 = xetile.init_tile %a[%m, %n] : memref<4096x4096xf32> -> !xetile.tile<32x64xf32>
+      %2 = xetile.load_tile %1: !xetile.tile<32x64xf32> -> vector<32x64xf32>
+      %3 = math.exp %2: vector<32x64xf32>
+      %4 = xetile.reduce <add>, %3 [1]: vector<32x64xf32> -> vector<32x1xf32>
+      %5 = xetile.broadcast %4 [1]: vector<32x1xf32> -> vector<32x64xf32>
+      %6 = arith.divf %3, %5: vector<32x64xf32>
+      %7 = xetile.init_tile %b[%m, %n] : memref<4096x4096xf32> -> !xetile.tile<32x64xf32>
+      xetile.store_tile %6, %7: vector<32x64xf32>, !xetile.tile<32x64xf32>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,38 @@
+// linalg dialect to multithreaded cpu lowering pipeline
+// Parallel linalg iterators become scf.parallel loops, which are split into
+// async tasks run by the thread pool of the MLIR async runtime, one worker per
+// hardware thread. Reduction iterators stay sequential inside each task.
+builtin.module(convert-tensor-to-linalg
+    arith-bufferize
+    func.func(empty-tensor-to-alloc-tensor
+          // eliminate-empty-tensors
+          scf-bufferize
+          shape-bufferize
+          linalg-bufferize
+          bufferization-bufferize
+          tensor-bufferize)
+    func-bufferize
+    func.func(finalizing-bufferize
+          convert-linalg-to-parallel-loops
+          scf-parallel-loop-fusion)
+    async-parallel-for{async-dispatch=true num-workers=-1}
+    async-to-async-runtime
+    async-runtime-ref-counting
+    async-runtime-ref-counting-opt
+    arith-expand
+    convert-async-to-llvm
+    convert-scf-to-cf
+    convert-linalg-to-llvm
+    convert-cf-to-llvm
+    convert-arith-to-llvm
+    convert-math-to-llvm
+    convert-math-to-libm
+    convert-complex-to-llvm
+    convert-index-to-llvm
+    expand-strided-metadata
+    lower-affine
+    finalize-memref-to-llvm
+    lower-affine
+    convert-func-to-llvm
+    reconcile-unrealized-casts)
+// End
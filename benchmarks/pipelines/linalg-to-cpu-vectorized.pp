@@ -0,0 +1,41 @@
+// linalg dialect to vectorized multithreaded cpu lowering pipeline
+// Linalg ops are tiled and vectorized to the SIMD width of the host, the tile
+// loops are split into async tasks as in linalg-to-cpu-parallel.pp. Ops which
+// cannot be vectorized, e.g. with dynamic shapes, lower to parallel loops.
+builtin.module(convert-tensor-to-linalg
+    arith-bufferize
+    func.func(empty-tensor-to-alloc-tensor
+          // eliminate-empty-tensors
+          scf-bufferize
+          shape-bufferize
+          linalg-bufferize
+          bufferization-bufferize
+          tensor-bufferize)
+    func-bufferize
+    func.func(finalizing-bufferize
+          imex-tile-and-vectorize-linalg{parallel-loops=true}
+          convert-linalg-to-parallel-loops
+          canonicalize)
+    async-parallel-for{async-dispatch=true num-workers=-1}
+    async-to-async-runtime
+    async-runtime-ref-counting
+    async-runtime-ref-counting-opt
+    arith-expand
+    convert-async-to-llvm
+    convert-vector-to-scf{full-unroll=true}
+    convert-scf-to-cf
+    convert-linalg-to-llvm
+    convert-vector-to-llvm{reassociate-fp-reductions=true}
+    convert-cf-to-llvm
+    convert-arith-to-llvm
+    convert-math-to-llvm
+    convert-math-to-libm
+    convert-complex-to-llvm
+    convert-index-to-llvm
+    expand-strided-metadata
+    lower-affine
+    finalize-memref-to-llvm
+    lower-affine
+    convert-func-to-llvm
+    reconcile-unrealized-casts)
+// End
@@ -1,6 +1,7 @@
 // linalg dialect to gpu dialect lowering pipeline
 // Ready for vulkan runner or narrow scope l0/sycl runner starting from GPU dialect.
 builtin.module(convert-tensor-to-linalg
+    imex-linalg-elementwise-fusion
     arith-bufferize
     func.func(empty-tensor-to-alloc-tensor
           // eliminate-empty-tensors
@@ -12,17 +13,21 @@ builtin.module(convert-tensor-to-linalg
     func-bufferize
     func.func(finalizing-bufferize
           convert-linalg-to-parallel-loops
+          imex-parallelize-reductions
           imex-add-outer-parallel-loop
+          imex-tile-parallel-loops
           gpu-map-parallel-loops
           convert-parallel-loops-to-gpu)
 // insert-gpu-allocs pass can have client-api = opencl or vulkan args
-    func.func(insert-gpu-allocs{client-api=opencl})
+    func.func(insert-gpu-allocs{client-api=opencl device-local-outputs=true})
     canonicalize
     normalize-memrefs
 // Unstride memrefs does not seem to be needed.
 //  func.func(unstride-memrefs)
     func.func(lower-affine)
     gpu-kernel-outlining
+// Launches and transfers return tokens, the host only waits where needed.
+    func.func(gpu-async-region)
     canonicalize
     cse
 // The following set-spirv-* passes can have client-api = opencl or vulkan args
@@ -0,0 +1,36 @@
+// XeTile dialect to llvm lowering pipeline used for compile-time benchmarks
+builtin.module(
+    cse
+    gpu.module(xetile-init-duplicate
+        xetile-optimize-transpose
+        xetile-blocking
+        convert-xetile-to-xegpu
+        imex-propagate-packed-layout)
+    cse
+    imex-vector-linearize{contiguous-slices=true}
+    gpu.module(convert-xegpu-to-vc)
+    reconcile-unrealized-casts
+    bf16-to-gpu
+    gpu.module(convert-func-to-spirv)
+    gpu.module(convert-vector-to-spirv)
+    imex-convert-gpu-to-spirv
+    spirv.module(spirv-lower-abi-attrs
+             spirv-update-vce)
+    func.func(llvm-request-c-wrappers)
+    serialize-spirv
+    convert-vector-to-scf
+    convert-gpu-to-gpux
+    convert-scf-to-cf
+    convert-cf-to-llvm
+    convert-vector-to-llvm
+    convert-index-to-llvm
+    convert-arith-to-llvm
+    convert-func-to-llvm
+    convert-math-to-llvm
+    convert-gpux-to-llvm
+    convert-index-to-llvm
+    expand-strided-metadata
+    lower-affine
+    finalize-memref-to-llvm
+    reconcile-unrealized-casts)
+// End
@@ -0,0 +1,239 @@
+//===- CachingAllocator.h - Size class caching allocator --------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines a caching allocator used by the GPU runtime wrappers.
+/// Freed blocks are kept in per size class free lists and handed out again
+/// instead of going to the driver. A freed block is tagged with a fence, the
+/// sequence number of the last command submitted to the stream when it was
+/// freed, and is only reused once the stream reports that fence complete.
+/// Memory is only given back to the backend once its fence has completed.
+/// Blocks that stay cached without being reused for a whole trim interval,
+/// e.g. those of a one-off peak, are released again, while the blocks of a
+/// steady state loop are kept however their sizes alternate.
+///
+/// The backend provides the actual memory:
+///   void *allocate(size_t size, size_t alignment, bool shared);
+///   void deallocate(void *ptr);
+///
+/// Environment variables:
+///   IMEX_DISABLE_MEMORY_POOL - forward every request to the backend
+///   IMEX_MEMORY_POOL_STATS   - print the pool statistics on destruction
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_CACHINGALLOCATOR_H
+#define IMEX_EXECUTIONENGINE_CACHINGALLOCATOR_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace imex {
+
+/// Plain host memory, used to exercise the pooling logic without a device.
+struct HostMemoryBackend {
+  void *allocate(size_t size, size_t alignment, bool /*shared*/) {
+    // aligned_alloc requires the size to be a multiple of the alignment.
+    size = (size + alignment - 1) / alignment * alignment;
+    return std::aligned_alloc(alignment, size);
+  }
+  void deallocate(void *ptr) { std::free(ptr); }
+};
+
+struct CachingAllocatorStats {
+  uint64_t backendAllocs = 0;
+  uint64_t backendFrees = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  size_t liveBytes = 0;
+  size_t cachedBytes = 0;
+  size_t peakLiveBytes = 0;
+};
+
+template <typename Backend> class CachingAllocator {
+public:
+  explicit CachingAllocator(Backend backend = Backend())
+      : backend(std::move(backend)),
+        enabled(!std::getenv("IMEX_DISABLE_MEMORY_POOL")) {}
+
+  CachingAllocator(const CachingAllocator &) = delete;
+  CachingAllocator &operator=(const CachingAllocator &) = delete;
+
+  ~CachingAllocator() {
+    releaseCached();
+    if (std::getenv("IMEX_MEMORY_POOL_STATS"))
+      fprintf(stdout,
+              "memory pool: %llu hits, %llu misses, %llu driver allocs, "
+              "%llu driver frees, peak live %zu bytes\n",
+              (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+              (unsigned long long)stats.backendAllocs,
+              (unsigned long long)stats.backendFrees, stats.peakLiveBytes);
+  }
+
+  /// The number of trim calls after which blocks that have not been reused
+  /// are released.
+  static constexpr unsigned kTrimInterval = 64;
+
+  /// Returns a block of at least `size` bytes. Cached blocks whose fence is
+  /// not complete yet, according to `isComplete(fence)`, are skipped.
+  template <typename IsComplete>
+  void *allocate(size_t size, size_t alignment, bool shared,
+                 IsComplete &&isComplete) {
+    if (!enabled) {
+      ++stats.backendAllocs;
+      return backend.allocate(size, alignment, shared);
+    }
+
+    size_t blockSize = getSizeClass(size);
+    Key key{shared, alignment, blockSize};
+    auto &freeList = freeLists[key];
+    for (auto it = freeList.begin(); it != freeList.end(); ++it) {
+      if (!isComplete(it->fence))
+        continue;
+      void *ptr = it->ptr;
+      freeList.erase(it);
+      ++stats.hits;
+      stats.cachedBytes -= blockSize;
+      return track(ptr, key);
+    }
+
+    ++stats.misses;
+    void *ptr = backend.allocate(blockSize, alignment, shared);
+    if (!ptr) {
+      // Give the cached memory that is no longer in use back to the driver
+      // and try again.
+      releaseCached(isComplete);
+      ptr = backend.allocate(blockSize, alignment, shared);
+    }
+    if (!ptr)
+      return nullptr;
+    ++stats.backendAllocs;
+    return track(ptr, key);
+  }
+
+  /// Returns a block to the cache. It may be reused once `fence` completes.
+  /// Blocks that are not cached are given back to the backend after
+  /// `waitFor(fence)` has blocked until the fence completed.
+  template <typename WaitFor>
+  void deallocate(void *ptr, uint64_t fence, WaitFor &&waitFor) {
+    if (!ptr)
+      return;
+    auto it = liveBlocks.find(ptr);
+    if (it == liveBlocks.end()) {
+      // Not allocated by the pool, or the pool is disabled.
+      waitFor(fence);
+      ++stats.backendFrees;
+      return backend.deallocate(ptr);
+    }
+    Key key = it->second;
+    liveBlocks.erase(it);
+    stats.liveBytes -= key.size;
+    stats.cachedBytes += key.size;
+    freeLists[key].push_back({ptr, fence, epoch});
+  }
+
+  /// Counts a point where the stream is idle, e.g. a wait for all commands.
+  /// Every kTrimInterval calls, releases the complete blocks that were freed
+  /// before the previous interval and not reused since.
+  template <typename IsComplete> void trim(IsComplete &&isComplete) {
+    if (++trimCalls < kTrimInterval)
+      return;
+    trimCalls = 0;
+    release([&](const FreeBlock &block) {
+      return block.epoch < epoch && isComplete(block.fence);
+    });
+    ++epoch;
+  }
+
+  /// Releases the cached blocks whose fence is complete.
+  template <typename IsComplete> void releaseCached(IsComplete &&isComplete) {
+    release([&](const FreeBlock &block) { return isComplete(block.fence); });
+  }
+
+  /// Releases all cached blocks. Must be called when all fences are complete,
+  /// e.g. when the stream is destroyed.
+  void releaseCached() {
+    release([](const FreeBlock &) { return true; });
+  }
+
+  const CachingAllocatorStats &getStats() const { return stats; }
+  Backend &getBackend() { return backend; }
+
+private:
+  struct Key {
+    bool shared;
+    size_t alignment;
+    size_t size;
+    bool operator<(const Key &rhs) const {
+      return std::tie(shared, alignment, size) <
+             std::tie(rhs.shared, rhs.alignment, rhs.size);
+    }
+  };
+  struct FreeBlock {
+    void *ptr;
+    uint64_t fence;
+    // The trim interval the block was freed in.
+    uint64_t epoch;
+  };
+
+  // Gives the cached blocks selected by `shouldRelease` back to the backend.
+  template <typename ShouldRelease>
+  void release(ShouldRelease &&shouldRelease) {
+    for (auto &it : freeLists) {
+      auto &freeList = it.second;
+      auto kept = freeList.begin();
+      for (auto &block : freeList) {
+        if (!shouldRelease(block)) {
+          *kept++ = block;
+          continue;
+        }
+        backend.deallocate(block.ptr);
+        ++stats.backendFrees;
+        stats.cachedBytes -= it.first.size;
+      }
+      freeList.erase(kept, freeList.end());
+    }
+  }
+
+  // Sizes are rounded up to a multiple of 512 bytes, or of the largest power
+  // of two not above an eighth of the size, which bounds the waste to 12.5%.
+  static size_t getSizeClass(size_t size) {
+    size_t granule = 512;
+    while (granule * 8 <= size)
+      granule *= 2;
+    size = size ? size : 1;
+    return (size + granule - 1) / granule * granule;
+  }
+
+  void *track(void *ptr, const Key &key) {
+    liveBlocks.emplace(ptr, key);
+    stats.liveBytes += key.size;
+    if (stats.liveBytes > stats.peakLiveBytes)
+      stats.peakLiveBytes = stats.liveBytes;
+    return ptr;
+  }
+
+  Backend backend;
+  bool enabled;
+  std::map<Key, std::vector<FreeBlock>> freeLists;
+  std::unordered_map<void *, Key> liveBlocks;
+  uint64_t epoch = 0;
+  unsigned trimCalls = 0;
+  CachingAllocatorStats stats;
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_CACHINGALLOCATOR_H
@@ -72,6 +72,41 @@ _mlir_ciface_fillResource1DRandomF16(UnrankedMemRefType<f16> *ptr,
                                      const float lower, const float upper,
                                      const bool genInt);
 
+// Fill memrefs of any rank with reproducible random values, generated from
+// `seed` and the position of each element.
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_fillResourceRandomBF16(UnrankedMemRefType<bf16> *ptr,
+                                    const float lower, const float upper,
+                                    const bool genInt, const int64_t seed);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_fillResourceRandomF16(UnrankedMemRefType<f16> *ptr,
+                                   const float lower, const float upper,
+                                   const bool genInt, const int64_t seed);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_fillResourceRandomF32(UnrankedMemRefType<float> *ptr,
+                                   const float lower, const float upper,
+                                   const bool genInt, const int64_t seed);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_fillResourceRandomF64(UnrankedMemRefType<double> *ptr,
+                                   const float lower, const float upper,
+                                   const bool genInt, const int64_t seed);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_fillResourceRandomI8(UnrankedMemRefType<int8_t> *ptr,
+                                  const float lower, const float upper,
+                                  const bool genInt, const int64_t seed);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_fillResourceRandomI16(UnrankedMemRefType<int16_t> *ptr,
+                                   const float lower, const float upper,
+                                   const bool genInt, const int64_t seed);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_fillResourceRandomI32(UnrankedMemRefType<int32_t> *ptr,
+                                   const float lower, const float upper,
+                                   const bool genInt, const int64_t seed);
+extern "C" IMEX_RUNNERUTILS_EXPORT void
+_mlir_ciface_fillResourceRandomI64(UnrankedMemRefType<int64_t> *ptr,
+                                   const float lower, const float upper,
+                                   const bool genInt, const int64_t seed);
+
 extern "C" IMEX_RUNNERUTILS_EXPORT void
 _mlir_ciface_printMemrefBF16(UnrankedMemRefType<bf16> *m);
 extern "C" IMEX_RUNNERUTILS_EXPORT void
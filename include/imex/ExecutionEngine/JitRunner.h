@@ -0,0 +1,48 @@
+//===- JitRunner.h - IMEX CPU execution driver ------------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares the entry point of imex-cpu-runner. It follows the
+/// upstream mlir::JitRunnerMain and accepts the same flags, and can keep the
+/// compiled objects in an on-disk cache (--object-cache-dir or the
+/// IMEX_OBJECT_CACHE_DIR environment variable). --mlir-timing reports the
+/// time of each step, from parsing to execution.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_JITRUNNER_H
+#define IMEX_EXECUTIONENGINE_JITRUNNER_H
+
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Support/Timing.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+
+namespace mlir {
+class DialectRegistry;
+class Operation;
+} // namespace mlir
+
+namespace imex {
+
+struct JitRunnerConfig {
+  /// Transformation applied to the parsed module before it is translated to
+  /// LLVM IR, e.g. a pass pipeline. It is timed under `timing`.
+  llvm::function_ref<mlir::LogicalResult(mlir::Operation *module,
+                                         mlir::TimingScope &timing)>
+      mlirTransformer = nullptr;
+};
+
+/// Parses the input file, translates it to LLVM IR, JIT compiles it and runs
+/// the entry point. Returns the exit code of the process.
+int JitRunnerMain(int argc, char **argv, const mlir::DialectRegistry &registry,
+                  JitRunnerConfig config = {});
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_JITRUNNER_H
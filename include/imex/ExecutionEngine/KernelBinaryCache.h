@@ -0,0 +1,176 @@
+//===- KernelBinaryCache.h - On-disk native kernel cache --------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines a persistent cache for device binaries compiled from
+/// SPIR-V by the GPU runtime wrappers. Finalizing large kernels takes seconds;
+/// with the cache only the first process on a machine pays for it. Entries
+/// are content addressed: the key is derived from the SPIR-V, the build flags
+/// and a description of the device and driver, so changing any of them
+/// creates a new entry instead of invalidating the old one. Every entry starts
+/// with a header holding the size and the hash of the binary, a truncated or
+/// corrupt file is treated as a miss.
+///
+/// Environment variables:
+///   IMEX_KERNEL_CACHE_DIR     - cache directory, defaults to
+///                               $XDG_CACHE_HOME/imex/kernels or
+///                               $HOME/.cache/imex/kernels
+///   IMEX_DISABLE_KERNEL_CACHE - neither read nor write cached binaries
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_KERNELBINARYCACHE_H
+#define IMEX_EXECUTIONENGINE_KERNELBINARYCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace imex {
+
+class KernelBinaryCache {
+public:
+  KernelBinaryCache() {
+    if (std::getenv("IMEX_DISABLE_KERNEL_CACHE"))
+      return;
+    if (const char *dir = std::getenv("IMEX_KERNEL_CACHE_DIR"))
+      directory = dir;
+    else if (const char *xdg = std::getenv("XDG_CACHE_HOME"))
+      directory = std::filesystem::path(xdg) / "imex" / "kernels";
+    else if (const char *home = std::getenv("HOME"))
+      directory = std::filesystem::path(home) / ".cache" / "imex" / "kernels";
+  }
+
+  bool isEnabled() const { return !directory.empty(); }
+
+  /// Returns the key of the binary compiled from `spirv` with `buildFlags`
+  /// and the specialization constants `specConstants` for the device
+  /// described by `deviceId`.
+  static std::string getKey(const void *spirv, size_t spirvSize,
+                            const char *buildFlags, const std::string &deviceId,
+                            const std::string &specConstants = {}) {
+    auto *bytes = static_cast<const uint8_t *>(spirv);
+    uint64_t spirvHash = hash(bytes, spirvSize);
+    std::string config = deviceId + '\0' + (buildFlags ? buildFlags : "");
+    if (!specConstants.empty())
+      config += '\0' + specConstants;
+    uint64_t configHash =
+        hash(reinterpret_cast<const uint8_t *>(config.data()), config.size());
+    char key[3 * 16 + 3];
+    snprintf(key, sizeof(key), "%016llx-%016llx-%llx",
+             (unsigned long long)spirvHash, (unsigned long long)configHash,
+             (unsigned long long)spirvSize);
+    return key;
+  }
+
+  /// Reads the binary stored under `key`. Returns false on a miss, or if the
+  /// entry is truncated or corrupt.
+  bool load(const std::string &key, std::vector<uint8_t> &binary) const {
+    if (!isEnabled())
+      return false;
+    std::ifstream file(directory / (key + ".bin"), std::ios::binary);
+    if (!file)
+      return false;
+    std::vector<uint8_t> contents(std::istreambuf_iterator<char>(file),
+                                  (std::istreambuf_iterator<char>()));
+    if (file.bad() || contents.size() <= sizeof(Header))
+      return false;
+    Header header;
+    memcpy(&header, contents.data(), sizeof(Header));
+    const uint8_t *data = contents.data() + sizeof(Header);
+    size_t size = contents.size() - sizeof(Header);
+    if (memcmp(header.magic, kMagic, sizeof(header.magic)) ||
+        header.size != size || header.hash != hash(data, size))
+      return false;
+    binary.assign(data, data + size);
+    return true;
+  }
+
+  /// Stores `binary` under `key`. The file is written under a temporary name
+  /// and renamed, so concurrent processes never read a partial entry. Errors
+  /// are ignored, the cache is an optimization only.
+  void store(const std::string &key, const std::vector<uint8_t> &binary) const {
+    if (!isEnabled() || binary.empty())
+      return;
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+      return;
+    auto path = directory / (key + ".bin");
+    auto tmpPath = directory / (key + ".tmp" + std::to_string(getUniqueId()));
+    {
+      std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+      if (!file)
+        return;
+      Header header;
+      memcpy(header.magic, kMagic, sizeof(header.magic));
+      header.size = binary.size();
+      header.hash = hash(binary.data(), binary.size());
+      file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      file.write(reinterpret_cast<const char *>(binary.data()), binary.size());
+      if (!file) {
+        file.close();
+        std::filesystem::remove(tmpPath, ec);
+        return;
+      }
+    }
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec)
+      std::filesystem::remove(tmpPath, ec);
+  }
+
+  /// Removes the entry stored under `key`, e.g. if the driver rejected it.
+  void remove(const std::string &key) const {
+    if (!isEnabled())
+      return;
+    std::error_code ec;
+    std::filesystem::remove(directory / (key + ".bin"), ec);
+  }
+
+private:
+  static constexpr char kMagic[8] = {'I', 'M', 'E', 'X', 'K', 'B', 'C', '1'};
+
+  struct Header {
+    char magic[8];
+    uint64_t size;
+    uint64_t hash;
+  };
+
+  // 64-bit FNV-1a.
+  static uint64_t hash(const uint8_t *data, size_t size) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+      h ^= data[i];
+      h *= 0x100000001b3ULL;
+    }
+    return h;
+  }
+
+  // Distinguishes the temporary files of concurrent writers.
+  static uint64_t getUniqueId() {
+    static const uint64_t base = uint64_t(std::random_device()()) << 32;
+    static std::atomic<uint64_t> counter(0);
+    return base + counter++;
+  }
+
+  std::filesystem::path directory;
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_KERNELBINARYCACHE_H
@@ -0,0 +1,108 @@
+//===- KernelProfiling.h - Kernel timing options and reports ----*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the options and the report of the kernel profiling mode
+/// of the GPU runtime wrappers. With IMEX_ENABLE_PROFILING set, every launch
+/// is run a number of times in isolation and the distribution of the device
+/// execution times is printed.
+///
+/// Environment variables:
+///   IMEX_PROFILING_RUNS        - timed runs per launch
+///   IMEX_PROFILING_WARMUPS     - untimed runs before the timed ones
+///   IMEX_PROFILING_KERNEL_RUNS - timed runs of specific kernels, as a comma
+///                                separated list of name=runs
+///   IMEX_ENABLE_CACHE_FLUSHING - flush the device cache before every run
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_KERNELPROFILING_H
+#define IMEX_EXECUTIONENGINE_KERNELPROFILING_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace imex {
+
+struct KernelProfilingOptions {
+  int runs;
+  int warmups = 3;
+  bool flushCache = false;
+  std::map<std::string, int> kernelRuns;
+
+  explicit KernelProfilingOptions(int defaultRuns) : runs(defaultRuns) {
+    if (const char *env = std::getenv("IMEX_PROFILING_RUNS")) {
+      if (int value = std::atoi(env))
+        runs = value;
+    }
+    if (const char *env = std::getenv("IMEX_PROFILING_WARMUPS")) {
+      char *end;
+      long value = std::strtol(env, &end, 10);
+      if (end != env && value >= 0)
+        warmups = static_cast<int>(value);
+    }
+    flushCache = std::getenv("IMEX_ENABLE_CACHE_FLUSHING") != nullptr;
+    if (const char *env = std::getenv("IMEX_PROFILING_KERNEL_RUNS"))
+      parseKernelRuns(env);
+  }
+
+  /// Returns the number of timed runs of the kernel `name`.
+  int getRuns(const std::string &name) const {
+    auto it = kernelRuns.find(name);
+    return it != kernelRuns.end() ? it->second : runs;
+  }
+
+private:
+  void parseKernelRuns(std::string list) {
+    size_t pos = 0;
+    while (pos < list.size()) {
+      size_t end = list.find(',', pos);
+      if (end == std::string::npos)
+        end = list.size();
+      std::string entry = list.substr(pos, end - pos);
+      size_t eq = entry.rfind('=');
+      if (eq != std::string::npos) {
+        if (int value = std::atoi(entry.c_str() + eq + 1))
+          kernelRuns[entry.substr(0, eq)] = value;
+      }
+      pos = end + 1;
+    }
+  }
+};
+
+/// Prints the distribution of the execution times of the kernel `name`, in
+/// milliseconds.
+inline void printKernelProfile(const char *runtime, const std::string &name,
+                               std::vector<double> times) {
+  if (times.empty())
+    return;
+  std::sort(times.begin(), times.end());
+  double sum = 0;
+  for (double time : times)
+    sum += time;
+  auto percentile = [&](double p) {
+    size_t index = static_cast<size_t>(p * (times.size() - 1) + 0.5);
+    return times[index];
+  };
+  fprintf(stdout,
+          "the kernel execution time is (ms%s):"
+          "avg: %.4f, min: %.4f, max: %.4f, median: %.4f, p90: %.4f, "
+          "p99: %.4f (over %zu runs of %s)\n",
+          runtime, sum / times.size(), times.front(), times.back(),
+          percentile(0.5), percentile(0.9), percentile(0.99), times.size(),
+          name.c_str());
+}
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_KERNELPROFILING_H
@@ -0,0 +1,66 @@
+//===- ObjectCache.h - On-disk cache of JIT compiled objects ----*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares an llvm::ObjectCache keeping the objects compiled by the
+/// JIT in a directory, so that later runs of an unchanged module skip codegen.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_OBJECTCACHE_H
+#define IMEX_EXECUTIONENGINE_OBJECTCACHE_H
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace llvm {
+class Module;
+class TargetMachine;
+} // namespace llvm
+
+namespace imex {
+
+/// Stores compiled objects in `directory`, one file per module. Like the
+/// in-memory cache of mlir::ExecutionEngine, objects are looked up by module
+/// identifier: the JIT names modules with getModuleKey() before compiling
+/// them. Files are written to a temporary file and renamed, so concurrent
+/// processes may share the directory.
+class DiskObjectCache : public llvm::ObjectCache {
+public:
+  explicit DiskObjectCache(llvm::StringRef directory);
+
+  /// Returns a key identifying the object `module` compiles to: a hash of its
+  /// bitcode, the target triple, CPU and features of `tm`, and the
+  /// optimization level, if any. The module must not be optimized yet, so
+  /// that a hit also skips the optimization pipeline.
+  static std::string getModuleKey(const llvm::Module &module,
+                                  const llvm::TargetMachine &tm,
+                                  std::optional<unsigned> optLevel);
+
+  /// Returns true if an object is stored for the module identifier `key`.
+  bool contains(llvm::StringRef key) const;
+
+  void notifyObjectCompiled(const llvm::Module *module,
+                            llvm::MemoryBufferRef object) override;
+  std::unique_ptr<llvm::MemoryBuffer>
+  getObject(const llvm::Module *module) override;
+
+private:
+  std::string getPath(llvm::StringRef key) const;
+
+  std::string directory;
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_OBJECTCACHE_H
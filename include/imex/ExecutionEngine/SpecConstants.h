@@ -0,0 +1,133 @@
+//===- SpecConstants.h - Specialization constants of modules ----*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the specialization constants a SPIR-V module is built
+/// with by the GPU runtime wrappers. Kernel arguments marked with
+/// gpux.spec_id are lowered to specialization constants, and every launch
+/// passes their values. The runtimes keep one native module per context,
+/// device, SPIR-V binary and tuple of values, and every launch site caches the
+/// kernel it used last, so a launch on the same device with unchanged values
+/// takes neither a lock nor a map lookup.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_SPECCONSTANTS_H
+#define IMEX_EXECUTIONENGINE_SPECCONSTANTS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace imex {
+
+struct SpecConstants {
+  std::vector<uint32_t> ids;
+  // Values are widened to 64 bits. The driver reads as many bytes as the
+  // constant has in the module, i.e. the low bytes on little endian hosts.
+  std::vector<int64_t> values;
+
+  SpecConstants() = default;
+  SpecConstants(const uint32_t *specIds, const int64_t *specValues,
+                size_t count)
+      : ids(specIds, specIds + count), values(specValues, specValues + count) {}
+
+  bool empty() const { return ids.empty(); }
+
+  /// Returns true if these are the given ids and values.
+  bool equals(const uint32_t *specIds, const int64_t *specValues,
+              size_t count) const {
+    return ids.size() == count && std::equal(ids.begin(), ids.end(), specIds) &&
+           std::equal(values.begin(), values.end(), specValues);
+  }
+
+  bool operator<(const SpecConstants &other) const {
+    return std::tie(ids, values) < std::tie(other.ids, other.values);
+  }
+
+  /// Returns the pointers to the values expected by zeModuleCreate. They stay
+  /// valid as long as this object is not modified.
+  std::vector<const void *> getValuePointers() const {
+    std::vector<const void *> pointers;
+    pointers.reserve(values.size());
+    for (auto &value : values)
+      pointers.push_back(&value);
+    return pointers;
+  }
+
+  /// Returns a string identifying the values, e.g. for the kernel cache key.
+  std::string toString() const {
+    std::string result;
+    for (size_t i = 0; i < ids.size(); ++i) {
+      if (i)
+        result += ',';
+      result += std::to_string(ids[i]) + '=' + std::to_string(values[i]);
+    }
+    return result;
+  }
+};
+
+/// A kernel, the context and device it was created for, and the values it was
+/// built for.
+struct SpecializedKernel {
+  uint64_t contextId;
+  const void *device;
+  SpecConstants specs;
+  void *kernel;
+
+  bool operator<(const SpecializedKernel &other) const {
+    return std::tie(contextId, device, specs, kernel) <
+           std::tie(other.contextId, other.device, other.specs, other.kernel);
+  }
+};
+
+/// Returns the kernel cached in the `slot` of a launch site if it was created
+/// for the given context and device and built for the given values. Otherwise
+/// gets it with `getKernel()` and caches it in the slot. A launch site used
+/// with streams of different devices or contexts takes the slow path when
+/// they alternate. `contextId` must not be reused once the context is
+/// destroyed, unlike the native handle. The slot is a pointer-sized global of
+/// the generated code, zero initialized. Cached entries are never modified
+/// and live until program exit, there is one per kernel and tuple of values,
+/// like the modules.
+template <typename GetKernel>
+void *getSpecializedKernel(void **slot, uint64_t contextId, const void *device,
+                           const uint32_t *specIds, const int64_t *specValues,
+                           size_t count, GetKernel &&getKernel) {
+  using Slot = std::atomic<const SpecializedKernel *>;
+  static_assert(sizeof(Slot) == sizeof(void *), "slot must be a pointer");
+  auto *cached = reinterpret_cast<Slot *>(slot);
+  if (auto *entry = cached->load(std::memory_order_acquire))
+    if (entry->contextId == contextId && entry->device == device &&
+        entry->specs.equals(specIds, specValues, count))
+      return entry->kernel;
+
+  void *kernel = getKernel();
+  static std::mutex mutex;
+  static std::set<SpecializedKernel> entries;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto *entry =
+      &*entries
+            .insert({contextId, device,
+                     SpecConstants(specIds, specValues, count), kernel})
+            .first;
+  cached->store(entry, std::memory_order_release);
+  return kernel;
+}
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_SPECCONSTANTS_H
@@ -0,0 +1,219 @@
+//===- TraceRecorder.h - Chrome trace output for the runtimes ---*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the trace recorder of the GPU runtime wrappers. The
+/// runtimes record timestamped events for module loads, kernel launches,
+/// copies, allocations and frees, and the recorder writes them as a Chrome
+/// trace (the JSON format read by chrome://tracing and Perfetto) when the
+/// process exits.
+///
+/// Every thread appends to its own buffer, only the first event of a thread
+/// takes a lock. Host events are placed on the track of the recording thread,
+/// device commands on the track of their queue. All times are nanoseconds of
+/// the host steady clock. Events are written ordered by start time, an event
+/// enclosing others comes first, so nested scopes form a call tree.
+///
+/// With the host timer, the recorder itself times every event from its start
+/// to the point it is recorded; the runtimes only have to record a device
+/// command once they have waited for it.
+///
+/// Environment variables:
+///   IMEX_TRACE_FILE       - write the trace to this file
+///   IMEX_TRACE_HOST_TIMER - time device commands with the host clock, the
+///                           runtimes then wait for every command to complete
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef IMEX_EXECUTIONENGINE_TRACERECORDER_H
+#define IMEX_EXECUTIONENGINE_TRACERECORDER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace imex {
+
+struct TraceEvent {
+  // One of "module", "kernel", "memcpy", "alloc", "free" or "graph".
+  const char *category = "";
+  std::string name;
+  uint64_t start = 0;
+  uint64_t duration = 0;
+  // The device track of the command, or 0 for a host event.
+  uint32_t deviceTrack = 0;
+  // JSON members of the "args" object, e.g. "\"bytes\":64".
+  std::string args;
+};
+
+class TraceRecorder {
+public:
+  /// Returns the recorder of the process.
+  static TraceRecorder &get() {
+    static TraceRecorder recorder;
+    return recorder;
+  }
+
+  TraceRecorder(const TraceRecorder &) = delete;
+  TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+  ~TraceRecorder() { dump(); }
+
+  bool isEnabled() const { return !path.empty(); }
+
+  /// Returns true if device commands are timed with the host clock.
+  bool useHostTimer() const { return hostTimer; }
+
+  /// Returns the current time in nanoseconds.
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /// Returns a new track for the commands of a device queue.
+  uint32_t createDeviceTrack() { return ++numDeviceTracks; }
+
+  /// Appends `event` to the buffer of the calling thread.
+  void record(TraceEvent event) {
+    if (!isEnabled())
+      return;
+    getThreadBuffer().events.push_back(std::move(event));
+  }
+
+  /// Records `event` as lasting from `start` until now.
+  void recordSince(TraceEvent event, uint64_t start) {
+    if (!isEnabled())
+      return;
+    event.start = start;
+    event.duration = now() - start;
+    record(std::move(event));
+  }
+
+  /// Writes all events recorded so far. Threads must not record events
+  /// concurrently.
+  void dump() {
+    if (!isEnabled())
+      return;
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) {
+      fprintf(stderr, "Cannot write the trace to %s\n", path.c_str());
+      return;
+    }
+
+    uint64_t base = UINT64_MAX;
+    for (auto &buffer : buffers) {
+      std::stable_sort(buffer->events.begin(), buffer->events.end(),
+                       [](const TraceEvent &lhs, const TraceEvent &rhs) {
+                         if (lhs.start != rhs.start)
+                           return lhs.start < rhs.start;
+                         return lhs.duration > rhs.duration;
+                       });
+      for (auto &event : buffer->events)
+        base = std::min(base, event.start);
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,"
+                  "\"args\":{\"name\":\"host\"}},\n");
+    fprintf(file, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":2,"
+                  "\"args\":{\"name\":\"device\"}}");
+    for (auto &buffer : buffers) {
+      for (auto &event : buffer->events) {
+        bool onDevice = event.deviceTrack != 0;
+        fprintf(file,
+                ",\n{\"ph\":\"X\",\"cat\":\"%s\",\"name\":\"%s\",\"pid\":%d,"
+                "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{%s}}",
+                event.category, escape(event.name).c_str(), onDevice ? 2 : 1,
+                onDevice ? event.deviceTrack : buffer->threadId,
+                (event.start - base) / 1000.0, event.duration / 1000.0,
+                event.args.c_str());
+      }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+  }
+
+private:
+  struct ThreadBuffer {
+    uint32_t threadId;
+    std::vector<TraceEvent> events;
+  };
+
+  TraceRecorder() {
+    if (const char *file = std::getenv("IMEX_TRACE_FILE"))
+      path = file;
+    hostTimer = std::getenv("IMEX_TRACE_HOST_TIMER") != nullptr;
+  }
+
+  // Buffers are owned by the recorder, so the events of threads that have
+  // exited are still written.
+  ThreadBuffer &getThreadBuffer() {
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (!buffer) {
+      std::lock_guard<std::mutex> lock(mutex);
+      buffers.push_back(std::make_unique<ThreadBuffer>());
+      buffer = buffers.back().get();
+      buffer->threadId = static_cast<uint32_t>(buffers.size());
+    }
+    return *buffer;
+  }
+
+  static std::string escape(const std::string &str) {
+    std::string result;
+    for (char c : str) {
+      if (c == '"' || c == '\\')
+        result += '\\';
+      if (static_cast<unsigned char>(c) < 0x20)
+        continue;
+      result += c;
+    }
+    return result;
+  }
+
+  std::string path;
+  bool hostTimer = false;
+  std::atomic<uint32_t> numDeviceTracks{0};
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+/// Records an event lasting for the lifetime of the scope.
+class TraceScope {
+public:
+  TraceScope(const char *category, std::string name, uint32_t deviceTrack = 0)
+      : start(TraceRecorder::now()) {
+    event.category = category;
+    event.name = std::move(name);
+    event.deviceTrack = deviceTrack;
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+  ~TraceScope() { TraceRecorder::get().recordSince(std::move(event), start); }
+
+  void setArgs(std::string args) { event.args = std::move(args); }
+
+private:
+  TraceEvent event;
+  uint64_t start;
+};
+
+} // namespace imex
+
+#endif // IMEX_EXECUTIONENGINE_TRACERECORDER_H
@@ -25,11 +25,16 @@ std::unique_ptr<mlir::Pass> createInsertGPUAllocsPass();
 std::unique_ptr<mlir::Pass> createSetSPIRVCapabilitiesPass();
 std::unique_ptr<mlir::Pass> createSetSPIRVAbiAttributePass();
 std::unique_ptr<mlir::Pass> createAddOuterParallelLoopPass();
+std::unique_ptr<mlir::Pass> createParallelizeReductionsPass();
+std::unique_ptr<mlir::Pass> createTileParallelLoopsPass();
+std::unique_ptr<mlir::Pass> createTileAndVectorizeLinalgPass();
 std::unique_ptr<mlir::Pass> createLowerMemRefCopyPass();
+std::unique_ptr<mlir::Pass> createLinalgElementwiseFusionPass();
 std::unique_ptr<mlir::Pass> createBF16ToGPUPass();
 std::unique_ptr<mlir::Pass> createRemoveTemporariesPass();
 std::unique_ptr<mlir::Pass> createVectorLinearizePass();
 std::unique_ptr<mlir::Pass> createPropagatePackedLayoutPass();
+std::unique_ptr<mlir::Pass> createMarkSpecConstantsPass();
 
 #define GEN_PASS_DECL
 #include "imex/Transforms/Passes.h.inc"
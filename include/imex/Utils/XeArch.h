@@ -70,8 +70,21 @@ public:
     repeatCount = 8;
     sDepth = 8;
     execSize = 16;
+
+    // Device geometry - default to PVC (Max 1550)
+    numEUs = 1024;
+    threadsPerEU = 8;
   }
 
+  /// Number of EUs (vector engines) on the device.
+  unsigned int getNumEUs() const { return numEUs; }
+
+  /// Number of hardware threads each EU can keep resident.
+  unsigned int getThreadsPerEU() const { return threadsPerEU; }
+
+  /// Number of SIMD lanes of a hardware thread, i.e. the subgroup size.
+  unsigned int getSIMDWidth() const { return execSize; }
+
   virtual mlir::LogicalResult checkSupportedDpasTypes(mlir::Operation *op,
                                                       mlir::Type AType,
                                                       mlir::Type BType,
@@ -111,6 +124,8 @@ protected:
   unsigned int sDepth;
   unsigned int execSize; // Maximum number of channels allowed. Number of
                          // Channels operating in parallel for dpas instruction
+  unsigned int numEUs;
+  unsigned int threadsPerEU;
 
   /// D (MxN) = C (MxN) + A (MxK) x B (KxN)
   /// M = Repeat Count
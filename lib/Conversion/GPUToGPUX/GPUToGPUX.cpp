@@ -202,6 +202,78 @@ struct ConvertMemsetOp : public mlir::OpRewritePattern<mlir::gpu::MemsetOp> {
   }
 };
 
+// Returns the stream of a synchronous launch or copy, which can be recorded
+// into a graph, or null for any other op. Shared streams serve all threads,
+// while the runtime records the commands of any thread between the begin and
+// the end of a graph, so their commands are not recorded.
+static mlir::Value getGraphableStream(mlir::Operation *op) {
+  mlir::Value stream;
+  if (auto launchOp = mlir::dyn_cast<imex::gpux::LaunchFuncOp>(op)) {
+    if (!launchOp.getAsyncToken() && launchOp.getAsyncDependencies().empty())
+      stream = launchOp.getGpuxStream();
+  } else if (auto memcpyOp = mlir::dyn_cast<imex::gpux::MemcpyOp>(op)) {
+    if (!memcpyOp.getAsyncToken() && memcpyOp.getAsyncDependencies().empty())
+      stream = memcpyOp.getGpuxStream();
+  }
+  auto createOp =
+      stream ? stream.getDefiningOp<imex::gpux::CreateStreamOp>() : nullptr;
+  if (createOp && createOp.getShared())
+    return {};
+  return stream;
+}
+
+// Moves runs of at least two synchronous launches and copies on the same
+// stream into gpux.graph ops. Ops without side effects in between stay where
+// they are, the graph is placed at the last launch or copy of the run, which
+// all operands dominate.
+static void groupIntoGraphs(mlir::Operation *root) {
+  llvm::SmallVector<llvm::SmallVector<mlir::Operation *>> runs;
+  root->walk([&](mlir::Block *block) {
+    llvm::SmallVector<mlir::Operation *> run;
+    mlir::Value runStream;
+    auto flush = [&]() {
+      if (run.size() > 1)
+        runs.push_back(run);
+      run.clear();
+    };
+    for (mlir::Operation &op : *block) {
+      if (auto stream = getGraphableStream(&op)) {
+        if (stream != runStream)
+          flush();
+        runStream = stream;
+        run.push_back(&op);
+      } else if (op.getNumRegions() != 0 || !mlir::isMemoryEffectFree(&op)) {
+        flush();
+      }
+    }
+    flush();
+  });
+
+  for (auto &run : runs) {
+    mlir::OpBuilder builder(run.front()->getContext());
+    builder.setInsertionPointAfter(run.back());
+    auto graph = builder.create<imex::gpux::GraphOp>(
+        run.front()->getLoc(), getGraphableStream(run.front()));
+    mlir::Block *body = builder.createBlock(&graph.getBody());
+    for (mlir::Operation *op : run)
+      op->moveBefore(body, body->end());
+  }
+}
+
+// Makes the default streams created in functions shared, so that they are
+// created once and reused by later calls instead of being created and
+// destroyed in every call.
+static void shareStreams(mlir::Operation *root) {
+  root->walk([&](imex::gpux::CreateStreamOp op) {
+    if (op.getDevice() || op.getContext())
+      return;
+    op.setShared(true);
+    for (auto *user : llvm::make_early_inc_range(op->getUsers()))
+      if (mlir::isa<imex::gpux::DestroyStreamOp>(user))
+        user->erase();
+  });
+}
+
 // This pass converts the GPU dialect ops to our custom GPUX dialect ops
 // which add a stream to the gpu dialect ops. These ops are then lowered
 // LLVM dialect and eventually to stcl/l0 runtime calls.
@@ -216,6 +288,11 @@ struct GPUToGPUXPass : public ::imex::ConvertGPUToGPUXBase<GPUToGPUXPass> {
 
     (void)mlir::applyPatternsAndFoldGreedily(getOperation(),
                                              std::move(patterns));
+
+    if (sharedStreams)
+      shareStreams(getOperation());
+    if (formGraphs)
+      groupIntoGraphs(getOperation());
   }
 }; // namespace imex
 
@@ -18,6 +18,7 @@
 #include "../PassDetail.h"
 
 #include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/Support/Debug.h>
 #include <mlir/Conversion/ArithToSPIRV/ArithToSPIRV.h>
 #include <mlir/Conversion/ControlFlowToSPIRV/ControlFlowToSPIRV.h>
@@ -29,6 +30,7 @@
 #include <mlir/Conversion/VectorToSPIRV/VectorToSPIRV.h>
 #include <mlir/Dialect/Arith/IR/Arith.h>
 #include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
 #include <mlir/Dialect/SPIRV/IR/SPIRVDialect.h>
 #include <mlir/Dialect/SPIRV/IR/SPIRVOps.h>
 #include <mlir/Dialect/SPIRV/IR/SPIRVTypes.h>
@@ -172,6 +174,102 @@ void populateGPUPrintfToSPIRVPatterns(mlir::SPIRVTypeConverter &typeConverter,
   patterns.add<PrintfOpPattern>(typeConverter, patterns.getContext());
 }
 
+/// Lowers f32 memref.atomic_rmw addf to spirv.EXT.AtomicFAdd. The upstream
+/// MemRefToSPIRV patterns only handle integer atomics.
+class AtomicRMWFAddOpPattern
+    : public mlir::OpConversionPattern<mlir::memref::AtomicRMWOp> {
+public:
+  using mlir::OpConversionPattern<
+      mlir::memref::AtomicRMWOp>::OpConversionPattern;
+  mlir::LogicalResult
+  matchAndRewrite(mlir::memref::AtomicRMWOp atomicOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    if (atomicOp.getKind() != mlir::arith::AtomicRMWKind::addf ||
+        !atomicOp.getType().isF32())
+      return rewriter.notifyMatchFailure(atomicOp, "expected f32 addf");
+
+    auto &typeConverter = *getTypeConverter<mlir::SPIRVTypeConverter>();
+    auto resultType = typeConverter.convertType(atomicOp.getType());
+    if (!resultType)
+      return mlir::failure();
+
+    mlir::Value ptr = mlir::spirv::getElementPtr(
+        typeConverter, atomicOp.getMemRefType(), adaptor.getMemref(),
+        adaptor.getIndices(), atomicOp.getLoc(), rewriter);
+    if (!ptr)
+      return mlir::failure();
+
+    rewriter.replaceOpWithNewOp<mlir::spirv::EXTAtomicFAddOp>(
+        atomicOp, resultType, ptr, mlir::spirv::Scope::Device,
+        mlir::spirv::MemorySemantics::AcquireRelease, adaptor.getValue());
+    return mlir::success();
+  }
+};
+
+/// Kernel argument attribute selecting arguments whose values are provided as
+/// specialization constants when the module is built.
+static constexpr llvm::StringLiteral kSpecIdAttrName = "gpux.spec_id";
+
+/// Replaces the uses of the kernel arguments marked with gpux.spec_id by
+/// specialization constants with that id. The arguments are kept, so the
+/// kernel signature does not change, but the finalizer sees their values as
+/// constants and can unroll and vectorize around them. Kernels of a module
+/// marking the same id share the constant.
+static mlir::LogicalResult specializeKernelArgs(mlir::ModuleOp module) {
+  for (auto spvModule : module.getOps<mlir::spirv::ModuleOp>()) {
+    // The SPIR-V module of a gpu.module is named with the prefix "__spv__".
+    auto name = spvModule.getName();
+    if (!name || !name->consume_front("__spv__"))
+      continue;
+    auto gpuModule = module.lookupSymbol<mlir::gpu::GPUModuleOp>(*name);
+    if (!gpuModule)
+      continue;
+
+    llvm::DenseMap<uint32_t, mlir::spirv::SpecConstantOp> specConstants;
+    auto builder = mlir::OpBuilder::atBlockBegin(spvModule.getBody());
+    for (auto func : spvModule.getOps<mlir::spirv::FuncOp>()) {
+      auto gpuFunc =
+          gpuModule.lookupSymbol<mlir::gpu::GPUFuncOp>(func.getSymName());
+      if (!gpuFunc || func.isExternal())
+        continue;
+
+      mlir::Block &entry = func.front();
+      for (auto [index, arg] : llvm::enumerate(entry.getArguments())) {
+        auto specId = gpuFunc.getArgAttrOfType<mlir::IntegerAttr>(
+            index, kSpecIdAttrName);
+        if (!specId)
+          continue;
+        auto type = mlir::dyn_cast<mlir::IntegerType>(arg.getType());
+        if (!type || type.getWidth() == 1)
+          return gpuFunc.emitOpError()
+                 << "argument " << index << " with " << kSpecIdAttrName
+                 << " must be an integer or index";
+
+        auto id = static_cast<uint32_t>(specId.getInt());
+        auto &specConstant = specConstants[id];
+        if (!specConstant) {
+          mlir::SmallString<32> specName;
+          (llvm::Twine("spec_arg") + llvm::Twine(id)).toStringRef(specName);
+          specConstant = builder.create<mlir::spirv::SpecConstantOp>(
+              func.getLoc(), builder.getStringAttr(specName),
+              builder.getIntegerAttr(type, 0));
+          specConstant->setAttr("spec_id", builder.getI32IntegerAttr(id));
+        } else if (specConstant.getDefaultValue().getType() != type) {
+          return gpuFunc.emitOpError()
+                 << "arguments with " << kSpecIdAttrName << " " << id
+                 << " have different types";
+        }
+
+        mlir::OpBuilder funcBuilder = mlir::OpBuilder::atBlockBegin(&entry);
+        mlir::Value value = funcBuilder.create<mlir::spirv::ReferenceOfOp>(
+            func.getLoc(), type, mlir::FlatSymbolRefAttr::get(specConstant));
+        arg.replaceAllUsesWith(value);
+      }
+    }
+  }
+  return mlir::success();
+}
+
 static bool isGenericVectorTy(mlir::Type type) {
   if (mlir::isa<mlir::spirv::ScalarType>(type))
     return true;
@@ -362,10 +460,14 @@ void GPUXToSPIRVPass::runOnOperation() {
     mlir::cf::populateControlFlowToSPIRVPatterns(typeConverter, patterns);
     mlir::populateMathToSPIRVPatterns(typeConverter, patterns);
     imex::populateGPUPrintfToSPIRVPatterns(typeConverter, patterns);
+    patterns.add<AtomicRMWFAddOpPattern>(typeConverter, context);
 
     if (failed(applyFullConversion(gpuModule, *target, std::move(patterns))))
       return signalPassFailure();
   }
+
+  if (failed(specializeKernelArgs(module)))
+    return signalPassFailure();
 }
 
 std::unique_ptr<::mlir::OperationPass<::mlir::ModuleOp>>
@@ -54,6 +54,7 @@
 namespace {
 
 static constexpr const char *kGpuBinaryStorageSuffix = "_spirv_binary";
+static constexpr llvm::StringLiteral kSpecIdAttrName = "gpux.spec_id";
 
 struct FunctionCallBuilder {
   FunctionCallBuilder(mlir::StringRef functionName, mlir::Type returnType,
@@ -118,6 +119,20 @@ protected:
           llvmIndexType    /* size*/
       }};
 
+  FunctionCallBuilder kernelGetSpecializedCallBuilder = {
+      "gpuKernelGetSpecialized",
+      llvmPointerType /* void *kernel */,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType, /* void **slot */
+          llvmPointerType, /* void *spirv*/
+          llvmIndexType,   /* size*/
+          llvmPointerType, /* char *name */
+          llvmPointerType, /* uint32_t *specIds */
+          llvmPointerType, /* int64_t *specValues */
+          llvmIndexType    /* numSpecs */
+      }};
+
   FunctionCallBuilder moduleUnloadCallBuilder = {
       "gpuModuleUnload",
       llvmVoidType,
@@ -158,6 +173,23 @@ protected:
           llvmPointerType  /* void *context */
       }};
 
+  FunctionCallBuilder streamCreateOnDeviceCallBuilder = {
+      "gpuCreateStreamOnDevice",
+      llvmPointerType, /* void *stream */
+      {
+          llvmInt32Type, /* int32_t deviceIndex */
+          llvmInt32Type  /* int32_t queueIndex */
+      }};
+
+  FunctionCallBuilder sharedStreamGetCallBuilder = {
+      "gpuGetSharedStream",
+      llvmPointerType, /* void *stream */
+      {
+          llvmPointerType, /* void **slot */
+          llvmInt32Type,   /* int32_t deviceIndex */
+          llvmInt32Type    /* int32_t queueIndex */
+      }};
+
   FunctionCallBuilder streamDestroyCallBuilder = {
       "gpuStreamDestroy",
       llvmVoidType,
@@ -188,6 +220,127 @@ protected:
           llvmPointerType, /* void *stream */
           llvmPointerType  /* void *ptr */
       }};
+
+  FunctionCallBuilder memcpyCallBuilder = {
+      "gpuMemCopy",
+      llvmVoidType,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType, /* void *dst */
+          llvmPointerType, /* void *src */
+          llvmIndexType    /* intptr_t size */
+      }};
+
+  // Async variants return a token and take the tokens they depend on as an
+  // array of pointers.
+  FunctionCallBuilder launchKernelAsyncCallBuilder = {
+      "gpuLaunchKernelAsync",
+      llvmPointerType /* void *token */,
+      {
+          llvmPointerType,      /* void* stream */
+          llvmPointerType,      /* void* func */
+          llvmIndexType,        /* intptr_t gridXDim */
+          llvmIndexType,        /* intptr_t gridyDim */
+          llvmIndexType,        /* intptr_t gridZDim */
+          llvmIndexType,        /* intptr_t blockXDim */
+          llvmIndexType,        /* intptr_t blockYDim */
+          llvmIndexType,        /* intptr_t blockZDim */
+          llvmInt32Type,        /* unsigned int sharedMemBytes */
+          llvmRangePointerType, /* Params */
+          llvmPointerType,      /* void **deps */
+          llvmIndexType         /* intptr_t numDeps */
+      }};
+
+  FunctionCallBuilder memcpyAsyncCallBuilder = {
+      "gpuMemCopyAsync",
+      llvmPointerType /* void *token */,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType, /* void *dst */
+          llvmPointerType, /* void *src */
+          llvmIndexType,   /* intptr_t size */
+          llvmPointerType, /* void **deps */
+          llvmIndexType    /* intptr_t numDeps */
+      }};
+
+  FunctionCallBuilder eventJoinCallBuilder = {
+      "gpuEventJoin",
+      llvmPointerType /* void *token */,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType, /* void **deps */
+          llvmIndexType    /* intptr_t numDeps */
+      }};
+
+  FunctionCallBuilder waitEventsCallBuilder = {
+      "gpuWaitEvents",
+      llvmVoidType,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType, /* void **deps */
+          llvmIndexType    /* intptr_t numDeps */
+      }};
+
+  FunctionCallBuilder graphBeginCallBuilder = {
+      "gpuGraphBegin",
+      llvmVoidType,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType  /* void *graph */
+      }};
+
+  FunctionCallBuilder graphEndCallBuilder = {
+      "gpuGraphEnd",
+      llvmVoidType,
+      {
+          llvmPointerType, /* void *stream */
+          llvmPointerType  /* void *graph */
+      }};
+
+  // Stores the converted async tokens in a stack allocated array. Returns the
+  // array and the number of tokens.
+  std::pair<mlir::Value, mlir::Value>
+  packTokens(mlir::Operation *op, mlir::ValueRange tokens,
+             mlir::OpBuilder &builder) const {
+    auto loc = op->getLoc();
+    auto count = builder.create<mlir::LLVM::ConstantOp>(
+        loc, llvmIndexType,
+        builder.getIntegerAttr(llvmIndexType,
+                               static_cast<int64_t>(tokens.size())));
+    if (tokens.empty())
+      return {builder.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType), count};
+
+    imex::AllocaInsertionPoint allocaHelper(op);
+    auto array = allocaHelper.insert(builder, [&]() {
+      auto size = builder.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt64Type,
+          builder.getI64IntegerAttr(static_cast<int64_t>(tokens.size())));
+      return builder.create<mlir::LLVM::AllocaOp>(loc, llvmPointerType,
+                                                  llvmPointerType, size, 0);
+    });
+    for (auto [i, token] : llvm::enumerate(tokens)) {
+      auto ptr = builder.create<mlir::LLVM::GEPOp>(
+          loc, llvmPointerType, llvmPointerType, array,
+          mlir::ArrayRef<mlir::LLVM::GEPArg>{static_cast<int32_t>(i)});
+      builder.create<mlir::LLVM::StoreOp>(loc, token, ptr);
+    }
+    return {array, count};
+  }
+
+  // Blocks the host until the commands of `tokens` have completed.
+  void waitForTokens(mlir::Operation *op, mlir::Value stream,
+                     mlir::ValueRange tokens, mlir::OpBuilder &builder) const {
+    if (tokens.empty())
+      return;
+    auto [array, count] = packTokens(op, tokens, builder);
+    waitEventsCallBuilder.create(op->getLoc(), builder, {stream, array, count});
+  }
+
+  // Tokens of host synchronous operations are always complete.
+  mlir::Value getCompletedToken(mlir::Location loc,
+                                mlir::OpBuilder &builder) const {
+    return builder.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+  }
 };
 
 /// A rewrite pattern to convert gpux.alloc operations into a GPU runtime
@@ -215,6 +368,10 @@ private:
 
     auto loc = allocOp.getLoc();
 
+    // Allocation is host synchronous.
+    waitForTokens(allocOp, adaptor.getGpuxStream(),
+                  adaptor.getAsyncDependencies(), rewriter);
+
     // Get shape of the memref as values: static sizes are constant
     // values and dynamic sizes are passed to 'alloc' as operands.
     mlir::SmallVector<mlir::Value, 4> shape;
@@ -259,8 +416,10 @@ private:
       memrefDesc.setStride(rewriter, loc, i, strides[i]);
     }
 
-    mlir::Value resMemref = memrefDesc;
-    rewriter.replaceOp(allocOp, resMemref);
+    mlir::SmallVector<mlir::Value, 2> results = {memrefDesc};
+    if (allocOp.getAsyncToken())
+      results.push_back(getCompletedToken(loc, rewriter));
+    rewriter.replaceOp(allocOp, results);
 
     return mlir::success();
   }
@@ -282,13 +441,167 @@ private:
                   mlir::ConversionPatternRewriter &rewriter) const override {
     mlir::Location loc = deallocOp.getLoc();
 
+    // The runtime reuses the memory, or gives it back to the driver, only
+    // once the commands submitted before the free have completed.
     mlir::Value pointer =
         mlir::MemRefDescriptor(adaptor.getMemref()).allocatedPtr(rewriter, loc);
     auto casted =
         rewriter.create<mlir::LLVM::BitcastOp>(loc, llvmPointerType, pointer);
-    auto res = deallocCallBuilder.create(loc, rewriter,
-                                         {adaptor.getGpuxStream(), casted});
-    rewriter.replaceOp(deallocOp, res.getResults());
+    deallocCallBuilder.create(loc, rewriter, {adaptor.getGpuxStream(), casted});
+    if (deallocOp.getAsyncToken())
+      rewriter.replaceOp(deallocOp, getCompletedToken(loc, rewriter));
+    else
+      rewriter.eraseOp(deallocOp);
+    return mlir::success();
+  }
+};
+
+/// A rewrite pattern to convert gpux.memcpy operations into a GPU runtime
+/// call. Both memrefs are expected to be contiguous, the number of bytes is
+/// computed from the shape of the source. Async copies return a token and
+/// do not block the host.
+class ConvertMemcpyOpToGpuRuntimeCallPattern
+    : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::MemcpyOp> {
+public:
+  ConvertMemcpyOpToGpuRuntimeCallPattern(mlir::LLVMTypeConverter &typeConverter)
+      : ConvertOpToGpuRuntimeCallPattern<imex::gpux::MemcpyOp>(typeConverter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(imex::gpux::MemcpyOp memcpyOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto memRefType =
+        mlir::dyn_cast<mlir::MemRefType>(memcpyOp.getSrc().getType());
+    if (!memRefType || !memRefType.getLayout().isIdentity() ||
+        !mlir::cast<mlir::MemRefType>(memcpyOp.getDst().getType())
+             .getLayout()
+             .isIdentity())
+      return mlir::failure();
+
+    auto elementType =
+        getTypeConverter()->convertType(memRefType.getElementType());
+    if (!elementType)
+      return mlir::failure();
+
+    auto loc = memcpyOp.getLoc();
+    mlir::MemRefDescriptor srcDesc(adaptor.getSrc());
+    mlir::MemRefDescriptor dstDesc(adaptor.getDst());
+
+    mlir::Value numElements = rewriter.create<mlir::LLVM::ConstantOp>(
+        loc, llvmIndexType, rewriter.getIntegerAttr(llvmIndexType, 1));
+    for (auto i : llvm::seq<int64_t>(0, memRefType.getRank()))
+      numElements = rewriter.create<mlir::LLVM::MulOp>(
+          loc, numElements, srcDesc.size(rewriter, loc, i));
+
+    // sizeof(element) * numElements, computed as the address of
+    // ((element *)nullptr)[numElements].
+    auto nullPtr = rewriter.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+    auto gep = rewriter.create<mlir::LLVM::GEPOp>(
+        loc, llvmPointerType, elementType, nullPtr, numElements);
+    mlir::Value sizeBytes =
+        rewriter.create<mlir::LLVM::PtrToIntOp>(loc, llvmIndexType, gep);
+
+    auto getDataPtr = [&](mlir::MemRefDescriptor &desc) -> mlir::Value {
+      return rewriter.create<mlir::LLVM::GEPOp>(
+          loc, llvmPointerType, elementType, desc.alignedPtr(rewriter, loc),
+          desc.offset(rewriter, loc));
+    };
+
+    auto stream = adaptor.getGpuxStream();
+    auto dst = getDataPtr(dstDesc);
+    auto src = getDataPtr(srcDesc);
+    if (memcpyOp.getAsyncToken()) {
+      auto [deps, numDeps] =
+          packTokens(memcpyOp, adaptor.getAsyncDependencies(), rewriter);
+      auto token = memcpyAsyncCallBuilder.create(
+          loc, rewriter, {stream, dst, src, sizeBytes, deps, numDeps});
+      rewriter.replaceOp(memcpyOp, token.getResults());
+      return mlir::success();
+    }
+
+    // The synchronous copy is done on return.
+    waitForTokens(memcpyOp, stream, adaptor.getAsyncDependencies(), rewriter);
+    memcpyCallBuilder.create(loc, rewriter, {stream, dst, src, sizeBytes});
+    rewriter.eraseOp(memcpyOp);
+    return mlir::success();
+  }
+};
+
+/// A rewrite pattern to convert gpux.wait operations into GPU runtime calls.
+/// A synchronous wait blocks the host until its dependencies, or all commands
+/// on the stream if there are none, have completed. An async wait returns a
+/// token joining its dependencies.
+class ConvertWaitOpToGpuRuntimeCallPattern
+    : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::WaitOp> {
+public:
+  ConvertWaitOpToGpuRuntimeCallPattern(mlir::LLVMTypeConverter &typeConverter)
+      : ConvertOpToGpuRuntimeCallPattern<imex::gpux::WaitOp>(typeConverter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(imex::gpux::WaitOp waitOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto loc = waitOp.getLoc();
+    auto stream = adaptor.getGpuxStream();
+    auto deps = adaptor.getAsyncDependencies();
+    if (waitOp.getAsyncToken()) {
+      auto [array, count] = packTokens(waitOp, deps, rewriter);
+      auto token =
+          eventJoinCallBuilder.create(loc, rewriter, {stream, array, count});
+      rewriter.replaceOp(waitOp, token.getResults());
+      return mlir::success();
+    }
+
+    if (deps.empty())
+      waitCallBuilder.create(loc, rewriter, stream);
+    else
+      waitForTokens(waitOp, stream, deps, rewriter);
+    rewriter.eraseOp(waitOp);
+    return mlir::success();
+  }
+};
+
+/// A rewrite pattern to convert gpux.graph operations into GPU runtime calls.
+/// The body is inlined between gpuGraphBegin and gpuGraphEnd, the runtime
+/// records the commands issued in between and replays them on later
+/// executions. Every graph is identified by the address of its own global.
+class ConvertGraphOpToGpuRuntimeCallPattern
+    : public ConvertOpToGpuRuntimeCallPattern<imex::gpux::GraphOp> {
+public:
+  ConvertGraphOpToGpuRuntimeCallPattern(mlir::LLVMTypeConverter &typeConverter)
+      : ConvertOpToGpuRuntimeCallPattern<imex::gpux::GraphOp>(typeConverter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(imex::gpux::GraphOp graphOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto loc = graphOp.getLoc();
+    auto module = graphOp->getParentOfType<mlir::ModuleOp>();
+    std::string graphName;
+    for (unsigned i = 0;; ++i) {
+      graphName = std::string(llvm::formatv("gpux_graph_{0}", i));
+      if (!module.lookupSymbol(graphName))
+        break;
+    }
+    mlir::LLVM::GlobalOp graphId;
+    {
+      mlir::OpBuilder::InsertionGuard guard(rewriter);
+      rewriter.setInsertionPointToEnd(module.getBody());
+      graphId = rewriter.create<mlir::LLVM::GlobalOp>(
+          loc, llvmPointerType, /*isConstant=*/false,
+          mlir::LLVM::Linkage::Internal, graphName, mlir::Attribute());
+      rewriter.createBlock(&graphId.getInitializerRegion());
+      mlir::Value zero =
+          rewriter.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+      rewriter.create<mlir::LLVM::ReturnOp>(loc, zero);
+    }
+
+    auto stream = adaptor.getGpuxStream();
+    mlir::Value graph = rewriter.create<mlir::LLVM::AddressOfOp>(loc, graphId);
+    graphBeginCallBuilder.create(loc, rewriter, {stream, graph});
+    rewriter.inlineBlockBefore(&graphOp.getBody().front(), graphOp);
+    graphEndCallBuilder.create(loc, rewriter, {stream, graph});
+    rewriter.eraseOp(graphOp);
     return mlir::success();
   }
 };
@@ -301,6 +614,12 @@ private:
 /// * moduleLoad        -- loads the module given the spirv data
 /// * KernelGetFunction -- gets a handle to the actual kernel function
 /// * launchKernel      -- launches the kernel on a stream
+///
+/// Instead of the first two, the runtime is asked for the kernel of the stream,
+/// which is cached in a global per kernel while the context and device of the
+/// stream do not change. Kernels with arguments marked with gpux.spec_id ask
+/// for the kernel built for the values of these arguments, which is cached
+/// per launch site while the values do not change either.
 /// * gpuWait           -- waits for operations on the stream to finish
 ///
 /// Intermediate data structures are allocated on the stack.
@@ -343,14 +662,139 @@ private:
         mlir::LLVM::Linkage::Internal);
   }
 
-  mlir::LogicalResult
-  matchAndRewrite(imex::gpux::LaunchFuncOp launchOp, OpAdaptor adaptor,
-                  mlir::ConversionPatternRewriter &rewriter) const override {
+  // Generates, once per kernel, an internal function returning the kernel
+  // handle for the context and device of the stream. The runtime caches the
+  // handle in an LLVM global, and only loads the module again when a stream
+  // of another context or device launches the kernel. The code is
+  // essentially:
+  //
+  // llvm.mlir.global internal @kernel_handle() : !llvm.ptr
+  // llvm.func internal @get_kernel(%stream: !llvm.ptr) -> !llvm.ptr {
+  //   %kernel = llvm.call @gpuKernelGetSpecialized(%stream, @kernel_handle,
+  //                                                @spirv_binary, size,
+  //                                                @kernel_name, null, null,
+  //                                                0)
+  //   llvm.return %kernel
+  // }
+  mlir::FailureOr<mlir::LLVM::LLVMFuncOp>
+  getOrCreateKernelGetter(imex::gpux::LaunchFuncOp launchOp,
+                          mlir::ConversionPatternRewriter &builder) const {
+    mlir::Location loc = launchOp.getLoc();
+    auto moduleName = launchOp.getKernelModuleName().getValue();
+    auto kernelName = launchOp.getKernelName().getValue();
+    std::string getterName = std::string(
+        llvm::formatv("{0}_{1}_get_kernel", moduleName, kernelName));
+    auto module = launchOp->getParentOfType<mlir::ModuleOp>();
+    if (auto getter = module.lookupSymbol<mlir::LLVM::LLVMFuncOp>(getterName))
+      return getter;
+
+    // Create an LLVM global with SPIRV extracted from the kernel annotation.
+    auto kernelModule =
+        mlir::SymbolTable::lookupNearestSymbolFrom<mlir::gpu::GPUModuleOp>(
+            launchOp, launchOp.getKernelModuleName());
+    assert(kernelModule && "expected a kernel module");
 
+    auto binaryAttr =
+        kernelModule->getAttrOfType<mlir::StringAttr>(gpuBinaryAnnotation);
+    if (!binaryAttr) {
+      kernelModule.emitOpError()
+          << "missing " << gpuBinaryAnnotation << " attribute";
+      return mlir::failure();
+    }
+
+    mlir::OpBuilder::InsertionGuard guard(builder);
+    builder.setInsertionPointToEnd(module.getBody());
+    std::string handleName = std::string(
+        llvm::formatv("{0}_{1}_kernel_handle", moduleName, kernelName));
+    auto handle = builder.create<mlir::LLVM::GlobalOp>(
+        loc, llvmPointerType, /*isConstant=*/false,
+        mlir::LLVM::Linkage::Internal, handleName, mlir::Attribute());
+    {
+      mlir::OpBuilder::InsertionGuard initGuard(builder);
+      builder.createBlock(&handle.getInitializerRegion());
+      mlir::Value zero =
+          builder.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+      builder.create<mlir::LLVM::ReturnOp>(loc, zero);
+    }
+
+    auto getter = builder.create<mlir::LLVM::LLVMFuncOp>(
+        loc, getterName,
+        mlir::LLVM::LLVMFunctionType::get(llvmPointerType, {llvmPointerType}),
+        mlir::LLVM::Linkage::Internal);
+    auto *entry = builder.createBlock(&getter.getBody(), {}, {llvmPointerType},
+                                      {loc});
+    mlir::Value stream = entry->getArgument(0);
+
+    mlir::Value handlePtr =
+        builder.create<mlir::LLVM::AddressOfOp>(loc, handle);
+    mlir::SmallString<128> nameBuffer(kernelModule.getName());
+    nameBuffer.append(kGpuBinaryStorageSuffix);
+    mlir::Value data = mlir::LLVM::createGlobalString(
+        loc, builder, nameBuffer.str(), binaryAttr.getValue(),
+        mlir::LLVM::Linkage::Internal);
+    auto size = builder.create<mlir::LLVM::ConstantOp>(
+        loc, llvmIndexType,
+        mlir::IntegerAttr::get(
+            llvmIndexType, static_cast<int64_t>(binaryAttr.getValue().size())));
+    // The name corresponds to the name of the kernel function.
+    auto name =
+        generateKernelNameConstant(moduleName, kernelName, loc, builder);
+    mlir::Value null = builder.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+    mlir::Value numSpecs = builder.create<mlir::LLVM::ConstantOp>(
+        loc, llvmIndexType, builder.getIntegerAttr(llvmIndexType, 0));
+    mlir::Value kernel =
+        kernelGetSpecializedCallBuilder
+            .create(loc, builder,
+                    {stream, handlePtr, data, size, name, null, null, numSpecs})
+            ->getResult(0);
+    builder.create<mlir::LLVM::ReturnOp>(loc, kernel);
+    return getter;
+  }
+
+  // Returns the kernel arguments marked with gpux.spec_id, with their ids.
+  llvm::SmallVector<std::pair<unsigned, uint32_t>>
+  getSpecializedArgs(imex::gpux::LaunchFuncOp launchOp) const {
+    llvm::SmallVector<std::pair<unsigned, uint32_t>> specArgs;
+    auto kernelFunc =
+        mlir::SymbolTable::lookupNearestSymbolFrom<mlir::gpu::GPUFuncOp>(
+            launchOp, launchOp.getKernel());
+    if (!kernelFunc)
+      return specArgs;
+    for (auto i : llvm::seq(0u, kernelFunc.getNumArguments())) {
+      if (auto specId = kernelFunc.getArgAttrOfType<mlir::IntegerAttr>(
+              i, kSpecIdAttrName))
+        specArgs.emplace_back(i, static_cast<uint32_t>(specId.getInt()));
+    }
+    return specArgs;
+  }
+
+  // Generates, once per kernel with specialized arguments, an internal
+  // function returning the kernel built for the given values of the
+  // specialization constants. The runtime keeps one module per tuple of
+  // values, and caches the kernel of each launch site in a slot global. The
+  // code is essentially:
+  //
+  // llvm.func internal @get_specialized_kernel(%stream, %slot, %ids, %values,
+  //                                            %n) {
+  //   %kernel = llvm.call @gpuKernelGetSpecialized(%stream, %slot,
+  //                                                @spirv_binary, size,
+  //                                                @kernel_name, %ids,
+  //                                                %values, %n)
+  //   llvm.return %kernel
+  // }
+  mlir::FailureOr<mlir::LLVM::LLVMFuncOp>
+  getOrCreateSpecializedKernelGetter(
+      imex::gpux::LaunchFuncOp launchOp,
+      mlir::ConversionPatternRewriter &builder) const {
     mlir::Location loc = launchOp.getLoc();
+    auto moduleName = launchOp.getKernelModuleName().getValue();
+    auto kernelName = launchOp.getKernelName().getValue();
+    std::string getterName = std::string(llvm::formatv(
+        "{0}_{1}_get_specialized_kernel", moduleName, kernelName));
+    auto module = launchOp->getParentOfType<mlir::ModuleOp>();
+    if (auto getter = module.lookupSymbol<mlir::LLVM::LLVMFuncOp>(getterName))
+      return getter;
 
-    // Create an LLVM global with SPIRV extracted from the kernel annotation
-    // and obtain a pointer to the first byte in it.
     auto kernelModule =
         mlir::SymbolTable::lookupNearestSymbolFrom<mlir::gpu::GPUModuleOp>(
             launchOp, launchOp.getKernelModuleName());
@@ -364,30 +808,153 @@ private:
       return mlir::failure();
     }
 
-    auto spirvBlob = binaryAttr.getValue();
+    mlir::OpBuilder::InsertionGuard guard(builder);
+    builder.setInsertionPointToEnd(module.getBody());
+    llvm::SmallVector<mlir::Type> argTypes = {llvmPointerType, llvmPointerType,
+                                              llvmPointerType, llvmPointerType,
+                                              llvmIndexType};
+    auto getter = builder.create<mlir::LLVM::LLVMFuncOp>(
+        loc, getterName,
+        mlir::LLVM::LLVMFunctionType::get(llvmPointerType, argTypes),
+        mlir::LLVM::Linkage::Internal);
+    llvm::SmallVector<mlir::Location> argLocs(argTypes.size(), loc);
+    auto *entry =
+        builder.createBlock(&getter.getBody(), {}, argTypes, argLocs);
+
     mlir::SmallString<128> nameBuffer(kernelModule.getName());
     nameBuffer.append(kGpuBinaryStorageSuffix);
     mlir::Value data = mlir::LLVM::createGlobalString(
-        loc, rewriter, nameBuffer.str(), binaryAttr.getValue(),
+        loc, builder, nameBuffer.str(), binaryAttr.getValue(),
         mlir::LLVM::Linkage::Internal);
-
-    auto size = rewriter.create<mlir::LLVM::ConstantOp>(
+    auto size = builder.create<mlir::LLVM::ConstantOp>(
         loc, llvmIndexType,
-        mlir::IntegerAttr::get(llvmIndexType,
-                               static_cast<int64_t>(spirvBlob.size())));
-
-    // loads the GPU module given the spirv data
-    auto module = moduleLoadCallBuilder.create(
-        loc, rewriter, {adaptor.getGpuxStream(), data, size});
-
-    // Get the function from the module. The name corresponds to the name of
-    // the kernel function.
-    auto kernelName = generateKernelNameConstant(
-        launchOp.getKernelModuleName().getValue(),
-        launchOp.getKernelName().getValue(), loc, rewriter);
-    auto function = kernelGetCallBuilder.create(
-        loc, rewriter,
-        {adaptor.getGpuxStream(), module->getResult(0), kernelName});
+        mlir::IntegerAttr::get(
+            llvmIndexType, static_cast<int64_t>(binaryAttr.getValue().size())));
+    auto name =
+        generateKernelNameConstant(moduleName, kernelName, loc, builder);
+    mlir::Value kernel =
+        kernelGetSpecializedCallBuilder
+            .create(loc, builder,
+                    {entry->getArgument(0), entry->getArgument(1), data, size,
+                     name, entry->getArgument(2), entry->getArgument(3),
+                     entry->getArgument(4)})
+            ->getResult(0);
+    builder.create<mlir::LLVM::ReturnOp>(loc, kernel);
+    return getter;
+  }
+
+  // Creates the global in which a launch site caches its specialized kernel.
+  mlir::LLVM::GlobalOp
+  createSpecializedKernelSlot(imex::gpux::LaunchFuncOp launchOp,
+                              mlir::ConversionPatternRewriter &rewriter) const {
+    mlir::Location loc = launchOp.getLoc();
+    auto module = launchOp->getParentOfType<mlir::ModuleOp>();
+    std::string slotName;
+    for (unsigned i = 0;; ++i) {
+      slotName = std::string(llvm::formatv(
+          "{0}_{1}_kernel_slot_{2}", launchOp.getKernelModuleName().getValue(),
+          launchOp.getKernelName().getValue(), i));
+      if (!module.lookupSymbol(slotName))
+        break;
+    }
+    mlir::OpBuilder::InsertionGuard guard(rewriter);
+    rewriter.setInsertionPointToEnd(module.getBody());
+    auto slot = rewriter.create<mlir::LLVM::GlobalOp>(
+        loc, llvmPointerType, /*isConstant=*/false,
+        mlir::LLVM::Linkage::Internal, slotName, mlir::Attribute());
+    rewriter.createBlock(&slot.getInitializerRegion());
+    mlir::Value zero =
+        rewriter.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+    rewriter.create<mlir::LLVM::ReturnOp>(loc, zero);
+    return slot;
+  }
+
+  // Stores the ids of the specialization constants and the values of the
+  // specialized kernel arguments in stack arrays, and returns the kernel
+  // built for these values. The kernel is cached per launch site, a launch
+  // with the values of the previous one does not look up the module again.
+  mlir::FailureOr<mlir::Value> createSpecializedKernel(
+      imex::gpux::LaunchFuncOp launchOp, OpAdaptor adaptor,
+      llvm::ArrayRef<std::pair<unsigned, uint32_t>> specArgs,
+      mlir::ConversionPatternRewriter &rewriter) const {
+    mlir::Location loc = launchOp.getLoc();
+    auto kernelParams = adaptor.getKernelOperands();
+    for (auto [argIndex, specId] : specArgs) {
+      auto type =
+          mlir::dyn_cast<mlir::IntegerType>(kernelParams[argIndex].getType());
+      if (!type || type.getWidth() == 1 || type.getWidth() > 64)
+        return rewriter.notifyMatchFailure(
+            launchOp, "specialized arguments must be integers or indices");
+    }
+
+    auto getter = getOrCreateSpecializedKernelGetter(launchOp, rewriter);
+    if (mlir::failed(getter))
+      return mlir::failure();
+    auto slot = createSpecializedKernelSlot(launchOp, rewriter);
+
+    auto count = static_cast<int64_t>(specArgs.size());
+    imex::AllocaInsertionPoint allocaHelper(launchOp);
+    auto [ids, values] = allocaHelper.insert(rewriter, [&]() {
+      auto size = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt64Type, rewriter.getI64IntegerAttr(count));
+      mlir::Value idsPtr = rewriter.create<mlir::LLVM::AllocaOp>(
+          loc, llvmPointerType, llvmInt32Type, size, 0);
+      mlir::Value valuesPtr = rewriter.create<mlir::LLVM::AllocaOp>(
+          loc, llvmPointerType, llvmInt64Type, size, 0);
+      return std::make_pair(idsPtr, valuesPtr);
+    });
+
+    for (auto [i, specArg] : llvm::enumerate(specArgs)) {
+      auto [argIndex, specId] = specArg;
+      mlir::Value value = kernelParams[argIndex];
+      if (value.getType().getIntOrFloatBitWidth() < 64)
+        value = rewriter.create<mlir::LLVM::SExtOp>(loc, llvmInt64Type, value);
+
+      auto index = static_cast<int32_t>(i);
+      mlir::Value id = rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt32Type, rewriter.getI32IntegerAttr(specId));
+      auto idPtr = rewriter.create<mlir::LLVM::GEPOp>(
+          loc, llvmPointerType, llvmInt32Type, ids,
+          mlir::ArrayRef<mlir::LLVM::GEPArg>{index});
+      rewriter.create<mlir::LLVM::StoreOp>(loc, id, idPtr);
+      auto valuePtr = rewriter.create<mlir::LLVM::GEPOp>(
+          loc, llvmPointerType, llvmInt64Type, values,
+          mlir::ArrayRef<mlir::LLVM::GEPArg>{index});
+      rewriter.create<mlir::LLVM::StoreOp>(loc, value, valuePtr);
+    }
+
+    mlir::Value numSpecs = rewriter.create<mlir::LLVM::ConstantOp>(
+        loc, llvmIndexType, rewriter.getIntegerAttr(llvmIndexType, count));
+    mlir::Value slotPtr = rewriter.create<mlir::LLVM::AddressOfOp>(loc, slot);
+    auto call = rewriter.create<mlir::LLVM::CallOp>(
+        loc, *getter,
+        mlir::ValueRange{adaptor.getGpuxStream(), slotPtr, ids, values,
+                         numSpecs});
+    return call->getResult(0);
+  }
+
+  mlir::LogicalResult
+  matchAndRewrite(imex::gpux::LaunchFuncOp launchOp, OpAdaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+
+    mlir::Location loc = launchOp.getLoc();
+
+    mlir::Value kernel;
+    auto specArgs = getSpecializedArgs(launchOp);
+    if (specArgs.empty()) {
+      auto getter = getOrCreateKernelGetter(launchOp, rewriter);
+      if (mlir::failed(getter))
+        return mlir::failure();
+      auto call = rewriter.create<mlir::LLVM::CallOp>(
+          loc, *getter, mlir::ValueRange{adaptor.getGpuxStream()});
+      kernel = call->getResult(0);
+    } else {
+      auto specialized =
+          createSpecializedKernel(launchOp, adaptor, specArgs, rewriter);
+      if (mlir::failed(specialized))
+        return mlir::failure();
+      kernel = *specialized;
+    }
 
     /////////////////////////////////////////////////////////////////////////
     // Create an array of struct containing all kernel parameters and inserts
@@ -502,9 +1069,26 @@ private:
         adaptor.getDynamicSharedMemorySize()
             ? adaptor.getDynamicSharedMemorySize()
             : zero;
+    // Async launches return a token and only wait for their dependencies.
+    if (launchOp.getAsyncToken()) {
+      auto [deps, numDeps] =
+          packTokens(launchOp, adaptor.getAsyncDependencies(), rewriter);
+      auto token = launchKernelAsyncCallBuilder.create(
+          loc, rewriter,
+          {adaptor.getGpuxStream(), kernel,
+           adaptor.getGridSizeX(), adaptor.getGridSizeY(),
+           adaptor.getGridSizeZ(), adaptor.getBlockSizeX(),
+           adaptor.getBlockSizeY(), adaptor.getBlockSizeZ(),
+           dynamicSharedMemorySize, paramsArrayVoidPtr, deps, numDeps});
+      rewriter.replaceOp(launchOp, token.getResults());
+      return mlir::success();
+    }
+
+    waitForTokens(launchOp, adaptor.getGpuxStream(),
+                  adaptor.getAsyncDependencies(), rewriter);
     launchKernelCallBuilder.create(
         loc, rewriter,
-        {adaptor.getGpuxStream(), function->getResult(0),
+        {adaptor.getGpuxStream(), kernel,
          adaptor.getGridSizeX(), adaptor.getGridSizeY(), adaptor.getGridSizeZ(),
          adaptor.getBlockSizeX(), adaptor.getBlockSizeY(),
          adaptor.getBlockSizeZ(), dynamicSharedMemorySize, paramsArrayVoidPtr});
@@ -536,6 +1120,45 @@ private:
       return mlir::failure();
 
     auto loc = op.getLoc();
+    auto getIndex = [&](std::optional<uint32_t> index) -> mlir::Value {
+      return rewriter.create<mlir::LLVM::ConstantOp>(
+          loc, llvmInt32Type, rewriter.getI32IntegerAttr(index.value_or(0)));
+    };
+
+    // A shared stream is cached in a module global, which the runtime sets
+    // on first use.
+    if (op.getShared()) {
+      auto slotName = std::string(llvm::formatv(
+          "gpux_shared_stream_{0}_{1}", op.getDeviceIndex().value_or(0),
+          op.getQueueIndex().value_or(0)));
+      auto slot = mod.lookupSymbol<mlir::LLVM::GlobalOp>(slotName);
+      if (!slot) {
+        mlir::OpBuilder::InsertionGuard guard(rewriter);
+        rewriter.setInsertionPointToEnd(mod.getBody());
+        slot = rewriter.create<mlir::LLVM::GlobalOp>(
+            loc, llvmPointerType, /*isConstant=*/false,
+            mlir::LLVM::Linkage::Internal, slotName, mlir::Attribute());
+        rewriter.createBlock(&slot.getInitializerRegion());
+        mlir::Value zero =
+            rewriter.create<mlir::LLVM::ZeroOp>(loc, llvmPointerType);
+        rewriter.create<mlir::LLVM::ReturnOp>(loc, zero);
+      }
+      mlir::Value slotPtr = rewriter.create<mlir::LLVM::AddressOfOp>(loc, slot);
+      auto res = sharedStreamGetCallBuilder.create(
+          loc, rewriter,
+          {slotPtr, getIndex(op.getDeviceIndex()),
+           getIndex(op.getQueueIndex())});
+      rewriter.replaceOp(op, res.getResults());
+      return mlir::success();
+    }
+
+    if (op.getDeviceIndex() || op.getQueueIndex()) {
+      auto res = streamCreateOnDeviceCallBuilder.create(
+          loc, rewriter,
+          {getIndex(op.getDeviceIndex()), getIndex(op.getQueueIndex())});
+      rewriter.replaceOp(op, res.getResults());
+      return mlir::success();
+    }
 
     // TODO: Pass nullptrs now for the current workflow where user is
     // not passing device and context. Add different streambuilders
@@ -562,6 +1185,14 @@ private:
   matchAndRewrite(imex::gpux::DestroyStreamOp op,
                   imex::gpux::DestroyStreamOp::Adaptor adaptor,
                   mlir::ConversionPatternRewriter &rewriter) const override {
+    // Shared streams live until program exit.
+    auto createOp =
+        op.getGpuxStream().getDefiningOp<imex::gpux::CreateStreamOp>();
+    if (createOp && createOp.getShared()) {
+      rewriter.eraseOp(op);
+      return mlir::success();
+    }
+
     auto loc = op.getLoc();
     auto res =
         streamDestroyCallBuilder.create(loc, rewriter, adaptor.getGpuxStream());
@@ -625,13 +1256,21 @@ void imex::populateGpuxToLLVMPatternsAndLegality(
       [llvmPointerType](imex::gpux::ContextType) -> mlir::Type {
         return llvmPointerType;
       });
+  // Async tokens are opaque handles of the runtime.
+  converter.addConversion(
+      [llvmPointerType](mlir::gpu::AsyncTokenType) -> mlir::Type {
+        return llvmPointerType;
+      });
 
   patterns.insert<
       // clang-format off
       ConvertGpuStreamCreatePattern,
       ConvertGpuStreamDestroyPattern,
       ConvertAllocOpToGpuRuntimeCallPattern,
-      ConvertDeallocOpToGpuRuntimeCallPattern
+      ConvertDeallocOpToGpuRuntimeCallPattern,
+      ConvertMemcpyOpToGpuRuntimeCallPattern,
+      ConvertWaitOpToGpuRuntimeCallPattern,
+      ConvertGraphOpToGpuRuntimeCallPattern
       // clang-format on
       >(converter);
 
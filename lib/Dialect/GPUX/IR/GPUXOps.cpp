@@ -45,7 +45,22 @@ void CreateStreamOp::build(::mlir::OpBuilder &odsBuilder,
                            std::optional<::mlir::Value> context) {
   CreateStreamOp::build(odsBuilder, odsState, odsBuilder.getType<StreamType>(),
                         device.value_or(mlir::Value{}),
-                        context.value_or(mlir::Value{}));
+                        context.value_or(mlir::Value{}),
+                        /*device_index=*/mlir::IntegerAttr(),
+                        /*queue_index=*/mlir::IntegerAttr(),
+                        /*shared=*/mlir::UnitAttr());
+}
+
+mlir::LogicalResult CreateStreamOp::verify() {
+  // The lowering selects the device either from the operands or from the
+  // indices, it cannot honor both.
+  if ((getDeviceIndex() || getQueueIndex()) && (getDevice() || getContext()))
+    return emitOpError(
+        "cannot have a device_index or queue_index with a device or context "
+        "operand");
+  if (getShared() && (getDevice() || getContext()))
+    return emitOpError("cannot be shared with a device or context operand");
+  return mlir::success();
 }
 
 void LaunchFuncOp::build(
@@ -87,6 +102,31 @@ mlir::StringAttr LaunchFuncOp::getKernelName() {
   return getKernel().getLeafReference();
 }
 
+mlir::LogicalResult GraphOp::verify() {
+  for (mlir::Operation &op : getBody().front()) {
+    mlir::Value stream;
+    bool isAsync = false;
+    if (auto launchOp = mlir::dyn_cast<LaunchFuncOp>(op)) {
+      stream = launchOp.getGpuxStream();
+      isAsync = launchOp.getAsyncToken() ||
+                !launchOp.getAsyncDependencies().empty();
+    } else if (auto memcpyOp = mlir::dyn_cast<MemcpyOp>(op)) {
+      stream = memcpyOp.getGpuxStream();
+      isAsync = memcpyOp.getAsyncToken() ||
+                !memcpyOp.getAsyncDependencies().empty();
+    } else if (mlir::isMemoryEffectFree(&op)) {
+      continue;
+    } else {
+      return op.emitOpError("is not allowed in a gpux.graph");
+    }
+    if (isAsync)
+      return op.emitOpError("must be synchronous in a gpux.graph");
+    if (stream != getGpuxStream())
+      return op.emitOpError("must use the stream of the enclosing gpux.graph");
+  }
+  return mlir::success();
+}
+
 } // namespace gpux
 } // namespace imex
 
@@ -809,19 +809,29 @@ struct InitTileOpPattern
         }
       }
 
-      if (vnni && transpose && elementSize < 32) {
+      if (transpose && elementSize < 32 && !vnni) {
+        return rewriter.notifyMatchFailure(op, "Invalid transpose.");
+      } else if (transpose && elementSize <= 32) {
+        // The hardware transposed block load works on 32-bit data. The block
+        // sizes are computed for the memory layout (i.e., the transposed
+        // shape) and swapped back afterwards. For narrower types (VNNI), the
+        // data is loaded as f32 so that transpose and VNNI packing are
+        // achieved by a single load.
         int factor = 32 / elementSize;
         vnni = false;
+        auto loadElemTy = elementSize < 32
+                              ? mlir::FloatType::getF32(getContext())
+                              : elemTy;
         llvm::SmallVector<int64_t, 2> innerBlock = getInnerBlockSizes<Load>(
-            op.getOperation(), mlir::FloatType::getF32(getContext()),
-            tileTy.getShape()[1], (tileTy.getShape()[0]) / factor,
-            this->uArchInterface, vnni, transpose);
+            op.getOperation(), loadElemTy, tileTy.getShape()[1],
+            (tileTy.getShape()[0]) / factor, this->uArchInterface, vnni,
+            transpose);
+        if (innerBlock.size() != 2)
+          return rewriter.notifyMatchFailure(
+              op, "Unsupported shape for transposed load.");
         std::swap(innerBlock[0], innerBlock[1]);
         innerBlock[0] *= factor;
         innerBlocks = mlir::DenseI64ArrayAttr::get(getContext(), innerBlock);
-
-      } else if (transpose && elementSize < 32) {
-        return rewriter.notifyMatchFailure(op, "Invalid transpose.");
       } else {
         innerBlocks = mlir::DenseI64ArrayAttr::get(
             getContext(),
@@ -10,9 +10,13 @@
 ///
 /// \file
 /// This file contains OptimizeTranspose pass. This pass detects and optimizes
-/// the xetile loads that are transposed and then used in a MMA operation as the
-/// B operand. These op patterns are rewritten to use the order attribute to
-/// merge the transpose and load operations in a single tile load operation.
+/// the xetile loads that are transposed. For 32-bit element types any
+/// transposed load is optimized, since the hardware supports transposed 2D
+/// block loads for 32-bit data. For 16-bit element types, only loads used in a
+/// MMA operation as the B operand are optimized; these are later lowered to a
+/// 32-bit transposed load which also performs the VNNI packing. These op
+/// patterns are rewritten to use the order attribute to merge the transpose
+/// and load operations in a single tile load operation.
 ///
 //===----------------------------------------------------------------------===//
 
@@ -135,13 +139,14 @@ struct LoadTileOpPattern final
     mlir::Value updatedSource;
     imex::xetile::TileType updatedTileTy;
     mlir::VectorType outVecTy;
-    // LoadTileOp is inside the ForOp. Therefore the source is
+    // If LoadTileOp is inside the ForOp, the source is
     // UnrealizedConversionCastOp produced by the ForOp signature conversion.
-    // TODO: direct uses of the InitTileOp should be supported i.e. more
-    // patterns.
+    // Otherwise, it directly uses the new InitTileOp.
     if (llvm::isa<mlir::UnrealizedConversionCastOp>(sourceOp)) {
       auto castOp = llvm::cast<mlir::UnrealizedConversionCastOp>(sourceOp);
       updatedSource = castOp.getInputs()[0];
+    } else if (llvm::isa<imex::xetile::InitTileOp>(sourceOp)) {
+      updatedSource = adaptor.getSource();
     } else {
       assert(false && "unsupported source op");
     }
@@ -286,11 +291,33 @@ public:
   bool contains(mlir::Operation *op) { return ops.count(op); }
 };
 
+// Helper function to check if the transposed value can be produced by a
+// transposed 2D block load. 32-bit element types are natively supported. For
+// 16-bit element types, the transpose is combined with the VNNI packing by
+// loading the data as 32-bit elements, which is only valid if the result is
+// used as the B operand of a tile_mma.
+static bool isSupportedTranspose(mlir::vector::TransposeOp transposeOp) {
+  auto elemBitWidth =
+      transposeOp.getSourceVectorType().getElementTypeBitWidth();
+  if (elemBitWidth == 32)
+    return true;
+  if (elemBitWidth != 16)
+    return false;
+  // Check if the transpose has only one user and that user is a TileMMAOp
+  if (!(transposeOp->hasOneUse() &&
+        llvm::isa<imex::xetile::TileMMAOp>(*transposeOp->user_begin())))
+    return false;
+  auto mmaOp = llvm::cast<imex::xetile::TileMMAOp>(*transposeOp->user_begin());
+  // Make sure the transpose is the second operand of the mma
+  return mmaOp.getB().getDefiningOp() == transposeOp;
+}
+
 // Helper function to analyze the def-use chain of initTileOps. Currently we
-// pattern match the following def-use chain as a candidate for transformation.
-// init_tile -> scf.for -> load_tile -> vector.transpose -> tile_mma
+// pattern match the following def-use chains as candidates for transformation.
+// init_tile -> scf.for -> load_tile -> vector.transpose -> (tile_mma)
 //                |
 //                -> update_tile_offset -> scf.yield
+// init_tile -> load_tile -> vector.transpose -> (tile_mma)
 void analyzeInitTileOps(mlir::Operation *op,
                         llvm::SmallVector<ProgSlice> &candidates) {
 
@@ -307,9 +334,13 @@ void analyzeInitTileOps(mlir::Operation *op,
       return mlir::WalkResult::skip();
     ops.push_back(initOp);
     auto user = *initOp->user_begin();
-    // InitTileOp must be consumed by a ForOp
+    // InitTileOp must be consumed by a LoadTileOp or a ForOp
     mlir::Operation *loadUser = nullptr, *updateOffsetUser = nullptr;
-    if (auto scfFor = llvm::dyn_cast_if_present<mlir::scf::ForOp>(user)) {
+    if (llvm::isa<imex::xetile::LoadTileOp>(user)) {
+      loadUser = user;
+      ops.push_back(user);
+    } else if (auto scfFor =
+                   llvm::dyn_cast_if_present<mlir::scf::ForOp>(user)) {
       auto argument = imex::getArgForOperand(scfFor, initOp.getResult());
       int userCount = 0;
       for (auto user : argument.getUsers()) {
@@ -337,23 +368,18 @@ void analyzeInitTileOps(mlir::Operation *op,
     auto transposeOp =
         llvm::cast<mlir::vector::TransposeOp>(*loadUser->user_begin());
     ops.push_back(transposeOp);
-    // Check if the transpose has only one user and that user is a TileMMAOp
-    if (!(transposeOp->hasOneUse() &&
-          llvm::isa<imex::xetile::TileMMAOp>(*transposeOp->user_begin())))
-      return mlir::WalkResult::skip();
-    auto mmaOp =
-        llvm::cast<imex::xetile::TileMMAOp>(*transposeOp->user_begin());
-    // Make sure the transpose is the second operand of the mma
-    if (mmaOp.getB().getDefiningOp() != transposeOp)
+    if (!isSupportedTranspose(transposeOp))
       return mlir::WalkResult::skip();
 
     // Check if update offset is consumed by a yield
-    if (!updateOffsetUser->hasOneUse())
-      return mlir::WalkResult::skip();
-    auto yieldOp = *updateOffsetUser->user_begin();
-    if (!llvm::isa<mlir::scf::YieldOp>(yieldOp))
-      return mlir::WalkResult::skip();
-    ops.push_back(yieldOp);
+    if (updateOffsetUser) {
+      if (!updateOffsetUser->hasOneUse())
+        return mlir::WalkResult::skip();
+      auto yieldOp = *updateOffsetUser->user_begin();
+      if (!llvm::isa<mlir::scf::YieldOp>(yieldOp))
+        return mlir::WalkResult::skip();
+      ops.push_back(yieldOp);
+    }
 
     // At this point, we have a candidate def-use chain for optimization.
     auto slice = ProgSlice::create(ops);
@@ -13,12 +13,16 @@
 //===----------------------------------------------------------------------===//
 
 #include "imex/ExecutionEngine/ImexRunnerUtils.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
-#include <random>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 // NOLINTBEGIN(*-identifier-naming)
 
@@ -33,18 +37,176 @@ void _mlir_ciface_fillResource1D(UnrankedMemRefType<T> *ptr, // NOLINT
   std::fill(Dptr.begin(), Dptr.end(), fill_val);
 }
 
+namespace {
+/// Counter-based random number generator. The value of an element only
+/// depends on the seed and on its row-major index in the memref, so a fill is
+/// reproducible whatever the number of threads and the strides. It is meant
+/// for test and benchmark inputs, not for statistics or cryptography.
+class CounterRandom {
+public:
+  /// Values are generated in blocks of this many indices. Blocks start at
+  /// multiples of the size, so they never cross a multiple of 2^32.
+  static constexpr int64_t BlockSize = 4096;
+
+  explicit CounterRandom(uint64_t seed) : seed(seed) {}
+
+  /// Writes uniform values in [0, 1) for the `count` indices from `begin`,
+  /// which must lie in a single block. The loop only uses 32-bit integer ops
+  /// and is vectorized by the compiler.
+  void uniform(int64_t begin, int64_t count, float *out) const {
+    uint32_t key = getKey(static_cast<uint64_t>(begin) >> 32);
+    uint32_t low = static_cast<uint32_t>(begin);
+    for (int64_t i = 0; i < count; ++i) {
+      uint32_t bits = mix((low + static_cast<uint32_t>(i)) ^ key);
+      out[i] = static_cast<float>(bits >> 8) * 0x1p-24f;
+    }
+  }
+
+private:
+  // lowbias32 by Chris Wellons, a bijective 32-bit integer hash.
+  static uint32_t mix(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+  }
+
+  // splitmix64 finalizer.
+  static uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  // Each seed and range of 2^32 indices gets its own key.
+  uint32_t getKey(uint64_t high) const {
+    return static_cast<uint32_t>(mix64(seed ^ mix64(high)));
+  }
+
+  uint64_t seed;
+};
+} // namespace
+
+/// Returns the largest value below `upper` that is still below it once
+/// converted to T, the bound of the values of a fill.
 template <typename T>
-void _mlir_ciface_fillResource1DRandom(UnrankedMemRefType<T> *ptr,
-                                       const float lower, const float upper,
-                                       const bool genInt) {
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_real_distribution<> dist(lower, upper);
+static float getLargestBelow(const float lower, const float upper) {
+  if (!(lower < upper))
+    return lower;
+  if constexpr (std::is_integral_v<T>)
+    return std::ceil(upper) - 1;
+  // Steps down over the floats that T rounds up to `upper`.
+  float value = std::nextafter(upper, lower);
+  while (value > lower && static_cast<float>(T(value)) >= upper)
+    value = std::nextafter(value, lower);
+  return value;
+}
 
+/// Fills the memref with uniform random values in [lower, upper), truncated
+/// to integers if `genInt` is set. The values only depend on `seed` and on
+/// the position of the elements. Large memrefs are filled by all hardware
+/// threads, each generating blocks of values with SIMD instructions.
+template <typename T>
+static void fillRandom(UnrankedMemRefType<T> *ptr, const float lower,
+                       const float upper, const bool genInt,
+                       const uint64_t seed) {
   DynamicMemRefType<T> Dptr = DynamicMemRefType<T>(*ptr);
-  for (DynamicMemRefIterator<T> i = Dptr.begin(); i != Dptr.end(); ++i) {
-    *i = T(genInt ? static_cast<int>(dist(gen)) : dist(gen));
+  int64_t rank = Dptr.rank;
+  T *data = Dptr.data + Dptr.offset;
+  int64_t numElements = 1;
+  bool contiguous = true;
+  for (int64_t d = rank - 1; d >= 0; --d) {
+    if (Dptr.sizes[d] != 1 && Dptr.strides[d] != numElements)
+      contiguous = false;
+    numElements *= Dptr.sizes[d];
   }
+  if (numElements <= 0)
+    return;
+
+  CounterRandom rng(seed);
+  const float scale = upper - lower;
+  // lower + value * scale may round up to upper.
+  const float largest = getLargestBelow<T>(lower, upper);
+  auto fillRange = [&](int64_t begin, int64_t end) {
+    // Coordinates of the current element, for strided memrefs.
+    std::vector<int64_t> coords(rank);
+    int64_t offset = 0;
+    if (!contiguous) {
+      int64_t index = begin;
+      for (int64_t d = rank - 1; d >= 0; --d) {
+        coords[d] = index % Dptr.sizes[d];
+        index /= Dptr.sizes[d];
+        offset += coords[d] * Dptr.strides[d];
+      }
+    }
+
+    float values[CounterRandom::BlockSize];
+    for (int64_t block = begin; block < end;
+         block += CounterRandom::BlockSize) {
+      int64_t count = std::min(CounterRandom::BlockSize, end - block);
+      rng.uniform(block, count, values);
+      for (int64_t i = 0; i < count; ++i) {
+        float value = lower + values[i] * scale;
+        value = genInt ? std::trunc(value) : value;
+        values[i] = std::min(value, largest);
+      }
+
+      if (contiguous) {
+        for (int64_t i = 0; i < count; ++i)
+          data[block + i] = T(values[i]);
+        continue;
+      }
+      for (int64_t i = 0; i < count; ++i) {
+        data[offset] = T(values[i]);
+        // Moves to the next element in row-major order.
+        for (int64_t d = rank - 1; d >= 0; --d) {
+          offset += Dptr.strides[d];
+          if (++coords[d] < Dptr.sizes[d])
+            break;
+          offset -= coords[d] * Dptr.strides[d];
+          coords[d] = 0;
+        }
+      }
+    }
+  };
+
+  // Threads get whole blocks of at least this many elements.
+  constexpr int64_t minElementsPerThread = 1 << 18;
+  int64_t numThreads =
+      std::min<int64_t>(std::max(1u, std::thread::hardware_concurrency()),
+                        numElements / minElementsPerThread);
+  if (numThreads <= 1) {
+    fillRange(0, numElements);
+    return;
+  }
+  int64_t numBlocks = (numElements + CounterRandom::BlockSize - 1) /
+                      CounterRandom::BlockSize;
+  int64_t chunk =
+      (numBlocks + numThreads - 1) / numThreads * CounterRandom::BlockSize;
+  std::vector<std::thread> threads;
+  for (int64_t begin = chunk; begin < numElements; begin += chunk)
+    threads.emplace_back(fillRange, begin,
+                         std::min(begin + chunk, numElements));
+  fillRange(0, std::min(chunk, numElements));
+  for (auto &thread : threads)
+    thread.join();
+}
+
+/// Fills the memref with reproducible random values, see fillRandom. Every
+/// call gets its own seed, derived from the number of calls before it, so the
+/// inputs of a test differ from each other but not from run to run. The seeds
+/// have the top bit set, they do not collide with the small explicit seeds of
+/// fillResourceRandom.
+template <typename T>
+void _mlir_ciface_fillResource1DRandom(UnrankedMemRefType<T> *ptr,
+                                       const float lower, const float upper,
+                                       const bool genInt) {
+  static std::atomic<uint64_t> numCalls{0};
+  uint64_t seed = (uint64_t(1) << 63) | numCalls.fetch_add(1);
+  fillRandom(ptr, lower, upper, genInt, seed);
 }
 
 template <typename T> void _mlir_ciface_printMemref(UnrankedMemRefType<T> *M) {
@@ -88,6 +250,26 @@ _mlir_ciface_fillResource1DRandomF16(UnrankedMemRefType<f16> *ptr,
   _mlir_ciface_fillResource1DRandom(ptr, lower, upper, genInt);
 }
 
+#define IMEX_FILL_RANDOM(suffix, T)                                            \
+  extern "C" void _mlir_ciface_fillResourceRandom##suffix(                     \
+      UnrankedMemRefType<T> *ptr, const float lower, const float upper,        \
+      const bool genInt, const int64_t seed) {                                 \
+    fillRandom(ptr, lower, upper, genInt, static_cast<uint64_t>(seed));        \
+  }
+
+/// Fills a memref of any rank and layout with random values uniformly
+/// distributed in [lower, upper), truncated to integers if genInt is set or
+/// for integer element types. Fills with the same seed give the same values.
+IMEX_FILL_RANDOM(BF16, bf16)
+IMEX_FILL_RANDOM(F16, f16)
+IMEX_FILL_RANDOM(F32, float)
+IMEX_FILL_RANDOM(F64, double)
+IMEX_FILL_RANDOM(I8, int8_t)
+IMEX_FILL_RANDOM(I16, int16_t)
+IMEX_FILL_RANDOM(I32, int32_t)
+IMEX_FILL_RANDOM(I64, int64_t)
+#undef IMEX_FILL_RANDOM
+
 extern "C" void _mlir_ciface_printMemrefBF16(UnrankedMemRefType<bf16> *M) {
   _mlir_ciface_printMemref(M);
 }
@@ -0,0 +1,411 @@
+//===- JitRunner.cpp - IMEX CPU execution driver ----------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the entry point of imex-cpu-runner. It parses an MLIR
+/// file in the LLVM dialect, translates it to LLVM IR, JIT compiles it with
+/// ORC and runs the entry point, like upstream mlir::JitRunnerMain. Unlike
+/// mlir::ExecutionEngine, the compile layer is given an on-disk object cache,
+/// so that repeated runs of an unchanged module skip the LLVM optimization
+/// pipeline and codegen.
+///
+//===----------------------------------------------------------------------===//
+
+#include "imex/ExecutionEngine/JitRunner.h"
+#include "imex/ExecutionEngine/ObjectCache.h"
+
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/ExecutionEngine/OptUtils.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Support/Timing.h"
+#include "mlir/Target/LLVMIR/Export.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <type_traits>
+
+using namespace mlir;
+
+namespace {
+/// The flags of upstream mlir-cpu-runner, plus the object cache directory.
+struct Options {
+  llvm::cl::opt<std::string> inputFilename{llvm::cl::Positional,
+                                           llvm::cl::desc("<input file>"),
+                                           llvm::cl::init("-")};
+  llvm::cl::opt<std::string> mainFuncName{
+      "e", llvm::cl::desc("The function to be called"),
+      llvm::cl::value_desc("<function name>"), llvm::cl::init("main")};
+  llvm::cl::opt<std::string> mainFuncType{
+      "entry-point-result",
+      llvm::cl::desc("Textual description of the function type to be called"),
+      llvm::cl::value_desc("f32 | i32 | i64 | void"), llvm::cl::init("f32")};
+
+  llvm::cl::OptionCategory optFlags{"opt-like flags"};
+
+  // CLI variables for -On options.
+  llvm::cl::opt<bool> optO0{"O0",
+                            llvm::cl::desc("Run opt passes and codegen at O0"),
+                            llvm::cl::cat(optFlags)};
+  llvm::cl::opt<bool> optO1{"O1",
+                            llvm::cl::desc("Run opt passes and codegen at O1"),
+                            llvm::cl::cat(optFlags)};
+  llvm::cl::opt<bool> optO2{"O2",
+                            llvm::cl::desc("Run opt passes and codegen at O2"),
+                            llvm::cl::cat(optFlags)};
+  llvm::cl::opt<bool> optO3{"O3",
+                            llvm::cl::desc("Run opt passes and codegen at O3"),
+                            llvm::cl::cat(optFlags)};
+
+  llvm::cl::OptionCategory clOptionsCategory{"linking options"};
+  llvm::cl::list<std::string> clSharedLibs{
+      "shared-libs", llvm::cl::desc("Libraries to link dynamically"),
+      llvm::cl::MiscFlags::CommaSeparated, llvm::cl::cat(clOptionsCategory)};
+
+  llvm::cl::opt<bool> hostSupportsJit{"host-supports-jit",
+                                      llvm::cl::desc("Report host JIT support"),
+                                      llvm::cl::Hidden};
+
+  llvm::cl::opt<std::string> objectCacheDir{
+      "object-cache-dir",
+      llvm::cl::desc("Directory keeping the compiled objects across runs. "
+                     "Defaults to $IMEX_OBJECT_CACHE_DIR, no cache if unset"),
+      llvm::cl::value_desc("<directory>"), llvm::cl::init("")};
+};
+
+// Same as in mlir::ExecutionEngine: libraries providing these functions
+// export their symbols to the JIT through the init function.
+using LibraryInitFn = void (*)(llvm::StringMap<void *> &);
+using LibraryDestroyFn = void (*)();
+constexpr const char *kLibraryInitFnName = "__mlir_execution_engine_init";
+constexpr const char *kLibraryDestroyFnName = "__mlir_execution_engine_destroy";
+
+/// A module compiled by the JIT, with the runtime libraries it links to.
+class JitModule {
+public:
+  static llvm::Expected<std::unique_ptr<JitModule>>
+  create(Operation *module, llvm::ArrayRef<std::string> sharedLibs,
+         std::optional<unsigned> optLevel, imex::DiskObjectCache *cache,
+         TimingScope &timing);
+
+  ~JitModule() {
+    // Run the global destructors of the module, then let the libraries shut
+    // down.
+    if (jit)
+      llvm::consumeError(jit->deinitialize(jit->getMainJITDylib()));
+    for (LibraryDestroyFn destroy : destroyFns)
+      destroy();
+  }
+
+  template <typename FnT> llvm::Expected<FnT> lookup(llvm::StringRef name) {
+    auto addr = jit->lookup(name);
+    if (!addr)
+      return addr.takeError();
+    return addr->toPtr<FnT>();
+  }
+
+private:
+  JitModule() = default;
+
+  std::unique_ptr<llvm::orc::LLJIT> jit;
+  llvm::SmallVector<LibraryDestroyFn> destroyFns;
+};
+} // namespace
+
+static llvm::Error makeStringError(const llvm::Twine &message) {
+  return llvm::make_error<llvm::StringError>(message.str(),
+                                             llvm::inconvertibleErrorCode());
+}
+
+llvm::Expected<std::unique_ptr<JitModule>>
+JitModule::create(Operation *module, llvm::ArrayRef<std::string> sharedLibs,
+                  std::optional<unsigned> optLevel,
+                  imex::DiskObjectCache *cache, TimingScope &timing) {
+  auto tmBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!tmBuilder)
+    return tmBuilder.takeError();
+  if (optLevel)
+    tmBuilder->setCodeGenOptLevel(
+        static_cast<llvm::CodeGenOptLevel>(*optLevel));
+  auto tm = tmBuilder->createTargetMachine();
+  if (!tm)
+    return tm.takeError();
+
+  auto translateTiming = timing.nest("Translate to LLVM IR");
+  auto ctx = std::make_unique<llvm::LLVMContext>();
+  auto llvmModule = translateModuleToLLVMIR(module, *ctx);
+  translateTiming.stop();
+  if (!llvmModule)
+    return makeStringError("could not translate MLIR module to LLVM IR");
+  llvmModule->setDataLayout((*tm)->createDataLayout());
+  llvmModule->setTargetTriple((*tm)->getTargetTriple().getTriple());
+
+  // The cache finds objects by module identifier. If the object is stored,
+  // the compile layer loads it instead of running codegen, and the
+  // optimization pipeline is skipped as well.
+  bool cached = false;
+  if (cache) {
+    auto key = imex::DiskObjectCache::getModuleKey(*llvmModule, **tm, optLevel);
+    cached = cache->contains(key);
+    llvmModule->setModuleIdentifier(key);
+  }
+  if (optLevel && !cached) {
+    auto optimizeTiming = timing.nest("LLVM optimization");
+    auto transformer = makeOptimizingTransformer(*optLevel, /*sizeLevel=*/0,
+                                                 /*targetMachine=*/tm->get());
+    if (auto err = transformer(llvmModule.get()))
+      return std::move(err);
+  }
+
+  std::unique_ptr<JitModule> result(new JitModule());
+  llvm::StringMap<void *> exportSymbols;
+  for (const std::string &libPath : sharedLibs) {
+    // Permanent libraries are searched for the symbols of the process.
+    std::string errorMessage;
+    auto lib = llvm::sys::DynamicLibrary::getPermanentLibrary(libPath.c_str(),
+                                                              &errorMessage);
+    if (!lib.isValid()) {
+      llvm::errs() << "Failed to load " << libPath << ": " << errorMessage
+                   << "\n";
+      continue;
+    }
+    void *initSym = lib.getAddressOfSymbol(kLibraryInitFnName);
+    void *destroySym = lib.getAddressOfSymbol(kLibraryDestroyFnName);
+    if (!initSym || !destroySym)
+      continue;
+    reinterpret_cast<LibraryInitFn>(initSym)(exportSymbols);
+    result->destroyFns.push_back(
+        reinterpret_cast<LibraryDestroyFn>(destroySym));
+  }
+
+  auto objectLinkingLayerCreator = [](llvm::orc::ExecutionSession &session,
+                                      const llvm::Triple &tt)
+      -> llvm::Expected<std::unique_ptr<llvm::orc::ObjectLayer>> {
+    auto objectLayer = std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(
+        session,
+        []() { return std::make_unique<llvm::SectionMemoryManager>(); });
+    if (tt.isOSBinFormatCOFF()) {
+      objectLayer->setOverrideObjectFlagsWithResponsibilityFlags(true);
+      objectLayer->setAutoClaimResponsibilityForObjectSymbols(true);
+    }
+    return objectLayer;
+  };
+  // The object cache hook of the compiler: objects are looked up before
+  // codegen and stored after it.
+  auto compileFunctionCreator = [cache](llvm::orc::JITTargetMachineBuilder jtmb)
+      -> llvm::Expected<
+          std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+    return std::make_unique<llvm::orc::ConcurrentIRCompiler>(std::move(jtmb),
+                                                             cache);
+  };
+
+  auto dataLayout = llvmModule->getDataLayout();
+  auto jit = llvm::orc::LLJITBuilder()
+                 .setJITTargetMachineBuilder(std::move(*tmBuilder))
+                 .setCompileFunctionCreator(compileFunctionCreator)
+                 .setObjectLinkingLayerCreator(objectLinkingLayerCreator)
+                 .setDataLayout(dataLayout)
+                 .create();
+  if (!jit)
+    return jit.takeError();
+  result->jit = std::move(*jit);
+
+  llvm::orc::JITDylib &mainJD = result->jit->getMainJITDylib();
+  auto generator =
+      llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          dataLayout.getGlobalPrefix());
+  if (!generator)
+    return generator.takeError();
+  mainJD.addGenerator(std::move(*generator));
+  if (!exportSymbols.empty()) {
+    llvm::orc::MangleAndInterner interner(
+        result->jit->getExecutionSession(), dataLayout);
+    llvm::orc::SymbolMap symbolMap;
+    for (auto &exportSymbol : exportSymbols)
+      symbolMap[interner(exportSymbol.getKey())] = {
+          llvm::orc::ExecutorAddr::fromPtr(exportSymbol.getValue()),
+          llvm::JITSymbolFlags::Exported};
+    if (auto err = mainJD.define(llvm::orc::absoluteSymbols(symbolMap)))
+      return std::move(err);
+  }
+
+  auto codegenTiming = timing.nest("Codegen");
+  if (auto err = result->jit->addIRModule(llvm::orc::ThreadSafeModule(
+          std::move(llvmModule), std::move(ctx))))
+    return std::move(err);
+  // Compiles the module, to run its global constructors.
+  if (auto err = result->jit->initialize(mainJD))
+    return std::move(err);
+  return std::move(result);
+}
+
+static OwningOpRef<ModuleOp> parseMLIRInput(llvm::StringRef inputFilename,
+                                            MLIRContext *context) {
+  std::string errorMessage;
+  auto file = openInputFile(inputFilename, &errorMessage);
+  if (!file) {
+    llvm::errs() << errorMessage << "\n";
+    return nullptr;
+  }
+  llvm::SourceMgr sourceMgr;
+  sourceMgr.AddNewSourceBuffer(std::move(file), llvm::SMLoc());
+  return parseSourceFile<ModuleOp>(sourceMgr, ParserConfig(context));
+}
+
+static std::optional<unsigned> getCommandLineOptLevel(Options &options) {
+  llvm::SmallVector<std::reference_wrapper<llvm::cl::opt<bool>>, 4> optFlags{
+      options.optO0, options.optO1, options.optO2, options.optO3};
+  for (unsigned j = 0; j < 4; ++j)
+    if (optFlags[j].get())
+      return j;
+  return std::nullopt;
+}
+
+// Checks that the entry point takes no arguments and returns `type`.
+static llvm::Error checkEntryPoint(Operation *module, llvm::StringRef name,
+                                   llvm::StringRef type) {
+  auto mainFunction = dyn_cast_or_null<LLVM::LLVMFuncOp>(
+      SymbolTable::lookupSymbolIn(module, name));
+  if (!mainFunction || mainFunction.isExternal())
+    return makeStringError("entry point not found");
+  auto functionType = mainFunction.getFunctionType();
+  if (functionType.getNumParams() != 0)
+    return makeStringError("function inputs not supported");
+
+  Type resultType = functionType.getReturnType();
+  bool compatible = false;
+  if (type == "void")
+    compatible = isa<LLVM::LLVMVoidType>(resultType);
+  else if (type == "i32")
+    compatible = resultType.isInteger(32);
+  else if (type == "i64")
+    compatible = resultType.isInteger(64);
+  else if (type == "f32")
+    compatible = resultType.isF32();
+  else
+    return makeStringError("unsupported main function type: " + type);
+  if (!compatible)
+    return makeStringError("only single " + type +
+                           " function result supported");
+  return llvm::Error::success();
+}
+
+template <typename Result>
+static llvm::Error execute(JitModule &jitModule, llvm::StringRef name) {
+  auto fn = jitModule.lookup<Result (*)()>(name);
+  if (!fn)
+    return fn.takeError();
+  if constexpr (std::is_void_v<Result>)
+    (*fn)();
+  else
+    llvm::outs() << (*fn)() << '\n';
+  return llvm::Error::success();
+}
+
+static llvm::Error compileAndExecute(Operation *module, Options &options,
+                                     TimingScope &timing) {
+  llvm::StringRef name = options.mainFuncName;
+  llvm::StringRef type = options.mainFuncType;
+  if (auto err = checkEntryPoint(module, name, type))
+    return err;
+
+  std::string cacheDir = options.objectCacheDir;
+  if (cacheDir.empty())
+    if (const char *env = std::getenv("IMEX_OBJECT_CACHE_DIR"))
+      cacheDir = env;
+  std::optional<imex::DiskObjectCache> cache;
+  if (!cacheDir.empty())
+    cache.emplace(cacheDir);
+
+  auto jitModule =
+      JitModule::create(module, options.clSharedLibs,
+                        getCommandLineOptLevel(options),
+                        cache ? &*cache : nullptr, timing);
+  if (!jitModule)
+    return jitModule.takeError();
+
+  auto executeTiming = timing.nest("Execute");
+
+  if (type == "void")
+    return execute<void>(**jitModule, name);
+  if (type == "i32")
+    return execute<int32_t>(**jitModule, name);
+  if (type == "i64")
+    return execute<int64_t>(**jitModule, name);
+  return execute<float>(**jitModule, name);
+}
+
+int imex::JitRunnerMain(int argc, char **argv,
+                        const DialectRegistry &registry,
+                        JitRunnerConfig config) {
+  Options options;
+  registerDefaultTimingManagerCLOptions();
+  llvm::cl::ParseCommandLineOptions(argc, argv, "IMEX CPU execution driver\n");
+
+  if (options.hostSupportsJit) {
+    auto j = llvm::orc::LLJITBuilder().create();
+    if (j)
+      llvm::outs() << "true\n";
+    else {
+      llvm::consumeError(j.takeError());
+      llvm::outs() << "false\n";
+    }
+    return 0;
+  }
+
+  // With --mlir-timing, the report splits the time between parsing, the
+  // transformation, LLVM optimization, codegen and execution.
+  DefaultTimingManager tm;
+  applyDefaultTimingManagerCLOptions(tm);
+  TimingScope timing = tm.getRootScope();
+
+  MLIRContext context(registry);
+  auto parseTiming = timing.nest("Parse");
+  auto m = parseMLIRInput(options.inputFilename, &context);
+  parseTiming.stop();
+  if (!m) {
+    llvm::errs() << "could not parse the input IR\n";
+    return EXIT_FAILURE;
+  }
+
+  if (config.mlirTransformer) {
+    auto transformTiming = timing.nest("Passes");
+    if (failed(config.mlirTransformer(m.get(), transformTiming)))
+      return EXIT_FAILURE;
+  }
+
+  int exitCode = EXIT_SUCCESS;
+  llvm::handleAllErrors(compileAndExecute(m.get(), options, timing),
+                        [&exitCode](const llvm::ErrorInfoBase &info) {
+                          llvm::errs() << "Error: ";
+                          info.log(llvm::errs());
+                          llvm::errs() << '\n';
+                          exitCode = EXIT_FAILURE;
+                        });
+  return exitCode;
+}
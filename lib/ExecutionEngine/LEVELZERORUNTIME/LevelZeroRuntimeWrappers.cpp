@@ -16,7 +16,6 @@
 #include <array>
 #include <atomic>
 #include <cassert>
-#include <cfloat>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -25,9 +24,16 @@
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <string>
 #include <tuple>
 #include <vector>
 
+#include "imex/ExecutionEngine/CachingAllocator.h"
+#include "imex/ExecutionEngine/KernelBinaryCache.h"
+#include "imex/ExecutionEngine/KernelProfiling.h"
+#include "imex/ExecutionEngine/SpecConstants.h"
+#include "imex/ExecutionEngine/TraceRecorder.h"
+
 #include <level_zero/ze_api.h>
 
 #ifdef _WIN32
@@ -64,16 +70,61 @@ inline void checkResult(ze_result_t res, const char *func) {
 
 struct SpirvModule {
   ze_module_handle_t module = nullptr;
+  // Kernels created from the module, by name.
+  std::map<std::string, ze_kernel_handle_t> kernels;
   ~SpirvModule();
 };
 
 namespace {
-// Create a Map for the spirv module lookup
-std::map<const void *, SpirvModule> moduleCache;
+// Create a Map for the spirv module lookup, one module per context, device,
+// SPIR-V binary and specialization.
+using ModuleKey = std::tuple<ze_context_handle_t, ze_device_handle_t,
+                             const void *, imex::SpecConstants>;
+std::map<ModuleKey, SpirvModule> moduleCache;
+// Map from module handle to its entry in moduleCache, for the kernel lookup.
+std::map<ze_module_handle_t, SpirvModule *> moduleHandles;
+// Ids of the live contexts. A handle may be reused by the driver once its
+// context is destroyed, the id of a context is never reused.
+std::map<ze_context_handle_t, uint64_t> contextIds;
+uint64_t nextContextId = 1;
 std::mutex mutexLock;
+
+uint64_t registerContext(ze_context_handle_t context) {
+  std::lock_guard<std::mutex> lock(mutexLock);
+  auto it = contextIds.emplace(context, nextContextId).first;
+  if (it->second == nextContextId)
+    ++nextContextId;
+  return it->second;
+}
+
+// Destroys the modules and kernels of `context` before it is destroyed.
+void releaseContext(ze_context_handle_t context) {
+  std::lock_guard<std::mutex> lock(mutexLock);
+  contextIds.erase(context);
+  for (auto it = moduleCache.begin(); it != moduleCache.end();) {
+    if (std::get<0>(it->first) != context) {
+      ++it;
+      continue;
+    }
+    moduleHandles.erase(it->second.module);
+    it = moduleCache.erase(it);
+  }
+}
+
+// Cached kernels are shared by all launches. Their group size and arguments
+// are set right before the launch, so concurrent launches of the same kernel
+// are serialized. Kernels are spread over a few locks by handle.
+std::mutex kernelLocks[16];
+
+std::mutex &getKernelLock(ze_kernel_handle_t kernel) {
+  auto hash = std::hash<ze_kernel_handle_t>()(kernel);
+  return kernelLocks[hash % std::size(kernelLocks)];
+}
 } // namespace
 
 SpirvModule::~SpirvModule() {
+  for (auto &it : kernels)
+    CHECK_ZE_RESULT(zeKernelDestroy(it.second));
   CHECK_ZE_RESULT(zeModuleDestroy(SpirvModule::module));
 }
 
@@ -97,8 +148,10 @@ template <typename T> size_t countUntil(T *ptr, T &&elem) {
   return static_cast<size_t>(curr - ptr);
 }
 
+// Returns the device `deviceIndex` among the devices of type `deviceType`.
 static std::pair<ze_driver_handle_t, ze_device_handle_t>
-getDriverAndDevice(ze_device_type_t deviceType = ZE_DEVICE_TYPE_GPU) {
+getDriverAndDevice(ze_device_type_t deviceType = ZE_DEVICE_TYPE_GPU,
+                   uint32_t deviceIndex = 0) {
 
   CHECK_ZE_RESULT(zeInit(ZE_INIT_FLAG_GPU_ONLY));
   uint32_t driverCount = 0;
@@ -119,7 +172,7 @@ getDriverAndDevice(ze_device_type_t deviceType = ZE_DEVICE_TYPE_GPU) {
     for (uint32_t d = 0; d < deviceCount; ++d) {
       ze_device_properties_t device_properties = {};
       CHECK_ZE_RESULT(zeDeviceGetProperties(devices[d], &device_properties));
-      if (deviceType == device_properties.type) {
+      if (deviceType == device_properties.type && deviceIndex-- == 0) {
         auto driver = allDrivers[i];
         auto device = devices[d];
         return {driver, device};
@@ -129,90 +182,363 @@ getDriverAndDevice(ze_device_type_t deviceType = ZE_DEVICE_TYPE_GPU) {
   throw std::runtime_error("getDevice failed");
 }
 
-#define _IMEX_PROFILING_TRAITS_SPEC(Desc)                                      \
-  struct Desc {};
+// Tracks the commands submitted to the asynchronous command list of a queue.
+// Every command signals an event from host visible event pools, which grow
+// on demand. Commands are identified by a sequence number that is handed out
+// to the program as async token. A token whose command is no longer tracked
+// has completed, the null token is always complete. Events are reset and
+// reused once the host has synchronized with all submitted commands.
+struct CommandTracker {
+  static constexpr uint32_t PoolSize = 256;
+
+  ze_context_handle_t zeContext = nullptr;
+  ze_device_handle_t zeDevice = nullptr;
+  std::vector<ze_event_pool_handle_t> pools;
+  std::vector<ze_event_handle_t> freeEvents;
+  // Events signaled since the last full synchronization.
+  std::vector<ze_event_handle_t> usedEvents;
+  // Commands which may still be running, by sequence number.
+  std::map<uintptr_t, ze_event_handle_t> pending;
+  uintptr_t nextSeq = 1;
+  // When tracing with device timestamps, the trace events of the commands
+  // signaling each event, completed once the timestamps are available.
+  bool deviceTimestamps = false;
+  uint32_t traceTrack = 0;
+  uint64_t timestampMask = 0;
+  uint64_t timerResolution = 0;
+  std::vector<std::pair<ze_event_handle_t, imex::TraceEvent>> traced;
+
+  ~CommandTracker() { release(); }
+
+  void init(ze_context_handle_t context, ze_device_handle_t device) {
+    zeContext = context;
+    zeDevice = device;
+    auto &recorder = imex::TraceRecorder::get();
+    if (!recorder.isEnabled())
+      return;
+    traceTrack = recorder.createDeviceTrack();
+    if (recorder.useHostTimer())
+      return;
+    ze_device_properties_t deviceProperties{};
+    deviceProperties.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+    CHECK_ZE_RESULT(zeDeviceGetProperties(zeDevice, &deviceProperties));
+    timestampMask = (1ULL << deviceProperties.kernelTimestampValidBits) - 1ULL;
+    timerResolution = deviceProperties.timerResolution;
+    deviceTimestamps = true;
+  }
 
-namespace imex {
-namespace profiling {
-// defining two types representing kernel start and kernel end
-_IMEX_PROFILING_TRAITS_SPEC(command_start)
-_IMEX_PROFILING_TRAITS_SPEC(command_end)
-} // namespace profiling
-} // namespace imex
+  // Destroys all events, they must not be in use anymore.
+  void release() {
+    for (auto event : freeEvents)
+      CHECK_ZE_RESULT(zeEventDestroy(event));
+    for (auto event : usedEvents)
+      CHECK_ZE_RESULT(zeEventDestroy(event));
+    for (auto pool : pools)
+      CHECK_ZE_RESULT(zeEventPoolDestroy(pool));
+    freeEvents.clear();
+    usedEvents.clear();
+    pools.clear();
+    pending.clear();
+  }
 
-// A Timestamp event pool management class. It currently simply represents
-// a event pool with fixed 256 slots. Currently for each run we just need
-// one timing event, but we definity need a sophisticated event system in
-// the future for programs with multiple kernels.
-struct EventPool {
-  ze_event_pool_handle_t zeEventPool;
+  ze_event_handle_t acquire() {
+    if (freeEvents.empty()) {
+      ze_event_pool_flags_t flags = ZE_EVENT_POOL_FLAG_HOST_VISIBLE;
+      if (deviceTimestamps)
+        flags |= ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP;
+      ze_event_pool_desc_t poolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                       nullptr, flags, PoolSize};
+      ze_event_pool_handle_t pool;
+      CHECK_ZE_RESULT(
+          zeEventPoolCreate(zeContext, &poolDesc, 0, nullptr, &pool));
+      pools.push_back(pool);
+      for (uint32_t i = 0; i < PoolSize; ++i) {
+        ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, i,
+                                     ZE_EVENT_SCOPE_FLAG_HOST, 0};
+        ze_event_handle_t event;
+        CHECK_ZE_RESULT(zeEventCreate(pool, &eventDesc, &event));
+        freeEvents.push_back(event);
+      }
+    }
+    auto event = freeEvents.back();
+    freeEvents.pop_back();
+    usedEvents.push_back(event);
+    return event;
+  }
 
-  EventPool(ze_context_handle_t zeContext_) {
-    ze_event_pool_desc_t tsEventPoolDesc = {
-        ZE_STRUCTURE_TYPE_EVENT_POOL_DESC, nullptr,
-        ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP, 256};
-    CHECK_ZE_RESULT(zeEventPoolCreate(zeContext_, &tsEventPoolDesc, 0, nullptr,
-                                      &zeEventPool));
+  // Registers a command signaling `event` and returns its token.
+  void *record(ze_event_handle_t event) {
+    pending.emplace(nextSeq, event);
+    return reinterpret_cast<void *>(nextSeq++);
+  }
+
+  // Adds the command signaling `event`, submitted at `submitTime`, to the
+  // trace. With the host timer the command is waited for, otherwise its
+  // device timestamps are read once the host synchronizes with it.
+  void trace(ze_event_handle_t event, uint64_t submitTime,
+             imex::TraceEvent traceEvent) {
+    traceEvent.deviceTrack = traceTrack;
+    if (deviceTimestamps) {
+      traced.emplace_back(event, std::move(traceEvent));
+      return;
+    }
+    CHECK_ZE_RESULT(zeEventHostSynchronize(event, UINT64_MAX));
+    imex::TraceRecorder::get().recordSince(std::move(traceEvent), submitTime);
+  }
+
+  // Records the traced commands, which must have completed. Device
+  // timestamps are converted to host time relative to the current time of
+  // both clocks; they wrap around, but not within the lifetime of an event.
+  void flushTraces() {
+    if (traced.empty())
+      return;
+    // The host timestamp of the driver may use another clock than the trace.
+    uint64_t driverHostTime, deviceTime;
+    CHECK_ZE_RESULT(zeDeviceGetGlobalTimestamps(zeDevice, &driverHostTime,
+                                                &deviceTime));
+    uint64_t hostTime = imex::TraceRecorder::now();
+    for (auto &it : traced) {
+      ze_kernel_timestamp_result_t tsResult;
+      CHECK_ZE_RESULT(zeEventQueryKernelTimestamp(it.first, &tsResult));
+      uint64_t start = tsResult.global.kernelStart;
+      uint64_t end = tsResult.global.kernelEnd;
+      auto &traceEvent = it.second;
+      traceEvent.start =
+          hostTime - ((deviceTime - start) & timestampMask) * timerResolution;
+      traceEvent.duration = ((end - start) & timestampMask) * timerResolution;
+      imex::TraceRecorder::get().record(std::move(traceEvent));
+    }
+    traced.clear();
+  }
+
+  // Returns the events of the commands in flight among `tokens`, or of all
+  // commands in flight if `tokens` is null.
+  std::vector<ze_event_handle_t> getEvents(void **tokens, size_t numTokens) {
+    std::vector<ze_event_handle_t> events;
+    if (!tokens) {
+      for (auto &it : pending)
+        events.push_back(it.second);
+      return events;
+    }
+    for (size_t i = 0; i < numTokens; ++i) {
+      auto it = pending.find(reinterpret_cast<uintptr_t>(tokens[i]));
+      if (it != pending.end())
+        events.push_back(it->second);
+    }
+    return events;
+  }
+
+  // Blocks the host until the commands of `tokens` have completed.
+  void wait(void **tokens, size_t numTokens) {
+    for (size_t i = 0; i < numTokens; ++i) {
+      auto it = pending.find(reinterpret_cast<uintptr_t>(tokens[i]));
+      if (it == pending.end())
+        continue;
+      CHECK_ZE_RESULT(zeEventHostSynchronize(it->second, UINT64_MAX));
+      pending.erase(it);
+    }
+  }
+
+  // Returns the sequence number of the last command submitted.
+  uintptr_t lastSeq() const { return nextSeq - 1; }
+
+  // Returns true if all commands up to `seq` have completed.
+  bool isComplete(uintptr_t seq) {
+    while (!pending.empty() && pending.begin()->first <= seq) {
+      ze_result_t res = zeEventQueryStatus(pending.begin()->second);
+      if (res == ZE_RESULT_NOT_READY)
+        return false;
+      CHECK_ZE_RESULT(res);
+      pending.erase(pending.begin());
+    }
+    return true;
+  }
+
+  // Blocks the host until all commands up to `seq` have completed.
+  void waitUntil(uintptr_t seq) {
+    while (!pending.empty() && pending.begin()->first <= seq) {
+      CHECK_ZE_RESULT(
+          zeEventHostSynchronize(pending.begin()->second, UINT64_MAX));
+      pending.erase(pending.begin());
+    }
   }
 
-  ~EventPool() { CHECK_ZE_RESULT(zeEventPoolDestroy(zeEventPool)); }
+  // Blocks the host until all commands have completed and recycles events.
+  void waitAll() {
+    for (auto &it : pending)
+      CHECK_ZE_RESULT(zeEventHostSynchronize(it.second, UINT64_MAX));
+    pending.clear();
+    flushTraces();
+    for (auto event : usedEvents) {
+      CHECK_ZE_RESULT(zeEventHostReset(event));
+      freeEvents.push_back(event);
+    }
+    usedEvents.clear();
+  }
 };
 
-// A wrapper to ze_event_handle_t providing timestamp queries
-class Event {
-private:
-  uint64_t zeTimestampMaxValue_;
-  uint64_t zeTimerResolution_;
+// Device and shared USM allocations of a context, for the memory pool.
+struct L0MemoryBackend {
+  ze_context_handle_t zeContext = nullptr;
+  ze_device_handle_t zeDevice = nullptr;
+
+  // Returns null if the device is out of memory.
+  void *allocate(size_t size, size_t alignment, bool isShared) {
+    void *ret = nullptr;
+    ze_device_mem_alloc_desc_t devDesc = {};
+    devDesc.stype = ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC;
+    ze_result_t res;
+    if (isShared) {
+      ze_host_mem_alloc_desc_t hostDesc = {};
+      hostDesc.stype = ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC;
+      res = zeMemAllocShared(zeContext, &devDesc, &hostDesc, size, alignment,
+                             zeDevice, &ret);
+    } else {
+      devDesc.flags = ZE_DEVICE_MEM_ALLOC_FLAG_BIAS_INITIAL_PLACEMENT;
+      res = zeMemAllocDevice(zeContext, &devDesc, size, alignment, zeDevice,
+                             &ret);
+    }
+    if (res == ZE_RESULT_ERROR_OUT_OF_DEVICE_MEMORY ||
+        res == ZE_RESULT_ERROR_OUT_OF_HOST_MEMORY)
+      return nullptr;
+    CHECK_ZE_RESULT(res);
+    return ret;
+  }
 
-public:
-  ze_event_handle_t zeEvent;
+  void deallocate(void *ptr) { CHECK_ZE_RESULT(zeMemFree(zeContext, ptr)); }
+};
 
-  Event(ze_context_handle_t zeContext_, ze_device_handle_t zeDevice_) {
-    static EventPool pool(zeContext_);
+// Utility to discover the Global memory cache (L3) size of the device
+static size_t getGlobalMemoryCacheSize(ze_device_handle_t zeDevice) {
+  static constexpr unsigned MaxPropertyEntries = 16;
+  uint32_t CachePropCount = MaxPropertyEntries;
+  ze_device_cache_properties_t CacheProperties[MaxPropertyEntries];
+  for (uint32_t i = 0; i < MaxPropertyEntries; ++i) {
+    CacheProperties[i].stype = ZE_STRUCTURE_TYPE_DEVICE_CACHE_PROPERTIES;
+    CacheProperties[i].pNext = nullptr;
+  }
+  CHECK_ZE_RESULT(
+      zeDeviceGetCacheProperties(zeDevice, &CachePropCount, CacheProperties));
+  size_t globaMemoryCacheSize = 0;
+  for (uint32_t i = 0; i < CachePropCount; ++i) {
+    // find largest cache that is not user-controlled
+    if ((CacheProperties[i].flags &
+         ZE_DEVICE_CACHE_PROPERTY_FLAG_USER_CONTROL) != 0u) {
+      continue;
+    }
+    if (globaMemoryCacheSize < CacheProperties[i].cacheSize) {
+      globaMemoryCacheSize = CacheProperties[i].cacheSize;
+    }
+  }
+  return globaMemoryCacheSize;
+}
 
-    // timestamp and timer resolution is a device properties.
-    // They are required to compute the final wall time.
+// Times kernels for IMEX_ENABLE_PROFILING. The device properties, the cache
+// flush buffer and the timestamp event are created by the first profiled
+// launch of a queue and reused by later ones, so profiling many kernels costs
+// no more than the timed runs.
+struct KernelProfiler {
+  imex::KernelProfilingOptions options{1000};
+  bool initialized = false;
+  uint64_t timestampMask = 0;
+  uint64_t timerResolution = 0;
+  size_t cacheSize = 0;
+  void *flushBuffer = nullptr;
+  ze_event_pool_handle_t zeEventPool = nullptr;
+  // Signaled by every timed run, and reset for the next one.
+  ze_event_handle_t zeEvent = nullptr;
+
+  void init(ze_context_handle_t zeContext, ze_device_handle_t zeDevice,
+            L0MemoryBackend &backend) {
+    if (initialized)
+      return;
+    initialized = true;
+
+    // Timestamps and the timer resolution are device properties. They are
+    // required to compute the execution time.
     ze_device_properties_t deviceProperties{};
     deviceProperties.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
-    CHECK_ZE_RESULT(zeDeviceGetProperties(zeDevice_, &deviceProperties));
-    zeTimestampMaxValue_ =
-        ((1ULL << deviceProperties.kernelTimestampValidBits) - 1ULL);
-    zeTimerResolution_ = deviceProperties.timerResolution;
-
-    ze_event_desc_t eventDesc = {
-        ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr,
-        0, // index
-        0, // no additional memory/cache coherency required on signal
-        0  // no additional memory/cache coherency required on wait
-    };
-    CHECK_ZE_RESULT(zeEventCreate(pool.zeEventPool, &eventDesc, &zeEvent));
-  }
-
-  // query the kernel start or end (specified via Param) timestamp
-  template <typename Param> uint64_t get_profiling_info() {
-    ze_kernel_timestamp_result_t tsResult;
-    CHECK_ZE_RESULT(zeEventQueryKernelTimestamp(zeEvent, &tsResult));
+    CHECK_ZE_RESULT(zeDeviceGetProperties(zeDevice, &deviceProperties));
+    timestampMask = (1ULL << deviceProperties.kernelTimestampValidBits) - 1ULL;
+    timerResolution = deviceProperties.timerResolution;
 
-    if constexpr (std::is_same_v<Param, imex::profiling::command_start>) {
-      uint64_t startTime =
-          (tsResult.global.kernelStart & zeTimestampMaxValue_) *
-          zeTimerResolution_;
-      return startTime;
+    // Before each run we need to flush the L3 cache (global memory cache) to
+    // make sure each profiling run has the same cache state. This is done by
+    // writing 'zero' to a global device memory buffer twice the size of the
+    // L3 cache. The buffer is device-only, it removes the possiblity of
+    // accidentally doing the flush in the host-side.
+    if (options.flushCache) {
+      cacheSize = getGlobalMemoryCacheSize(zeDevice);
+      flushBuffer = backend.allocate(2 * cacheSize, 64, false);
+      if (!flushBuffer)
+        throw std::runtime_error("Out of device memory");
     }
 
-    if constexpr (std::is_same_v<Param, imex::profiling::command_end>) {
-      uint64_t startTime = tsResult.global.kernelStart & zeTimestampMaxValue_;
-      uint64_t endTime = tsResult.global.kernelEnd & zeTimestampMaxValue_;
+    ze_event_pool_desc_t poolDesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC,
+                                     nullptr,
+                                     ZE_EVENT_POOL_FLAG_KERNEL_TIMESTAMP, 1};
+    CHECK_ZE_RESULT(
+        zeEventPoolCreate(zeContext, &poolDesc, 0, nullptr, &zeEventPool));
+    ze_event_desc_t eventDesc = {ZE_STRUCTURE_TYPE_EVENT_DESC, nullptr, 0, 0,
+                                 0};
+    CHECK_ZE_RESULT(zeEventCreate(zeEventPool, &eventDesc, &zeEvent));
+  }
 
-      if (endTime < startTime)
-        endTime += zeTimestampMaxValue_;
+  void release(L0MemoryBackend &backend) {
+    if (flushBuffer)
+      backend.deallocate(flushBuffer);
+    if (zeEvent)
+      CHECK_ZE_RESULT(zeEventDestroy(zeEvent));
+    if (zeEventPool)
+      CHECK_ZE_RESULT(zeEventPoolDestroy(zeEventPool));
+    flushBuffer = nullptr;
+    zeEvent = nullptr;
+    zeEventPool = nullptr;
+    initialized = false;
+  }
 
-      endTime *= zeTimerResolution_;
-      return endTime;
-    }
+  // Returns the execution time in milliseconds of the run that signaled the
+  // event, and resets the event for the next run.
+  double takeDuration() {
+    ze_kernel_timestamp_result_t tsResult;
+    CHECK_ZE_RESULT(zeEventQueryKernelTimestamp(zeEvent, &tsResult));
+    CHECK_ZE_RESULT(zeEventHostReset(zeEvent));
+    uint64_t start = tsResult.global.kernelStart;
+    uint64_t end = tsResult.global.kernelEnd;
+    return double(((end - start) & timestampMask) * timerResolution) / 1e6;
+  }
+};
+
+// A command issued between gpuGraphBegin and gpuGraphEnd. Kernel arguments
+// are copied, their storage does not outlive the launch call.
+struct GraphCommand {
+  enum Kind { Launch, Copy, Barrier };
+
+  Kind kind = Barrier;
+  ze_kernel_handle_t kernel = nullptr;
+  // Group counts followed by group sizes.
+  std::array<uint32_t, 6> dims = {};
+  size_t sharedMemBytes = 0;
+  std::vector<std::vector<char>> args;
+  void *dst = nullptr;
+  void *src = nullptr;
+  size_t size = 0;
+
+  bool operator==(const GraphCommand &rhs) const {
+    return std::tie(kind, kernel, dims, sharedMemBytes, args, dst, src, size) ==
+           std::tie(rhs.kind, rhs.kernel, rhs.dims, rhs.sharedMemBytes,
+                    rhs.args, rhs.dst, rhs.src, rhs.size);
   }
 
-  ~Event() { CHECK_ZE_RESULT(zeEventDestroy(zeEvent)); }
+  bool operator!=(const GraphCommand &rhs) const { return !(*this == rhs); }
+};
+
+// The commands of a gpux.graph recorded into a regular command list. Level
+// Zero copies kernel arguments when a launch is appended, so the list is
+// replayed as long as the commands match and recorded again otherwise.
+struct CommandGraph {
+  std::vector<GraphCommand> commands;
+  ze_command_list_handle_t zeCommandList = nullptr;
 };
 
 struct GPUL0QUEUE {
@@ -220,44 +546,60 @@ struct GPUL0QUEUE {
   ze_driver_handle_t zeDriver_ = nullptr;
   ze_device_handle_t zeDevice_ = nullptr;
   ze_context_handle_t zeContext_ = nullptr;
+  // Identifies the context in the kernel caches of the launch sites.
+  uint64_t contextId_ = 0;
   ze_command_list_handle_t zeCommandList_ = nullptr;
-
-  GPUL0QUEUE() {
-    auto driverAndDevice = getDriverAndDevice();
+  // Null if the device has no copy engine.
+  ze_command_list_handle_t zeCopyCommandList_ = nullptr;
+  // Commands are submitted asynchronously, their dependencies are expressed
+  // with events.
+  CommandTracker tracker_;
+  // Freed buffers are cached and reused once the commands submitted before
+  // the free have completed.
+  imex::CachingAllocator<L0MemoryBackend> pool_;
+  std::mutex mutex_;
+  // Graphs are recorded into regular command lists, which are executed on a
+  // command queue created on first use.
+  uint32_t queueOrdinal_ = 0;
+  uint32_t queueIndex_ = 0;
+  ze_command_queue_handle_t zeCommandQueue_ = nullptr;
+  // Graphs recorded on this queue by their identifier, and the commands
+  // captured for the graph being executed.
+  std::map<const void *, CommandGraph> graphs_;
+  bool capturing_ = false;
+  std::vector<GraphCommand> captured_;
+  KernelProfiler profiler_;
+
+  GPUL0QUEUE() : GPUL0QUEUE(getDriverAndDevice(), nullptr, 0) {}
+
+  GPUL0QUEUE(ze_device_type_t *deviceType, ze_context_handle_t context)
+      : GPUL0QUEUE(getDriverAndDevice(*deviceType), context, 0) {}
+
+  GPUL0QUEUE(ze_device_type_t *deviceType)
+      : GPUL0QUEUE(getDriverAndDevice(*deviceType), nullptr, 0) {}
+
+  GPUL0QUEUE(ze_context_handle_t context)
+      : GPUL0QUEUE(getDriverAndDevice(), context, 0) {}
+
+  GPUL0QUEUE(uint32_t deviceIndex, uint32_t queueIndex)
+      : GPUL0QUEUE(getDriverAndDevice(ZE_DEVICE_TYPE_GPU, deviceIndex), nullptr,
+                   queueIndex) {}
+
+  // Creates the queue on `driverAndDevice`, in `context` or in a new context
+  // if it is null. `queueIndex` selects the hardware queue within the compute
+  // and copy engine groups, streams with different indices run concurrently.
+  GPUL0QUEUE(std::pair<ze_driver_handle_t, ze_device_handle_t> driverAndDevice,
+             ze_context_handle_t context, uint32_t queueIndex) {
     zeDriver_ = driverAndDevice.first;
     zeDevice_ = driverAndDevice.second;
 
-    ze_context_desc_t contextDesc = {ZE_STRUCTURE_TYPE_CONTEXT_DESC, nullptr,
-                                     0};
-    CHECK_ZE_RESULT(zeContextCreate(zeDriver_, &contextDesc, &zeContext_));
-
-    uint32_t numQueueGroups = 0;
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, nullptr));
-
-    std::vector<ze_command_queue_group_properties_t> queueProperties(
-        numQueueGroups);
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, queueProperties.data()));
-
-    ze_command_queue_desc_t desc = {};
-    desc.mode = ZE_COMMAND_QUEUE_MODE_SYNCHRONOUS;
-    for (uint32_t i = 0; i < numQueueGroups; i++) {
-      if (queueProperties[i].flags &
-          ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE) {
-        desc.ordinal = i;
-      }
+    if (context) {
+      zeContext_ = context;
+    } else {
+      ze_context_desc_t contextDesc = {ZE_STRUCTURE_TYPE_CONTEXT_DESC, nullptr,
+                                       0};
+      CHECK_ZE_RESULT(zeContextCreate(zeDriver_, &contextDesc, &zeContext_));
     }
-    CHECK_ZE_RESULT(zeCommandListCreateImmediate(zeContext_, zeDevice_, &desc,
-                                                 &zeCommandList_));
-  }
-
-  GPUL0QUEUE(ze_device_type_t *deviceType, ze_context_handle_t context) {
-    auto driverAndDevice = getDriverAndDevice(*deviceType);
-    zeDriver_ = driverAndDevice.first;
-    zeDevice_ = driverAndDevice.second;
-
-    zeContext_ = context;
 
     uint32_t numQueueGroups = 0;
     CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
@@ -268,125 +610,207 @@ struct GPUL0QUEUE {
     CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
         zeDevice_, &numQueueGroups, queueProperties.data()));
 
-    ze_command_queue_desc_t desc = {};
-    desc.mode = ZE_COMMAND_QUEUE_MODE_SYNCHRONOUS;
+    // Use the last compute group, and the first group of copy engines which
+    // cannot run kernels.
+    uint32_t computeOrdinal = 0;
+    uint32_t copyOrdinal = numQueueGroups;
     for (uint32_t i = 0; i < numQueueGroups; i++) {
-      if (queueProperties[i].flags &
-          ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE) {
-        desc.ordinal = i;
-      }
+      auto flags = queueProperties[i].flags;
+      if (flags & ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE)
+        computeOrdinal = i;
+      else if ((flags & ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COPY) &&
+               copyOrdinal == numQueueGroups)
+        copyOrdinal = i;
     }
-    CHECK_ZE_RESULT(zeCommandListCreateImmediate(zeContext_, zeDevice_, &desc,
-                                                 &zeCommandList_));
-  }
-
-  GPUL0QUEUE(ze_device_type_t *deviceType) {
-
-    auto driverAndDevice = getDriverAndDevice(*deviceType);
-    zeDriver_ = driverAndDevice.first;
-    zeDevice_ = driverAndDevice.second;
-
-    ze_context_desc_t contextDesc = {ZE_STRUCTURE_TYPE_CONTEXT_DESC, nullptr,
-                                     0};
-    CHECK_ZE_RESULT(zeContextCreate(zeDriver_, &contextDesc, &zeContext_));
-
-    uint32_t numQueueGroups = 0;
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, nullptr));
-
-    std::vector<ze_command_queue_group_properties_t> queueProperties(
-        numQueueGroups);
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, queueProperties.data()));
 
     ze_command_queue_desc_t desc = {};
-    desc.mode = ZE_COMMAND_QUEUE_MODE_SYNCHRONOUS;
-    for (uint32_t i = 0; i < numQueueGroups; i++) {
-      if (queueProperties[i].flags &
-          ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE) {
-        desc.ordinal = i;
-      }
-    }
+    desc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
+    desc.ordinal = computeOrdinal;
+    desc.index = queueIndex % queueProperties[computeOrdinal].numQueues;
+    queueOrdinal_ = desc.ordinal;
+    queueIndex_ = desc.index;
     CHECK_ZE_RESULT(zeCommandListCreateImmediate(zeContext_, zeDevice_, &desc,
                                                  &zeCommandList_));
-  }
-
-  GPUL0QUEUE(ze_context_handle_t context) {
-
-    auto driverAndDevice = getDriverAndDevice();
-    zeDriver_ = driverAndDevice.first;
-    zeDevice_ = driverAndDevice.second;
-    zeContext_ = context;
 
-    uint32_t numQueueGroups = 0;
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, nullptr));
+    // Copies go to a copy engine, so they overlap with the kernels of the
+    // stream. They are ordered with kernels through events.
+    if (copyOrdinal != numQueueGroups && !getenv("IMEX_DISABLE_COPY_ENGINE")) {
+      desc.ordinal = copyOrdinal;
+      desc.index = queueIndex % queueProperties[copyOrdinal].numQueues;
+      CHECK_ZE_RESULT(zeCommandListCreateImmediate(
+          zeContext_, zeDevice_, &desc, &zeCopyCommandList_));
+    }
 
-    std::vector<ze_command_queue_group_properties_t> queueProperties(
-        numQueueGroups);
-    CHECK_ZE_RESULT(zeDeviceGetCommandQueueGroupProperties(
-        zeDevice_, &numQueueGroups, queueProperties.data()));
+    tracker_.init(zeContext_, zeDevice_);
+    pool_.getBackend() = {zeContext_, zeDevice_};
+    contextId_ = registerContext(zeContext_);
+  }
 
-    ze_command_queue_desc_t desc = {};
-    desc.mode = ZE_COMMAND_QUEUE_MODE_SYNCHRONOUS;
-    for (uint32_t i = 0; i < numQueueGroups; i++) {
-      if (queueProperties[i].flags &
-          ZE_COMMAND_QUEUE_GROUP_PROPERTY_FLAG_COMPUTE) {
-        desc.ordinal = i;
-      }
-    }
-    CHECK_ZE_RESULT(zeCommandListCreateImmediate(zeContext_, zeDevice_, &desc,
-                                                 &zeCommandList_));
+  // Returns the command list that copies are submitted to.
+  ze_command_list_handle_t getCopyCommandList() const {
+    return zeCopyCommandList_ ? zeCopyCommandList_ : zeCommandList_;
   }
 
   ~GPUL0QUEUE() {
     // Device and Driver resource management is dony by L0.
     // Just release context and commandList.
     // TODO: Use unique ptrs.
-    if (zeContext_)
+    tracker_.waitAll();
+    tracker_.release();
+    profiler_.release(pool_.getBackend());
+    pool_.releaseCached();
+    for (auto &it : graphs_)
+      CHECK_ZE_RESULT(zeCommandListDestroy(it.second.zeCommandList));
+    if (zeCommandQueue_)
+      CHECK_ZE_RESULT(zeCommandQueueDestroy(zeCommandQueue_));
+    if (zeContext_) {
+      releaseContext(zeContext_);
       CHECK_ZE_RESULT(zeContextDestroy(zeContext_));
+    }
 
     if (zeCommandList_)
       CHECK_ZE_RESULT(zeCommandListDestroy(zeCommandList_));
+    if (zeCopyCommandList_)
+      CHECK_ZE_RESULT(zeCommandListDestroy(zeCopyCommandList_));
   }
 };
 
+// Records a host event that started at `start` and ends now.
+static void traceHostEvent(const char *category, std::string name,
+                           uint64_t start, std::string args) {
+  imex::TraceEvent event;
+  event.category = category;
+  event.name = std::move(name);
+  event.args = std::move(args);
+  imex::TraceRecorder::get().recordSince(std::move(event), start);
+}
+
 static void *allocDeviceMemory(GPUL0QUEUE *queue, size_t size, size_t alignment,
                                bool isShared) {
-
-  void *ret = nullptr;
-  ze_device_mem_alloc_desc_t devDesc = {};
-  devDesc.stype = ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC;
-  if (isShared) {
-    ze_host_mem_alloc_desc_t hostDesc = {};
-    hostDesc.stype = ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC;
-    CHECK_ZE_RESULT(zeMemAllocShared(queue->zeContext_, &devDesc, &hostDesc,
-                                     size, alignment, queue->zeDevice_, &ret));
-  } else {
-    devDesc.flags = ZE_DEVICE_MEM_ALLOC_FLAG_BIAS_INITIAL_PLACEMENT;
-    CHECK_ZE_RESULT(zeMemAllocDevice(queue->zeContext_, &devDesc, size,
-                                     alignment, queue->zeDevice_, &ret));
-  }
+  auto start = imex::TraceRecorder::now();
+  void *ret = queue->pool_.allocate(
+      size, alignment, isShared,
+      [&](uint64_t fence) { return queue->tracker_.isComplete(fence); });
+  if (!ret)
+    throw std::runtime_error("Out of device memory");
+  if (imex::TraceRecorder::get().isEnabled())
+    traceHostEvent("alloc", isShared ? "alloc shared" : "alloc device", start,
+                   "\"bytes\":" + std::to_string(size));
   return ret;
 }
 
+// The memory is reused, or given back to the driver, once the commands
+// submitted so far have completed.
 static void deallocDeviceMemory(GPUL0QUEUE *queue, void *ptr) {
-  CHECK_ZE_RESULT(zeMemFree(queue->zeContext_, ptr));
+  auto start = imex::TraceRecorder::now();
+  queue->pool_.deallocate(
+      ptr, queue->tracker_.lastSeq(),
+      [&](uint64_t fence) { queue->tracker_.waitUntil(fence); });
+  if (imex::TraceRecorder::get().isEnabled())
+    traceHostEvent("free", "free", start, "");
+}
+
+// Copies `size` bytes once the commands of `deps` have completed, or after
+// all commands submitted so far if `deps` is null. Returns the token of the
+// copy.
+static void *copyMemory(GPUL0QUEUE *queue, void *dst, void *src, size_t size,
+                        void **deps, size_t numDeps) {
+  auto waitEvents = queue->tracker_.getEvents(deps, numDeps);
+  auto event = queue->tracker_.acquire();
+  auto submitTime = imex::TraceRecorder::now();
+  CHECK_ZE_RESULT(zeCommandListAppendMemoryCopy(
+      queue->getCopyCommandList(), dst, src, size, event,
+      static_cast<uint32_t>(waitEvents.size()), waitEvents.data()));
+  if (imex::TraceRecorder::get().isEnabled()) {
+    imex::TraceEvent traceEvent;
+    traceEvent.category = "memcpy";
+    traceEvent.name = "memcpy";
+    traceEvent.args = "\"bytes\":" + std::to_string(size);
+    queue->tracker_.trace(event, submitTime, std::move(traceEvent));
+  }
+  return queue->tracker_.record(event);
+}
+
+// Identifies the device and driver a native binary was compiled for.
+static std::string getDeviceKey(GPUL0QUEUE *queue) {
+  ze_driver_properties_t driverProps = {};
+  driverProps.stype = ZE_STRUCTURE_TYPE_DRIVER_PROPERTIES;
+  CHECK_ZE_RESULT(zeDriverGetProperties(queue->zeDriver_, &driverProps));
+  ze_device_properties_t deviceProps = {};
+  deviceProps.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+  CHECK_ZE_RESULT(zeDeviceGetProperties(queue->zeDevice_, &deviceProps));
+  return std::to_string(deviceProps.vendorId) + ":" +
+         std::to_string(deviceProps.deviceId) + ":" +
+         std::to_string(driverProps.driverVersion);
+}
+
+// Creates a module from SPIR-V, or from the native binary cached on disk by a
+// previous process.
+static ze_module_handle_t createModule(GPUL0QUEUE *queue, const void *data,
+                                       size_t dataSize, const char *buildFlags,
+                                       const imex::SpecConstants &specs) {
+  static imex::KernelBinaryCache binaryCache;
+  ze_module_handle_t zeModule = nullptr;
+  ze_module_desc_t desc = {};
+  desc.stype = ZE_STRUCTURE_TYPE_MODULE_DESC;
+
+  std::string key;
+  if (binaryCache.isEnabled()) {
+    key = imex::KernelBinaryCache::getKey(
+        data, dataSize, buildFlags, getDeviceKey(queue), specs.toString());
+    std::vector<uint8_t> binary;
+    if (binaryCache.load(key, binary)) {
+      desc.format = ZE_MODULE_FORMAT_NATIVE;
+      desc.pInputModule = binary.data();
+      desc.inputSize = binary.size();
+      if (zeModuleCreate(queue->zeContext_, queue->zeDevice_, &desc, &zeModule,
+                         nullptr) == ZE_RESULT_SUCCESS)
+        return zeModule;
+      // The entry is corrupt, build it again.
+      binaryCache.remove(key);
+    }
+  }
+
+  desc.format = ZE_MODULE_FORMAT_IL_SPIRV;
+  desc.pInputModule = static_cast<const uint8_t *>(data);
+  desc.inputSize = dataSize;
+  desc.pBuildFlags = buildFlags;
+  auto specValues = specs.getValuePointers();
+  ze_module_constants_t constants = {};
+  if (!specs.empty()) {
+    constants.numConstants = static_cast<uint32_t>(specs.ids.size());
+    constants.pConstantIds = specs.ids.data();
+    constants.pConstantValues = specValues.data();
+    desc.pConstants = &constants;
+  }
+  CHECK_ZE_RESULT(zeModuleCreate(queue->zeContext_, queue->zeDevice_, &desc,
+                                 &zeModule, nullptr));
+
+  if (!key.empty()) {
+    size_t binarySize = 0;
+    CHECK_ZE_RESULT(zeModuleGetNativeBinary(zeModule, &binarySize, nullptr));
+    std::vector<uint8_t> binary(binarySize);
+    CHECK_ZE_RESULT(
+        zeModuleGetNativeBinary(zeModule, &binarySize, binary.data()));
+    binaryCache.store(key, binary);
+  }
+  return zeModule;
 }
 
 static ze_module_handle_t loadModule(GPUL0QUEUE *queue, const void *data,
-                                     size_t dataSize) {
+                                     size_t dataSize,
+                                     imex::SpecConstants specs = {}) {
   assert(data);
-  auto gpuL0Queue = queue;
   ze_module_handle_t zeModule;
 
-  auto it = moduleCache.find((const void *)data);
+  std::lock_guard<std::mutex> entryLock(mutexLock);
+  ModuleKey cacheKey(queue->zeContext_, queue->zeDevice_, data,
+                     std::move(specs));
+  auto it = moduleCache.find(cacheKey);
   // Check the map if the module is present/cached.
   if (it != moduleCache.end()) {
     return it->second.module;
   }
-  ze_module_desc_t desc = {};
-
   const char *build_flags = nullptr;
   // enable large register file if needed
   if (getenv("IMEX_ENABLE_LARGE_REG_FILE")) {
@@ -396,14 +820,18 @@ static ze_module_handle_t loadModule(GPUL0QUEUE *queue, const void *data,
         "'-printregusage -enableBCR' ";
   }
 
-  desc.format = ZE_MODULE_FORMAT_IL_SPIRV;
-  desc.pInputModule = static_cast<const uint8_t *>(data);
-  desc.inputSize = dataSize;
-  desc.pBuildFlags = build_flags;
-  CHECK_ZE_RESULT(zeModuleCreate(gpuL0Queue->zeContext_, gpuL0Queue->zeDevice_,
-                                 &desc, &zeModule, nullptr));
-  std::lock_guard<std::mutex> entryLock(mutexLock);
-  moduleCache[(const void *)data].module = zeModule;
+  auto start = imex::TraceRecorder::now();
+  auto &specConstants = std::get<3>(cacheKey);
+  zeModule = createModule(queue, data, dataSize, build_flags, specConstants);
+  if (imex::TraceRecorder::get().isEnabled()) {
+    std::string args = "\"bytes\":" + std::to_string(dataSize);
+    if (!specConstants.empty())
+      args += ",\"spec_constants\":\"" + specConstants.toString() + "\"";
+    traceHostEvent("module", "module load", start, args);
+  }
+  auto &entry = moduleCache[std::move(cacheKey)];
+  entry.module = zeModule;
+  moduleHandles[zeModule] = &entry;
   return zeModule;
 }
 
@@ -411,10 +839,20 @@ static ze_kernel_handle_t
 getKernel(GPUL0QUEUE *queue, ze_module_handle_t module, const char *name) {
   assert(module);
   assert(name);
+  std::lock_guard<std::mutex> entryLock(mutexLock);
+  auto it = moduleHandles.find(module);
+  if (it == moduleHandles.end())
+    throw std::runtime_error("Module was not loaded by gpuModuleLoad");
+  auto &kernels = it->second->kernels;
+  auto kernelIt = kernels.find(name);
+  if (kernelIt != kernels.end())
+    return kernelIt->second;
+
   ze_kernel_desc_t desc = {};
   ze_kernel_handle_t zeKernel;
   desc.pKernelName = name;
   CHECK_ZE_RESULT(zeKernelCreate(module, &desc, &zeKernel));
+  kernels.emplace(name, zeKernel);
   return zeKernel;
 }
 
@@ -447,36 +885,26 @@ static void enqueueKernel(ze_command_list_handle_t zeCommandList,
                                                   numWaitEvents, phWaitEvents));
 }
 
-// Utility to discover the Global memory cache (L3) size of the device
-static size_t getGlobalMemoryCacheSize(ze_device_handle_t zeDevice) {
-  static constexpr unsigned MaxPropertyEntries = 16;
-  uint32_t CachePropCount = MaxPropertyEntries;
-  ze_device_cache_properties_t CacheProperties[MaxPropertyEntries];
-  for (uint32_t i = 0; i < MaxPropertyEntries; ++i) {
-    CacheProperties[i].stype = ZE_STRUCTURE_TYPE_DEVICE_CACHE_PROPERTIES;
-    CacheProperties[i].pNext = nullptr;
-  }
-  CHECK_ZE_RESULT(
-      zeDeviceGetCacheProperties(zeDevice, &CachePropCount, CacheProperties));
-  size_t globaMemoryCacheSize = 0;
-  for (uint32_t i = 0; i < CachePropCount; ++i) {
-    // find largest cache that is not user-controlled
-    if ((CacheProperties[i].flags &
-         ZE_DEVICE_CACHE_PROPERTY_FLAG_USER_CONTROL) != 0u) {
-      continue;
-    }
-    if (globaMemoryCacheSize < CacheProperties[i].cacheSize) {
-      globaMemoryCacheSize = CacheProperties[i].cacheSize;
-    }
-  }
-  return globaMemoryCacheSize;
+static std::string getKernelName(ze_kernel_handle_t kernel) {
+  size_t size = 0;
+  CHECK_ZE_RESULT(zeKernelGetName(kernel, &size, nullptr));
+  std::string name(size, '\0');
+  CHECK_ZE_RESULT(zeKernelGetName(kernel, &size, name.data()));
+  // The size includes the terminating null character.
+  name.resize(size ? size - 1 : 0);
+  return name;
 }
 
-static void launchKernel(GPUL0QUEUE *queue, ze_kernel_handle_t kernel,
-                         size_t gridX, size_t gridY, size_t gridZ,
-                         size_t blockX, size_t blockY, size_t blockZ,
-                         size_t sharedMemBytes, ParamDesc *params) {
+// Launches the kernel once the commands of `deps` have completed, or after all
+// commands submitted so far if `deps` is null. Returns the token of the
+// launch.
+static void *launchKernel(GPUL0QUEUE *queue, ze_kernel_handle_t kernel,
+                          size_t gridX, size_t gridY, size_t gridZ,
+                          size_t blockX, size_t blockY, size_t blockZ,
+                          size_t sharedMemBytes, ParamDesc *params,
+                          void **deps, size_t numDeps) {
   assert(kernel);
+  std::lock_guard<std::mutex> kernelLock(getKernelLock(kernel));
 
   auto castSz = [](size_t val) { return static_cast<uint32_t>(val); };
 
@@ -485,79 +913,163 @@ static void launchKernel(GPUL0QUEUE *queue, ze_kernel_handle_t kernel,
   ze_group_count_t launchArgs = {castSz(gridX), castSz(gridY), castSz(gridZ)};
 
   if (getenv("IMEX_ENABLE_PROFILING")) {
-    auto executionTime = 0.0f;
-    auto maxTime = 0.0f;
-    auto minTime = FLT_MAX;
-    auto rounds = 1000;
-    auto warmups = 3;
+    auto &profiler = queue->profiler_;
+    profiler.init(queue->zeContext_, queue->zeDevice_,
+                  queue->pool_.getBackend());
+    auto name = getKernelName(kernel);
+    auto rounds = profiler.options.getRuns(name);
 
-    // Before each run we need to flush the L3 cache (global memory cache) to
-    // make sure each profiling run has the same cache state. This is done by
-    // writing 'zero' to a global device memory buffer larger than the L3 cache
-    // size. This way, any data in the cache from previous run is evicted and we
-    // get a cold cache behavior. The write to the buffer is 'cached' in other
-    // words, the write goes through the L3 (global memory cache).
-    size_t cacheSize = getGlobalMemoryCacheSize(queue->zeDevice_);
-
-    // Allocate a device memory buffer twice the size of the
-    // L3 cache (global memory cache) of the device.
-    // The buffer can be host_shared or device-only, for our use-case we choose
-    // it to be device-only, it removes the need for extra copy from/to host.
-    // More importantly, it removes the possiblity of accidentally doing the
-    // flush in the host-side using a host side function.
-    auto *cache = allocDeviceMemory(queue, 2 * cacheSize, 64, false);
-
-    if (getenv("IMEX_PROFILING_RUNS")) {
-      auto runs = strtol(getenv("IMEX_PROFILING_RUNS"), NULL, 10L);
-      if (runs)
-        rounds = runs;
-    }
-
-    if (getenv("IMEX_PROFILING_WARMUPS")) {
-      auto runs = strtol(getenv("IMEX_PROFILING_WARMUPS"), NULL, 10L);
-      if (warmups)
-        warmups = runs;
-    }
+    // Profiled runs are timed in isolation.
+    queue->tracker_.waitAll();
 
     // warmup
-    for (int r = 0; r < warmups; r++) {
+    for (int r = 0; r < profiler.options.warmups; r++) {
       enqueueKernel(queue->zeCommandList_, kernel, &launchArgs, params,
                     sharedMemBytes, nullptr, 0, nullptr);
     }
+    CHECK_ZE_RESULT(
+        zeCommandListAppendBarrier(queue->zeCommandList_, nullptr, 0, nullptr));
 
     // profiling using timestamp event privided by level-zero
+    std::vector<double> times;
+    times.reserve(rounds);
     for (int r = 0; r < rounds; r++) {
-      Event event(queue->zeContext_, queue->zeDevice_);
       // Flush the L3 cache (global memory cache).
-      if (getenv("IMEX_ENABLE_CACHE_FLUSHING")) {
+      if (profiler.flushBuffer) {
         int init_val = 0;
         CHECK_ZE_RESULT(zeCommandListAppendMemoryFill(
-            queue->zeCommandList_, cache, &init_val, 1, cacheSize, NULL, 0,
-            NULL));
+            queue->zeCommandList_, profiler.flushBuffer, &init_val, 1,
+            profiler.cacheSize, NULL, 0, NULL));
+        CHECK_ZE_RESULT(zeCommandListAppendBarrier(queue->zeCommandList_,
+                                                   nullptr, 0, nullptr));
       }
 
       enqueueKernel(queue->zeCommandList_, kernel, &launchArgs, params,
-                    sharedMemBytes, event.zeEvent, 0, nullptr);
-
-      auto startTime =
-          event.get_profiling_info<imex::profiling::command_start>();
-      auto endTime = event.get_profiling_info<imex::profiling::command_end>();
-      auto duration = float(endTime - startTime) / 1000000.0f;
-      executionTime += duration;
-      if (duration > maxTime)
-        maxTime = duration;
-      if (duration < minTime)
-        minTime = duration;
+                    sharedMemBytes, profiler.zeEvent, 0, nullptr);
+      CHECK_ZE_RESULT(zeEventHostSynchronize(profiler.zeEvent, UINT64_MAX));
+      times.push_back(profiler.takeDuration());
     }
-    deallocDeviceMemory(queue, cache);
-    fprintf(stdout,
-            "the kernel execution time is (ms, on L0 runtime):"
-            "avg: %.4f, min: %.4f, max: %.4f (over %d runs)\n",
-            executionTime / rounds, minTime, maxTime, rounds);
+    imex::printKernelProfile(", on L0 runtime", name, std::move(times));
+    // All runs have completed.
+    return nullptr;
+  }
+
+  auto waitEvents = queue->tracker_.getEvents(deps, numDeps);
+  auto event = queue->tracker_.acquire();
+  auto submitTime = imex::TraceRecorder::now();
+  enqueueKernel(queue->zeCommandList_, kernel, &launchArgs, params,
+                sharedMemBytes, event, static_cast<uint32_t>(waitEvents.size()),
+                waitEvents.data());
+  if (imex::TraceRecorder::get().isEnabled()) {
+    imex::TraceEvent traceEvent;
+    traceEvent.category = "kernel";
+    traceEvent.name = getKernelName(kernel);
+    traceEvent.args = "\"grid\":[" + std::to_string(gridX) + "," +
+                      std::to_string(gridY) + "," + std::to_string(gridZ) +
+                      "],\"group\":[" + std::to_string(blockX) + "," +
+                      std::to_string(blockY) + "," + std::to_string(blockZ) +
+                      "],\"sharedMemBytes\":" + std::to_string(sharedMemBytes);
+    queue->tracker_.trace(event, submitTime, std::move(traceEvent));
+  }
+  return queue->tracker_.record(event);
+}
+
+// Adds a launch to the graph being captured.
+static void captureLaunch(GPUL0QUEUE *queue, ze_kernel_handle_t kernel,
+                          std::array<uint32_t, 6> dims, size_t sharedMemBytes,
+                          ParamDesc *params) {
+  GraphCommand command;
+  command.kind = GraphCommand::Launch;
+  command.kernel = kernel;
+  command.dims = dims;
+  command.sharedMemBytes = sharedMemBytes;
+  auto paramsCount = countUntil(params, ParamDesc{nullptr, 0});
+  for (size_t i = 0; i < paramsCount; ++i) {
+    auto *data = static_cast<const char *>(params[i].data);
+    command.args.emplace_back(data, data + params[i].size);
+  }
+  queue->captured_.push_back(std::move(command));
+}
+
+static ze_command_queue_handle_t getCommandQueue(GPUL0QUEUE *queue) {
+  if (!queue->zeCommandQueue_) {
+    ze_command_queue_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_COMMAND_QUEUE_DESC;
+    desc.ordinal = queue->queueOrdinal_;
+    desc.index = queue->queueIndex_;
+    desc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
+    CHECK_ZE_RESULT(zeCommandQueueCreate(queue->zeContext_, queue->zeDevice_,
+                                         &desc, &queue->zeCommandQueue_));
+  }
+  return queue->zeCommandQueue_;
+}
+
+// Records `commands` into the command list of `graph`.
+static void recordGraph(GPUL0QUEUE *queue, CommandGraph &graph,
+                        std::vector<GraphCommand> commands) {
+  if (graph.zeCommandList) {
+    CHECK_ZE_RESULT(zeCommandListReset(graph.zeCommandList));
   } else {
-    enqueueKernel(queue->zeCommandList_, kernel, &launchArgs, params,
-                  sharedMemBytes, nullptr, 0, nullptr);
+    ze_command_list_desc_t desc = {};
+    desc.stype = ZE_STRUCTURE_TYPE_COMMAND_LIST_DESC;
+    desc.commandQueueGroupOrdinal = queue->queueOrdinal_;
+    CHECK_ZE_RESULT(zeCommandListCreate(queue->zeContext_, queue->zeDevice_,
+                                        &desc, &graph.zeCommandList));
+  }
+
+  for (auto &command : commands) {
+    switch (command.kind) {
+    case GraphCommand::Launch: {
+      std::lock_guard<std::mutex> kernelLock(getKernelLock(command.kernel));
+      auto &dims = command.dims;
+      CHECK_ZE_RESULT(
+          zeKernelSetGroupSize(command.kernel, dims[3], dims[4], dims[5]));
+      ze_group_count_t launchArgs = {dims[0], dims[1], dims[2]};
+      std::vector<ParamDesc> params;
+      for (auto &arg : command.args)
+        params.push_back({arg.data(), arg.size()});
+      params.push_back({nullptr, 0});
+      enqueueKernel(graph.zeCommandList, command.kernel, &launchArgs,
+                    params.data(), command.sharedMemBytes);
+      break;
+    }
+    case GraphCommand::Copy:
+      CHECK_ZE_RESULT(zeCommandListAppendMemoryCopy(
+          graph.zeCommandList, command.dst, command.src, command.size, nullptr,
+          0, nullptr));
+      break;
+    case GraphCommand::Barrier:
+      CHECK_ZE_RESULT(zeCommandListAppendBarrier(graph.zeCommandList, nullptr,
+                                                 0, nullptr));
+      break;
+    }
   }
+  CHECK_ZE_RESULT(zeCommandListClose(graph.zeCommandList));
+  graph.commands = std::move(commands);
+}
+
+// The streams created by gpuGetSharedStream. They are destroyed at exit, or
+// by gpuDestroySharedStreams.
+struct SharedStreams {
+  std::mutex mutex;
+  // The module global caching each stream, and the stream.
+  std::vector<std::pair<GPUL0QUEUE **, GPUL0QUEUE *>> streams;
+
+  // The trace recorder is constructed first, so that it outlives the streams
+  // destroyed at exit.
+  SharedStreams() { imex::TraceRecorder::get(); }
+
+  // The modules holding the globals may be unloaded by now, only the streams
+  // are destroyed.
+  ~SharedStreams() {
+    for (auto &it : streams)
+      catchAll([&]() { delete it.second; });
+  }
+};
+
+static SharedStreams &getSharedStreams() {
+  static SharedStreams sharedStreams;
+  return sharedStreams;
 }
 
 // Wrappers
@@ -579,19 +1091,92 @@ gpuCreateStream(void *device, void *context) {
   });
 }
 
+// Creates a stream on the GPU `deviceIndex`, using the hardware queues
+// selected by `queueIndex`.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT GPUL0QUEUE *
+gpuCreateStreamOnDevice(int32_t deviceIndex, int32_t queueIndex) {
+  return catchAll([&]() {
+    return new GPUL0QUEUE(static_cast<uint32_t>(deviceIndex),
+                          static_cast<uint32_t>(queueIndex));
+  });
+}
+
+// Returns the stream cached in `slot`, and creates it on the GPU `deviceIndex`
+// on first use. The stream is shared by all calls until program exit.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT GPUL0QUEUE *
+gpuGetSharedStream(GPUL0QUEUE **slot, int32_t deviceIndex, int32_t queueIndex) {
+  return catchAll([&]() {
+    auto &sharedStreams = getSharedStreams();
+    std::lock_guard<std::mutex> lock(sharedStreams.mutex);
+    if (!*slot) {
+      *slot = new GPUL0QUEUE(static_cast<uint32_t>(deviceIndex),
+                             static_cast<uint32_t>(queueIndex));
+      sharedStreams.streams.emplace_back(slot, *slot);
+    }
+    return *slot;
+  });
+}
+
+// Destroys the shared streams, for hosts that unload the modules using them
+// before exit. They are created again on their next use.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuDestroySharedStreams() {
+  catchAll([&]() {
+    auto &sharedStreams = getSharedStreams();
+    std::lock_guard<std::mutex> lock(sharedStreams.mutex);
+    for (auto &it : sharedStreams.streams) {
+      *it.first = nullptr;
+      delete it.second;
+    }
+    sharedStreams.streams.clear();
+  });
+}
+
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuStreamDestroy(GPUL0QUEUE *queue) {
   catchAll([&]() { delete queue; });
 }
 
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT void *
 gpuMemAlloc(GPUL0QUEUE *queue, size_t size, size_t alignment, bool isShared) {
-  return catchAll(
-      [&]() { return allocDeviceMemory(queue, size, alignment, isShared); });
+  return catchAll([&]() {
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    return allocDeviceMemory(queue, size, alignment, isShared);
+  });
 }
 
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuMemFree(GPUL0QUEUE *queue,
                                                      void *ptr) {
-  catchAll([&]() { deallocDeviceMemory(queue, ptr); });
+  catchAll([&]() {
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    deallocDeviceMemory(queue, ptr);
+  });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void
+gpuMemCopy(GPUL0QUEUE *queue, void *dst, void *src, size_t size) {
+  catchAll([&]() {
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    if (queue->capturing_) {
+      GraphCommand command;
+      command.kind = GraphCommand::Copy;
+      command.dst = dst;
+      command.src = src;
+      command.size = size;
+      queue->captured_.push_back(command);
+      queue->captured_.push_back(GraphCommand());
+      return;
+    }
+    copyMemory(queue, dst, src, size, nullptr, 0);
+    queue->tracker_.waitAll();
+  });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void *
+gpuMemCopyAsync(GPUL0QUEUE *queue, void *dst, void *src, size_t size,
+                void **deps, size_t numDeps) {
+  return catchAll([&]() {
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    return copyMemory(queue, dst, src, size, deps, numDeps);
+  });
 }
 
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_module_handle_t
@@ -599,6 +1184,28 @@ gpuModuleLoad(GPUL0QUEUE *queue, const void *data, size_t dataSize) {
   return catchAll([&]() { return loadModule(queue, data, dataSize); });
 }
 
+// Returns the kernel `name` of the module built with the given values of its
+// specialization constants. `slot` caches the kernel of the launch site, the
+// module and kernel caches are only consulted when the values, or the context
+// or device of the stream, change. Kernels without specialization constants
+// pass no values.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_kernel_handle_t
+gpuKernelGetSpecialized(GPUL0QUEUE *queue, void **slot, const void *data,
+                        size_t dataSize, const char *name,
+                        const uint32_t *specIds, const int64_t *specValues,
+                        size_t numSpecs) {
+  return catchAll([&]() {
+    return static_cast<ze_kernel_handle_t>(imex::getSpecializedKernel(
+        slot, queue->contextId_, queue->zeDevice_, specIds, specValues,
+        numSpecs, [&]() -> void * {
+          auto module =
+              loadModule(queue, data, dataSize,
+                         imex::SpecConstants(specIds, specValues, numSpecs));
+          return getKernel(queue, module, name);
+        }));
+  });
+}
+
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT ze_kernel_handle_t
 gpuKernelGet(GPUL0QUEUE *queue, ze_module_handle_t module, const char *name) {
   return catchAll([&]() { return getKernel(queue, module, name); });
@@ -609,14 +1216,118 @@ gpuLaunchKernel(GPUL0QUEUE *queue, ze_kernel_handle_t kernel, size_t gridX,
                 size_t gridY, size_t gridZ, size_t blockX, size_t blockY,
                 size_t blockZ, size_t sharedMemBytes, void *params) {
   return catchAll([&]() {
+    // Ordered after all commands submitted so far, completes with gpuWait.
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    if (queue->capturing_) {
+      auto castSz = [](size_t val) { return static_cast<uint32_t>(val); };
+      return captureLaunch(queue, kernel,
+                           {castSz(gridX), castSz(gridY), castSz(gridZ),
+                            castSz(blockX), castSz(blockY), castSz(blockZ)},
+                           sharedMemBytes, static_cast<ParamDesc *>(params));
+    }
     launchKernel(queue, kernel, gridX, gridY, gridZ, blockX, blockY, blockZ,
-                 sharedMemBytes, static_cast<ParamDesc *>(params));
+                 sharedMemBytes, static_cast<ParamDesc *>(params), nullptr, 0);
+  });
+}
+
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void *
+gpuLaunchKernelAsync(GPUL0QUEUE *queue, ze_kernel_handle_t kernel,
+                     size_t gridX, size_t gridY, size_t gridZ, size_t blockX,
+                     size_t blockY, size_t blockZ, size_t sharedMemBytes,
+                     void *params, void **deps, size_t numDeps) {
+  return catchAll([&]() {
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    return launchKernel(queue, kernel, gridX, gridY, gridZ, blockX, blockY,
+                        blockZ, sharedMemBytes,
+                        static_cast<ParamDesc *>(params), deps, numDeps);
   });
 }
 
+// Returns a token that completes with the commands of `deps`.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void *
+gpuEventJoin(GPUL0QUEUE *queue, void **deps, size_t numDeps) {
+  return catchAll([&]() -> void * {
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    auto waitEvents = queue->tracker_.getEvents(deps, numDeps);
+    if (waitEvents.empty())
+      return nullptr;
+    auto event = queue->tracker_.acquire();
+    CHECK_ZE_RESULT(zeCommandListAppendBarrier(
+        queue->zeCommandList_, event, static_cast<uint32_t>(waitEvents.size()),
+        waitEvents.data()));
+    return queue->tracker_.record(event);
+  });
+}
+
+// Blocks the host until the commands of `deps` have completed.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void
+gpuWaitEvents(GPUL0QUEUE *queue, void **deps, size_t numDeps) {
+  catchAll([&]() {
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    queue->tracker_.wait(deps, numDeps);
+  });
+}
+
+// Blocks the host until all commands submitted to the queue have completed.
+// While a graph is captured, it orders the commands before and after it.
 extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuWait(GPUL0QUEUE *queue) {
   catchAll([&]() {
-    // TODO: Find out ze Wait for host.
-    return;
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    if (queue->capturing_)
+      return queue->captured_.push_back(GraphCommand());
+    queue->tracker_.waitAll();
+    queue->pool_.trim(
+        [&](uint64_t fence) { return queue->tracker_.isComplete(fence); });
+  });
+}
+
+// Starts capturing the commands of the graph identified by `graph`. Profiled
+// kernels are timed one by one and are not captured. All commands submitted
+// to the stream are captured, whatever the thread, which is why graphs are
+// not formed on shared streams.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuGraphBegin(GPUL0QUEUE *queue,
+                                                        const void *graph) {
+  catchAll([&]() {
+    if (getenv("IMEX_ENABLE_PROFILING"))
+      return;
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    queue->capturing_ = true;
+    queue->captured_.clear();
+  });
+}
+
+// Executes the commands captured since gpuGraphBegin and waits for them. The
+// command list recorded by the previous execution of the graph is replayed if
+// the commands are the same.
+extern "C" LEVEL_ZERO_RUNTIME_EXPORT void gpuGraphEnd(GPUL0QUEUE *queue,
+                                                      const void *graph) {
+  catchAll([&]() {
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    if (!queue->capturing_)
+      return;
+    queue->capturing_ = false;
+    auto &recorded = queue->graphs_[graph];
+    if (!recorded.zeCommandList || recorded.commands != queue->captured_)
+      recordGraph(queue, recorded, std::move(queue->captured_));
+    queue->captured_.clear();
+
+    // The command queue is not ordered with the immediate command list.
+    queue->tracker_.waitAll();
+    auto zeCommandQueue = getCommandQueue(queue);
+    auto start = imex::TraceRecorder::now();
+    CHECK_ZE_RESULT(zeCommandQueueExecuteCommandLists(
+        zeCommandQueue, 1, &recorded.zeCommandList, nullptr));
+    CHECK_ZE_RESULT(zeCommandQueueSynchronize(zeCommandQueue, UINT64_MAX));
+    auto &recorder = imex::TraceRecorder::get();
+    if (recorder.isEnabled()) {
+      // The commands of a graph are timed as a whole with the host clock.
+      imex::TraceEvent traceEvent;
+      traceEvent.category = "graph";
+      traceEvent.name = "graph";
+      traceEvent.deviceTrack = queue->tracker_.traceTrack;
+      traceEvent.args = "\"commands\":" +
+                        std::to_string(recorded.commands.size());
+      recorder.recordSince(std::move(traceEvent), start);
+    }
   });
 }
@@ -0,0 +1,103 @@
+//===- ObjectCache.cpp - On-disk cache of JIT compiled objects --*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the on-disk cache of JIT compiled objects.
+///
+//===----------------------------------------------------------------------===//
+
+#include "imex/ExecutionEngine/ObjectCache.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+using namespace imex;
+
+DiskObjectCache::DiskObjectCache(llvm::StringRef directory)
+    : directory(directory.str()) {}
+
+std::string DiskObjectCache::getModuleKey(const llvm::Module &module,
+                                          const llvm::TargetMachine &tm,
+                                          std::optional<unsigned> optLevel) {
+  llvm::SmallString<0> bitcode;
+  llvm::raw_svector_ostream os(bitcode);
+  llvm::WriteBitcodeToFile(module, os);
+
+  llvm::SHA256 hasher;
+  hasher.update(bitcode);
+  // The fields are separated, so that e.g. two feature strings cannot make up
+  // the same key.
+  for (llvm::StringRef field :
+       {llvm::StringRef(tm.getTargetTriple().str()), tm.getTargetCPU(),
+        tm.getTargetFeatureString()}) {
+    hasher.update(field);
+    hasher.update(llvm::StringRef("\0", 1));
+  }
+  hasher.update(optLevel ? std::to_string(*optLevel) : "none");
+  hasher.update(std::to_string(static_cast<int>(tm.getOptLevel())));
+  return llvm::toHex(hasher.final(), /*LowerCase=*/true);
+}
+
+std::string DiskObjectCache::getPath(llvm::StringRef key) const {
+  llvm::SmallString<256> path(directory);
+  llvm::sys::path::append(path, key + ".o");
+  return std::string(path);
+}
+
+bool DiskObjectCache::contains(llvm::StringRef key) const {
+  return llvm::sys::fs::exists(getPath(key));
+}
+
+void DiskObjectCache::notifyObjectCompiled(const llvm::Module *module,
+                                           llvm::MemoryBufferRef object) {
+  if (auto ec = llvm::sys::fs::create_directories(directory)) {
+    llvm::errs() << "object cache: cannot create " << directory << ": "
+                 << ec.message() << "\n";
+    return;
+  }
+
+  // Write to a unique file first: another process may be reading the object
+  // or storing the same one.
+  llvm::SmallString<256> model(directory);
+  llvm::sys::path::append(model, "%%%%%%%%.tmp");
+  int fd;
+  llvm::SmallString<256> tmpPath;
+  if (auto ec = llvm::sys::fs::createUniqueFile(model, fd, tmpPath)) {
+    llvm::errs() << "object cache: cannot create a file in " << directory
+                 << ": " << ec.message() << "\n";
+    return;
+  }
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os << object.getBuffer();
+  }
+  if (auto ec = llvm::sys::fs::rename(tmpPath,
+                                      getPath(module->getModuleIdentifier()))) {
+    llvm::errs() << "object cache: cannot store the object: " << ec.message()
+                 << "\n";
+    llvm::sys::fs::remove(tmpPath);
+  }
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+DiskObjectCache::getObject(const llvm::Module *module) {
+  auto buffer = llvm::MemoryBuffer::getFile(
+      getPath(module->getModuleIdentifier()), /*IsText=*/false,
+      /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return nullptr;
+  return std::move(*buffer);
+}
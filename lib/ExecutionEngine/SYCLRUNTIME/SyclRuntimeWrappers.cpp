@@ -12,16 +12,21 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "imex/ExecutionEngine/CachingAllocator.h"
+#include "imex/ExecutionEngine/KernelBinaryCache.h"
+#include "imex/ExecutionEngine/KernelProfiling.h"
+#include "imex/ExecutionEngine/SpecConstants.h"
+#include "imex/ExecutionEngine/TraceRecorder.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <array>
 #include <atomic>
 #include <cassert>
-#include <cfloat>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <stdexcept>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -68,12 +73,22 @@ template <typename F> auto catchAll(F &&func) {
 
 struct SpirvModule {
   ze_module_handle_t module = nullptr;
+  // Kernels created from the module, by name. They are not released at exit,
+  // the SYCL runtime may already be torn down by then.
+  std::map<std::string, sycl::kernel *> kernels;
+  // Keeps the context alive, so that its native handle is not reused.
+  sycl::context context;
   ~SpirvModule();
 };
 
 namespace {
-// Create a Map for the spirv module lookup
-std::map<void *, SpirvModule> moduleCache;
+// Create a Map for the spirv module lookup, one module per context, device,
+// SPIR-V binary and specialization.
+using ModuleKey = std::tuple<ze_context_handle_t, ze_device_handle_t,
+                             const void *, imex::SpecConstants>;
+std::map<ModuleKey, SpirvModule> moduleCache;
+// Map from module handle to its entry in moduleCache, for the kernel lookup.
+std::map<ze_module_handle_t, SpirvModule *> moduleHandles;
 std::mutex mutexLock;
 } // namespace
 
@@ -101,7 +116,8 @@ template <typename T> size_t countUntil(T *ptr, T &&elem) {
   return static_cast<size_t>(curr - ptr);
 }
 
-static sycl::device getDefaultDevice() {
+// Returns the device `deviceIndex` of the Level Zero platform.
+static sycl::device getDefaultDevice(size_t deviceIndex = 0) {
   auto platformList = sycl::platform::get_platforms();
   for (const auto &platform : platformList) {
     auto platformName = platform.get_info<sycl::info::platform::name>();
@@ -109,21 +125,186 @@ static sycl::device getDefaultDevice() {
     if (!isLevelZero)
       continue;
 
-    return platform.get_devices()[0];
+    auto devices = platform.get_devices();
+    if (deviceIndex >= devices.size())
+      throw std::runtime_error("Invalid device index");
+    return devices[deviceIndex];
   }
+  throw std::runtime_error("No Level-Zero platform found");
 }
 
+// Device and shared USM allocations of a queue, for the memory pool.
+struct SyclMemoryBackend {
+  sycl::queue *syclQueue = nullptr;
+
+  // Returns null if the device is out of memory.
+  void *allocate(size_t size, size_t alignment, bool isShared) {
+    if (isShared)
+      return sycl::aligned_alloc_shared(alignment, size, *syclQueue);
+    return sycl::aligned_alloc_device(alignment, size, *syclQueue);
+  }
+
+  void deallocate(void *ptr) { sycl::free(ptr, *syclQueue); }
+};
+
+// Times kernels for IMEX_ENABLE_PROFILING. The device cache size and the
+// cache flush buffer are set up by the first profiled launch of a queue and
+// reused by later ones.
+struct KernelProfiler {
+  imex::KernelProfilingOptions options{100};
+  bool initialized = false;
+  size_t cacheSize = 0;
+  void *flushBuffer = nullptr;
+
+  void init(const sycl::device &syclDevice, SyclMemoryBackend &backend) {
+    if (initialized)
+      return;
+    initialized = true;
+
+    // Before each run we need to flush the L3 cache (global memory cache) to
+    // make sure each profiling run has the same cache state. This is done by
+    // writing 'zero' to a global device memory buffer twice the size of the
+    // L3 cache. The buffer is device-only, it removes the possiblity of
+    // accidentally doing the flush in the host-side.
+    if (options.flushCache) {
+      cacheSize =
+          syclDevice.get_info<sycl::info::device::global_mem_cache_size>();
+      flushBuffer = backend.allocate(2 * cacheSize, 64, false);
+      if (flushBuffer == nullptr) {
+        throw std::runtime_error(
+            "aligned_alloc_device() failed to allocate memory!");
+      }
+    }
+  }
+
+  void release(SyclMemoryBackend &backend) {
+    if (flushBuffer)
+      backend.deallocate(flushBuffer);
+    flushBuffer = nullptr;
+    initialized = false;
+  }
+};
+
 struct GPUSYCLQUEUE {
 
   sycl::device syclDevice_;
   sycl::context syclContext_;
   sycl::queue syclQueue_;
+  // The native handles of the device and context, which key the modules.
+  ze_device_handle_t zeDevice_ = nullptr;
+  ze_context_handle_t zeContext_ = nullptr;
+
+  // Commands which may still be running, by sequence number. The sequence
+  // number is handed out to the program as async token. A token that is no
+  // longer tracked has completed, the null token is always complete.
+  std::map<uintptr_t, sycl::event> pending_;
+  uintptr_t nextSeq_ = 1;
+  // Freed buffers are cached and reused once the commands submitted before
+  // the free have completed.
+  imex::CachingAllocator<SyclMemoryBackend> pool_;
+  std::mutex mutex_;
+  // Set between gpuGraphBegin and gpuGraphEnd.
+  bool capturing_ = false;
+  // When tracing with device timestamps, the traced commands which may still
+  // be running. Their trace events are completed once the host synchronizes.
+  uint32_t traceTrack_ = imex::TraceRecorder::get().createDeviceTrack();
+  std::vector<std::pair<sycl::event, imex::TraceEvent>> traced_;
+  KernelProfiler profiler_;
+
+  // Registers a submitted command and returns its token.
+  void *record(sycl::event event) {
+    pending_.emplace(nextSeq_, event);
+    return reinterpret_cast<void *>(nextSeq_++);
+  }
+
+  // Returns the events of the commands in flight among `tokens`, or of all
+  // commands in flight if `tokens` is null.
+  std::vector<sycl::event> getEvents(void **tokens, size_t numTokens) {
+    std::vector<sycl::event> events;
+    if (!tokens) {
+      for (auto &it : pending_)
+        events.push_back(it.second);
+      return events;
+    }
+    for (size_t i = 0; i < numTokens; ++i) {
+      auto it = pending_.find(reinterpret_cast<uintptr_t>(tokens[i]));
+      if (it != pending_.end())
+        events.push_back(it->second);
+    }
+    return events;
+  }
+
+  // Returns the sequence number of the last command submitted.
+  uintptr_t lastSeq() const { return nextSeq_ - 1; }
+
+  // Returns true if all commands up to `seq` have completed.
+  bool isComplete(uintptr_t seq) {
+    while (!pending_.empty() && pending_.begin()->first <= seq) {
+      auto status = pending_.begin()
+                        ->second.get_info<
+                            sycl::info::event::command_execution_status>();
+      if (status != sycl::info::event_command_status::complete)
+        return false;
+      pending_.erase(pending_.begin());
+    }
+    return true;
+  }
+
+  // Blocks the host until all commands up to `seq` have completed.
+  void waitUntil(uintptr_t seq) {
+    while (!pending_.empty() && pending_.begin()->first <= seq) {
+      pending_.begin()->second.wait();
+      pending_.erase(pending_.begin());
+    }
+  }
+
+  // Adds the command of `event`, submitted at `submitTime`, to the trace.
+  // With the host timer the command is waited for.
+  void trace(sycl::event event, uint64_t submitTime,
+             imex::TraceEvent traceEvent) {
+    traceEvent.deviceTrack = traceTrack_;
+    traceEvent.start = submitTime;
+    auto &recorder = imex::TraceRecorder::get();
+    if (!recorder.useHostTimer()) {
+      traced_.emplace_back(event, std::move(traceEvent));
+      return;
+    }
+    event.wait();
+    recorder.recordSince(std::move(traceEvent), submitTime);
+  }
+
+  // Records the traced commands, which must have completed. The device
+  // timestamps are placed relative to the host time of the submission.
+  void flushTraces() {
+    for (auto &it : traced_) {
+      auto &event = it.first;
+      auto submit = event.get_profiling_info<
+          sycl::info::event_profiling::command_submit>();
+      auto start = event.get_profiling_info<
+          sycl::info::event_profiling::command_start>();
+      auto end =
+          event.get_profiling_info<sycl::info::event_profiling::command_end>();
+      auto &traceEvent = it.second;
+      traceEvent.start += start > submit ? start - submit : 0;
+      traceEvent.duration = end > start ? end - start : 0;
+      imex::TraceRecorder::get().record(std::move(traceEvent));
+    }
+    traced_.clear();
+  }
+
+  // Blocks the host until all commands have completed.
+  void waitAll() {
+    syclQueue_.wait();
+    pending_.clear();
+    flushTraces();
+  }
 
   GPUSYCLQUEUE(sycl::property_list propList) {
 
     syclDevice_ = getDefaultDevice();
     syclContext_ = sycl::context(syclDevice_);
     syclQueue_ = sycl::queue(syclContext_, syclDevice_, propList);
+    init();
   }
 
   GPUSYCLQUEUE(sycl::device *device, sycl::context *context,
@@ -131,12 +312,14 @@ struct GPUSYCLQUEUE {
     syclDevice_ = *device;
     syclContext_ = *context;
     syclQueue_ = sycl::queue(syclContext_, syclDevice_, propList);
+    init();
   }
   GPUSYCLQUEUE(sycl::device *device, sycl::property_list propList) {
 
     syclDevice_ = *device;
     syclContext_ = sycl::context(syclDevice_);
     syclQueue_ = sycl::queue(syclContext_, syclDevice_, propList);
+    init();
   }
 
   GPUSYCLQUEUE(sycl::context *context, sycl::property_list propList) {
@@ -144,6 +327,22 @@ struct GPUSYCLQUEUE {
     syclDevice_ = getDefaultDevice();
     syclContext_ = *context;
     syclQueue_ = sycl::queue(syclContext_, syclDevice_, propList);
+    init();
+  }
+
+  void init() {
+    pool_.getBackend().syclQueue = &syclQueue_;
+    zeDevice_ =
+        sycl::get_native<sycl::backend::ext_oneapi_level_zero>(syclDevice_);
+    zeContext_ =
+        sycl::get_native<sycl::backend::ext_oneapi_level_zero>(syclContext_);
+  }
+
+  ~GPUSYCLQUEUE() {
+    // Cached memory may only be released once no command uses it.
+    waitAll();
+    profiler_.release(pool_.getBackend());
+    pool_.releaseCached();
   }
 
 }; // end of GPUSYCLQUEUE
@@ -175,27 +374,124 @@ static std::string getDeviceID(GPUSYCLQUEUE *queue) {
 }
 #endif
 
+// Records a host event that started at `start` and ends now.
+static void traceHostEvent(const char *category, std::string name,
+                           uint64_t start, std::string args) {
+  imex::TraceEvent event;
+  event.category = category;
+  event.name = std::move(name);
+  event.args = std::move(args);
+  imex::TraceRecorder::get().recordSince(std::move(event), start);
+}
+
 static void *allocDeviceMemory(GPUSYCLQUEUE *queue, size_t size,
                                size_t alignment, bool isShared) {
-  void *memPtr = nullptr;
-  if (isShared) {
-    memPtr = sycl::aligned_alloc_shared(alignment, size, queue->syclQueue_);
-  } else {
-    memPtr = sycl::aligned_alloc_device(alignment, size, queue->syclQueue_);
-  }
+  auto start = imex::TraceRecorder::now();
+  void *memPtr = queue->pool_.allocate(
+      size, alignment, isShared,
+      [&](uint64_t fence) { return queue->isComplete(fence); });
   if (memPtr == nullptr) {
     throw std::runtime_error(
         "aligned_alloc_shared() failed to allocate memory!");
   }
+  if (imex::TraceRecorder::get().isEnabled())
+    traceHostEvent("alloc", isShared ? "alloc shared" : "alloc device", start,
+                   "\"bytes\":" + std::to_string(size));
   return memPtr;
 }
 
+// The memory is reused, or given back to the driver, once the commands
+// submitted so far have completed.
 static void deallocDeviceMemory(GPUSYCLQUEUE *queue, void *ptr) {
-  sycl::free(ptr, queue->syclQueue_);
+  auto start = imex::TraceRecorder::now();
+  queue->pool_.deallocate(ptr, queue->lastSeq(), [&](uint64_t fence) {
+    queue->waitUntil(fence);
+  });
+  if (imex::TraceRecorder::get().isEnabled())
+    traceHostEvent("free", "free", start, "");
+}
+
+// Copies `size` bytes once `deps` have completed and returns the event of the
+// copy.
+static sycl::event copyMemory(GPUSYCLQUEUE *queue, void *dst, void *src,
+                              size_t size,
+                              const std::vector<sycl::event> &deps) {
+  auto submitTime = imex::TraceRecorder::now();
+  auto event = queue->syclQueue_.memcpy(dst, src, size, deps);
+  if (imex::TraceRecorder::get().isEnabled()) {
+    imex::TraceEvent traceEvent;
+    traceEvent.category = "memcpy";
+    traceEvent.name = "memcpy";
+    traceEvent.args = "\"bytes\":" + std::to_string(size);
+    queue->trace(event, submitTime, std::move(traceEvent));
+  }
+  return event;
+}
+
+// Identifies the device and driver a native binary was compiled for.
+static std::string getDeviceKey(ze_device_handle_t zeDevice,
+                                const sycl::device &syclDevice) {
+  ze_device_properties_t deviceProps = {};
+  deviceProps.stype = ZE_STRUCTURE_TYPE_DEVICE_PROPERTIES;
+  L0_SAFE_CALL(zeDeviceGetProperties(zeDevice, &deviceProps));
+  return std::to_string(deviceProps.vendorId) + ":" +
+         std::to_string(deviceProps.deviceId) + ":" +
+         syclDevice.get_info<sycl::info::device::driver_version>();
+}
+
+// Creates a module from SPIR-V, or from the native binary cached on disk by a
+// previous process.
+static ze_module_handle_t createModule(ze_context_handle_t zeContext,
+                                       ze_device_handle_t zeDevice,
+                                       const sycl::device &syclDevice,
+                                       ze_module_desc_t desc,
+                                       const imex::SpecConstants &specs) {
+  static imex::KernelBinaryCache binaryCache;
+  ze_module_handle_t zeModule = nullptr;
+
+  std::string key;
+  if (binaryCache.isEnabled()) {
+    key = imex::KernelBinaryCache::getKey(
+        desc.pInputModule, desc.inputSize, desc.pBuildFlags,
+        getDeviceKey(zeDevice, syclDevice), specs.toString());
+    std::vector<uint8_t> binary;
+    if (binaryCache.load(key, binary)) {
+      ze_module_desc_t nativeDesc = desc;
+      nativeDesc.format = ZE_MODULE_FORMAT_NATIVE;
+      nativeDesc.pInputModule = binary.data();
+      nativeDesc.inputSize = binary.size();
+      nativeDesc.pBuildFlags = nullptr;
+      if (zeModuleCreate(zeContext, zeDevice, &nativeDesc, &zeModule,
+                         nullptr) == ZE_RESULT_SUCCESS)
+        return zeModule;
+      // The entry is corrupt, build it again.
+      binaryCache.remove(key);
+    }
+  }
+
+  auto specValues = specs.getValuePointers();
+  ze_module_constants_t constants = {};
+  if (!specs.empty()) {
+    constants.numConstants = static_cast<uint32_t>(specs.ids.size());
+    constants.pConstantIds = specs.ids.data();
+    constants.pConstantValues = specValues.data();
+    desc.pConstants = &constants;
+  }
+  L0_SAFE_CALL(zeModuleCreate(zeContext, zeDevice, &desc, &zeModule, nullptr));
+
+  if (!key.empty()) {
+    size_t binarySize = 0;
+    L0_SAFE_CALL(zeModuleGetNativeBinary(zeModule, &binarySize, nullptr));
+    std::vector<uint8_t> binary(binarySize);
+    L0_SAFE_CALL(zeModuleGetNativeBinary(zeModule, &binarySize, binary.data()));
+    binaryCache.store(key, binary);
+  }
+  return zeModule;
 }
 
 static ze_module_handle_t loadModule(GPUSYCLQUEUE *queue, const void *data,
-                                     size_t dataSize) {
+                                     size_t dataSize,
+                                     imex::SpecConstants specs = {}) {
   assert(data);
   auto syclQueue = queue->syclQueue_;
   ze_module_handle_t zeModule;
@@ -204,7 +500,10 @@ static ze_module_handle_t loadModule(GPUSYCLQUEUE *queue, const void *data,
   // query and throw an error for unsupported platforms
   // getDeviceID(syclQueue);
 
-  auto it = moduleCache.find((void *)data);
+  std::lock_guard<std::mutex> entryLock(mutexLock);
+  ModuleKey cacheKey(queue->zeContext_, queue->zeDevice_, data,
+                     std::move(specs));
+  auto it = moduleCache.find(cacheKey);
   // Check the map if the module is present/cached.
   if (it != moduleCache.end()) {
     return it->second.module;
@@ -226,13 +525,20 @@ static ze_module_handle_t loadModule(GPUSYCLQUEUE *queue, const void *data,
         "'-printregusage -enableBCR' ";
   }
 
-  auto zeDevice = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(
-      syclQueue.get_device());
-  auto zeContext = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(
-      syclQueue.get_context());
-  L0_SAFE_CALL(zeModuleCreate(zeContext, zeDevice, &desc, &zeModule, nullptr));
-  std::lock_guard<std::mutex> entryLock(mutexLock);
-  moduleCache[(void *)data].module = zeModule;
+  auto &specConstants = std::get<3>(cacheKey);
+  auto start = imex::TraceRecorder::now();
+  zeModule = createModule(queue->zeContext_, queue->zeDevice_,
+                          syclQueue.get_device(), desc, specConstants);
+  if (imex::TraceRecorder::get().isEnabled()) {
+    std::string args = "\"bytes\":" + std::to_string(dataSize);
+    if (!specConstants.empty())
+      args += ",\"spec_constants\":\"" + specConstants.toString() + "\"";
+    traceHostEvent("module", "module load", start, args);
+  }
+  auto &entry = moduleCache[std::move(cacheKey)];
+  entry.module = zeModule;
+  entry.context = queue->syclContext_;
+  moduleHandles[zeModule] = &entry;
   return zeModule;
 }
 
@@ -240,6 +546,15 @@ static sycl::kernel *getKernel(GPUSYCLQUEUE *queue, ze_module_handle_t zeModule,
                                const char *name) {
   assert(zeModule);
   assert(name);
+  std::lock_guard<std::mutex> entryLock(mutexLock);
+  auto it = moduleHandles.find(zeModule);
+  if (it == moduleHandles.end())
+    throw std::runtime_error("Module was not loaded by gpuModuleLoad");
+  auto &kernels = it->second->kernels;
+  auto kernelIt = kernels.find(name);
+  if (kernelIt != kernels.end())
+    return kernelIt->second;
+
   auto syclQueue = queue->syclQueue_;
   ze_kernel_handle_t zeKernel;
   sycl::kernel *syclKernel;
@@ -255,12 +570,14 @@ static sycl::kernel *getKernel(GPUSYCLQUEUE *queue, ze_module_handle_t zeModule,
   auto kernel = sycl::make_kernel<sycl::backend::ext_oneapi_level_zero>(
       {kernelBundle, zeKernel}, syclQueue.get_context());
   syclKernel = new sycl::kernel(kernel);
+  kernels.emplace(name, syclKernel);
   return syclKernel;
 }
 
 static sycl::event enqueueKernel(sycl::queue queue, sycl::kernel *kernel,
                                  sycl::nd_range<3> NdRange, ParamDesc *params,
-                                 size_t sharedMemBytes) {
+                                 size_t sharedMemBytes,
+                                 const std::vector<sycl::event> &deps = {}) {
   auto paramsCount = countUntil(params, ParamDesc{nullptr, 0});
   // The assumption is, if there is a param for the shared local memory,
   // then that will always be the last argument.
@@ -268,6 +585,7 @@ static sycl::event enqueueKernel(sycl::queue queue, sycl::kernel *kernel,
     paramsCount = paramsCount - 1;
   }
   sycl::event event = queue.submit([&](sycl::handler &cgh) {
+    cgh.depends_on(deps);
     for (size_t i = 0; i < paramsCount; i++) {
       auto param = params[i];
       cgh.set_arg(static_cast<uint32_t>(i),
@@ -289,10 +607,14 @@ static sycl::event enqueueKernel(sycl::queue queue, sycl::kernel *kernel,
   return event;
 }
 
-static void launchKernel(GPUSYCLQUEUE *queue, sycl::kernel *kernel,
-                         size_t gridX, size_t gridY, size_t gridZ,
-                         size_t blockX, size_t blockY, size_t blockZ,
-                         size_t sharedMemBytes, ParamDesc *params) {
+// Launches the kernel once the commands of `deps` have completed, or after all
+// commands submitted so far if `deps` is null. Returns the token of the
+// launch.
+static void *launchKernel(GPUSYCLQUEUE *queue, sycl::kernel *kernel,
+                          size_t gridX, size_t gridY, size_t gridZ,
+                          size_t blockX, size_t blockY, size_t blockZ,
+                          size_t sharedMemBytes, ParamDesc *params,
+                          void **deps, size_t numDeps) {
   auto syclQueue = queue->syclQueue_;
   auto syclGlobalRange =
       ::sycl::range<3>(blockZ * gridZ, blockY * gridY, blockX * gridX);
@@ -301,89 +623,92 @@ static void launchKernel(GPUSYCLQUEUE *queue, sycl::kernel *kernel,
       sycl::nd_range<3>(syclGlobalRange, syclLocalRange));
 
   if (getenv("IMEX_ENABLE_PROFILING")) {
-    auto executionTime = 0.0f;
-    auto maxTime = 0.0f;
-    auto minTime = FLT_MAX;
-    auto rounds = 100;
-    auto warmups = 3;
+    auto &profiler = queue->profiler_;
+    profiler.init(queue->syclDevice_, queue->pool_.getBackend());
+    auto name = kernel->get_info<sycl::info::kernel::function_name>();
+    auto rounds = profiler.options.getRuns(name);
 
-    // Before each run we need to flush the L3 cache (global memory cache) to
-    // make sure each profiling run has the same cache state. This is done by
-    // writing 'zero' to a global device memory buffer larger than the L3 cache
-    // size. This way, any data in the cache from previous run is evicted and we
-    // get a cold cache behavior. The write to the buffer is 'cached' in other
-    // words, the write goes through the L3 (global memory cache).
-    size_t cacheSize =
-        queue->syclDevice_
-            .get_info<sycl::info::device::global_mem_cache_size>();
-
-    // Allocate a device memory buffer twice the size of the
-    // L3 cache (global memory cache) of the device.
-    // The buffer can be host_shared or device-only, for our use-case we choose
-    // it to be device-only, it removes the need for extra copy from/to host.
-    // More importantly, it removes the possiblity of accidentally doing the
-    // flush in the host-side using a host side function.
-    auto *cache = allocDeviceMemory(queue, 2 * cacheSize, 64, false);
-
-    if (getenv("IMEX_PROFILING_RUNS")) {
-      auto runs = strtol(getenv("IMEX_PROFILING_RUNS"), NULL, 10L);
-      if (runs)
-        rounds = runs;
-    }
-
-    if (getenv("IMEX_PROFILING_WARMUPS")) {
-      auto runs = strtol(getenv("IMEX_PROFILING_WARMUPS"), NULL, 10L);
-      if (warmups)
-        warmups = runs;
-    }
+    // Profiled runs are timed in isolation.
+    queue->waitAll();
 
     // warmups
-    for (int r = 0; r < warmups; r++) {
+    for (int r = 0; r < profiler.options.warmups; r++) {
       auto e =
           enqueueKernel(syclQueue, kernel, syclNdRange, params, sharedMemBytes);
       e.wait();
     }
 
+    std::vector<double> times;
+    times.reserve(rounds);
     for (int r = 0; r < rounds; r++) {
       // Flush the L3 cache (global memory cache).
-      if (getenv("IMEX_ENABLE_CACHE_FLUSHING")) {
+      std::vector<sycl::event> flush;
+      if (profiler.flushBuffer) {
         int init_val = 0;
-        syclQueue.memset(cache, init_val, cacheSize);
+        flush.push_back(syclQueue.memset(profiler.flushBuffer, init_val,
+                                         profiler.cacheSize));
       }
-      sycl::event event =
-          enqueueKernel(syclQueue, kernel, syclNdRange, params, sharedMemBytes);
+      sycl::event event = enqueueKernel(syclQueue, kernel, syclNdRange, params,
+                                        sharedMemBytes, flush);
       event.wait();
 
       auto startTime = event.get_profiling_info<
           cl::sycl::info::event_profiling::command_start>();
       auto endTime = event.get_profiling_info<
           cl::sycl::info::event_profiling::command_end>();
-      auto gap = float(endTime - startTime) / 1000000.0f;
-      executionTime += gap;
-      if (gap > maxTime)
-        maxTime = gap;
-      if (gap < minTime)
-        minTime = gap;
+      times.push_back(double(endTime - startTime) / 1e6);
     }
+    imex::printKernelProfile("", name, std::move(times));
+    // All runs have completed.
+    return nullptr;
+  }
+
+  auto submitTime = imex::TraceRecorder::now();
+  auto event = enqueueKernel(syclQueue, kernel, syclNdRange, params,
+                             sharedMemBytes, queue->getEvents(deps, numDeps));
+  if (imex::TraceRecorder::get().isEnabled()) {
+    imex::TraceEvent traceEvent;
+    traceEvent.category = "kernel";
+    traceEvent.name = kernel->get_info<sycl::info::kernel::function_name>();
+    traceEvent.args = "\"grid\":[" + std::to_string(gridX) + "," +
+                      std::to_string(gridY) + "," + std::to_string(gridZ) +
+                      "],\"group\":[" + std::to_string(blockX) + "," +
+                      std::to_string(blockY) + "," + std::to_string(blockZ) +
+                      "],\"sharedMemBytes\":" + std::to_string(sharedMemBytes);
+    queue->trace(event, submitTime, std::move(traceEvent));
+  }
+  return queue->record(event);
+}
 
-    deallocDeviceMemory(queue, cache);
-    fprintf(stdout,
-            "the kernel execution time is (ms):"
-            "avg: %.4f, min: %.4f, max: %.4f (over %d runs)\n",
-            executionTime / rounds, minTime, maxTime, rounds);
-  } else {
-    enqueueKernel(syclQueue, kernel, syclNdRange, params, sharedMemBytes);
+static sycl::property_list getQueueProperties() {
+  // Traces read the device timestamps of commands unless timed on the host.
+  auto &recorder = imex::TraceRecorder::get();
+  if (getenv("IMEX_ENABLE_PROFILING") ||
+      (recorder.isEnabled() && !recorder.useHostTimer())) {
+    return sycl::property_list{sycl::property::queue::enable_profiling()};
   }
+  return sycl::property_list{};
+}
+
+// The streams created by gpuGetSharedStream. Like kernels, they are not
+// released at exit, the SYCL runtime may already be torn down by then.
+// gpuDestroySharedStreams destroys them explicitly.
+struct SharedStreams {
+  std::mutex mutex;
+  // The module global caching each stream, and the stream.
+  std::vector<std::pair<GPUSYCLQUEUE **, GPUSYCLQUEUE *>> streams;
+};
+
+static SharedStreams &getSharedStreams() {
+  static SharedStreams *sharedStreams = new SharedStreams();
+  return *sharedStreams;
 }
 
 // Wrappers
 
 extern "C" SYCL_RUNTIME_EXPORT GPUSYCLQUEUE *gpuCreateStream(void *device,
                                                              void *context) {
-  auto propList = sycl::property_list{};
-  if (getenv("IMEX_ENABLE_PROFILING")) {
-    propList = sycl::property_list{sycl::property::queue::enable_profiling()};
-  }
+  auto propList = getQueueProperties();
   return catchAll([&]() {
     if (!device && !context) {
       return new GPUSYCLQUEUE(propList);
@@ -400,6 +725,49 @@ extern "C" SYCL_RUNTIME_EXPORT GPUSYCLQUEUE *gpuCreateStream(void *device,
   });
 }
 
+// Creates a stream on the device `deviceIndex`. Every stream has its own
+// SYCL queue, which the SYCL runtime maps to the hardware queues of the device
+// and whose copies it submits to copy engines, so `queueIndex` is not needed.
+extern "C" SYCL_RUNTIME_EXPORT GPUSYCLQUEUE *
+gpuCreateStreamOnDevice(int32_t deviceIndex, int32_t queueIndex) {
+  auto propList = getQueueProperties();
+  return catchAll([&]() {
+    auto device = getDefaultDevice(static_cast<size_t>(deviceIndex));
+    return new GPUSYCLQUEUE(&device, propList);
+  });
+}
+
+// Returns the stream cached in `slot`, and creates it on the device
+// `deviceIndex` on first use. The stream is shared by all calls until program
+// exit.
+extern "C" SYCL_RUNTIME_EXPORT GPUSYCLQUEUE *
+gpuGetSharedStream(GPUSYCLQUEUE **slot, int32_t deviceIndex,
+                   int32_t queueIndex) {
+  return catchAll([&]() {
+    auto &sharedStreams = getSharedStreams();
+    std::lock_guard<std::mutex> lock(sharedStreams.mutex);
+    if (!*slot) {
+      *slot = gpuCreateStreamOnDevice(deviceIndex, queueIndex);
+      sharedStreams.streams.emplace_back(slot, *slot);
+    }
+    return *slot;
+  });
+}
+
+// Destroys the shared streams, for hosts that unload the modules using them
+// before exit. They are created again on their next use.
+extern "C" SYCL_RUNTIME_EXPORT void gpuDestroySharedStreams() {
+  catchAll([&]() {
+    auto &sharedStreams = getSharedStreams();
+    std::lock_guard<std::mutex> lock(sharedStreams.mutex);
+    for (auto &it : sharedStreams.streams) {
+      *it.first = nullptr;
+      delete it.second;
+    }
+    sharedStreams.streams.clear();
+  });
+}
+
 extern "C" SYCL_RUNTIME_EXPORT void gpuStreamDestroy(GPUSYCLQUEUE *queue) {
   catchAll([&]() { delete queue; });
 }
@@ -408,6 +776,7 @@ extern "C" SYCL_RUNTIME_EXPORT void *
 gpuMemAlloc(GPUSYCLQUEUE *queue, size_t size, size_t alignment, bool isShared) {
   return catchAll([&]() {
     if (queue) {
+      std::lock_guard<std::mutex> lock(queue->mutex_);
       return allocDeviceMemory(queue, size, alignment, isShared);
     }
   });
@@ -416,11 +785,40 @@ gpuMemAlloc(GPUSYCLQUEUE *queue, size_t size, size_t alignment, bool isShared) {
 extern "C" SYCL_RUNTIME_EXPORT void gpuMemFree(GPUSYCLQUEUE *queue, void *ptr) {
   catchAll([&]() {
     if (queue && ptr) {
+      std::lock_guard<std::mutex> lock(queue->mutex_);
       deallocDeviceMemory(queue, ptr);
     }
   });
 }
 
+extern "C" SYCL_RUNTIME_EXPORT void
+gpuMemCopy(GPUSYCLQUEUE *queue, void *dst, void *src, size_t size) {
+  catchAll([&]() {
+    if (queue) {
+      std::lock_guard<std::mutex> lock(queue->mutex_);
+      auto event =
+          copyMemory(queue, dst, src, size, queue->getEvents(nullptr, 0));
+      if (queue->capturing_)
+        queue->record(event);
+      else
+        event.wait();
+    }
+  });
+}
+
+extern "C" SYCL_RUNTIME_EXPORT void *
+gpuMemCopyAsync(GPUSYCLQUEUE *queue, void *dst, void *src, size_t size,
+                void **deps, size_t numDeps) {
+  return catchAll([&]() -> void * {
+    if (queue) {
+      std::lock_guard<std::mutex> lock(queue->mutex_);
+      return queue->record(
+          copyMemory(queue, dst, src, size, queue->getEvents(deps, numDeps)));
+    }
+    return nullptr;
+  });
+}
+
 extern "C" SYCL_RUNTIME_EXPORT ze_module_handle_t
 gpuModuleLoad(GPUSYCLQUEUE *queue, const void *data, size_t dataSize) {
   return catchAll([&]() {
@@ -430,6 +828,31 @@ gpuModuleLoad(GPUSYCLQUEUE *queue, const void *data, size_t dataSize) {
   });
 }
 
+// Returns the kernel `name` of the module built with the given values of its
+// specialization constants. `slot` caches the kernel of the launch site, the
+// module and kernel caches are only consulted when the values, or the context
+// or device of the stream, change. Kernels without specialization constants
+// pass no values.
+extern "C" SYCL_RUNTIME_EXPORT sycl::kernel *
+gpuKernelGetSpecialized(GPUSYCLQUEUE *queue, void **slot, const void *data,
+                        size_t dataSize, const char *name,
+                        const uint32_t *specIds, const int64_t *specValues,
+                        size_t numSpecs) {
+  return catchAll([&]() {
+    if (queue) {
+      return static_cast<sycl::kernel *>(imex::getSpecializedKernel(
+          slot, reinterpret_cast<uintptr_t>(queue->zeContext_),
+          queue->zeDevice_, specIds, specValues, numSpecs,
+          [&]() -> void * {
+            auto module = loadModule(
+                queue, data, dataSize,
+                imex::SpecConstants(specIds, specValues, numSpecs));
+            return getKernel(queue, module, name);
+          }));
+    }
+  });
+}
+
 extern "C" SYCL_RUNTIME_EXPORT sycl::kernel *
 gpuKernelGet(GPUSYCLQUEUE *queue, ze_module_handle_t module, const char *name) {
   return catchAll([&]() {
@@ -445,17 +868,99 @@ gpuLaunchKernel(GPUSYCLQUEUE *queue, sycl::kernel *kernel, size_t gridX,
                 size_t blockZ, size_t sharedMemBytes, void *params) {
   return catchAll([&]() {
     if (queue) {
+      // Ordered after all commands submitted so far, completes with gpuWait.
+      std::lock_guard<std::mutex> lock(queue->mutex_);
       launchKernel(queue, kernel, gridX, gridY, gridZ, blockX, blockY, blockZ,
-                   sharedMemBytes, static_cast<ParamDesc *>(params));
+                   sharedMemBytes, static_cast<ParamDesc *>(params), nullptr,
+                   0);
+    }
+  });
+}
+
+extern "C" SYCL_RUNTIME_EXPORT void *
+gpuLaunchKernelAsync(GPUSYCLQUEUE *queue, sycl::kernel *kernel, size_t gridX,
+                     size_t gridY, size_t gridZ, size_t blockX, size_t blockY,
+                     size_t blockZ, size_t sharedMemBytes, void *params,
+                     void **deps, size_t numDeps) {
+  return catchAll([&]() -> void * {
+    if (queue) {
+      std::lock_guard<std::mutex> lock(queue->mutex_);
+      return launchKernel(queue, kernel, gridX, gridY, gridZ, blockX, blockY,
+                          blockZ, sharedMemBytes,
+                          static_cast<ParamDesc *>(params), deps, numDeps);
+    }
+    return nullptr;
+  });
+}
+
+// Returns a token that completes with the commands of `deps`.
+extern "C" SYCL_RUNTIME_EXPORT void *
+gpuEventJoin(GPUSYCLQUEUE *queue, void **deps, size_t numDeps) {
+  return catchAll([&]() -> void * {
+    if (queue) {
+      std::lock_guard<std::mutex> lock(queue->mutex_);
+      auto events = queue->getEvents(deps, numDeps);
+      if (events.empty())
+        return nullptr;
+      return queue->record(queue->syclQueue_.ext_oneapi_submit_barrier(events));
+    }
+    return nullptr;
+  });
+}
+
+// Blocks the host until the commands of `deps` have completed.
+extern "C" SYCL_RUNTIME_EXPORT void
+gpuWaitEvents(GPUSYCLQUEUE *queue, void **deps, size_t numDeps) {
+  catchAll([&]() {
+    if (queue) {
+      std::lock_guard<std::mutex> lock(queue->mutex_);
+      for (size_t i = 0; i < numDeps; ++i) {
+        auto it = queue->pending_.find(reinterpret_cast<uintptr_t>(deps[i]));
+        if (it == queue->pending_.end())
+          continue;
+        it->second.wait();
+        queue->pending_.erase(it);
+      }
     }
   });
 }
 
+// Blocks the host until all commands submitted to the queue have completed.
+// Inside a graph, commands are already ordered after all commands submitted
+// before them and the host only waits at the end of the graph.
 extern "C" SYCL_RUNTIME_EXPORT void gpuWait(GPUSYCLQUEUE *queue) {
 
   catchAll([&]() {
     if (queue) {
-      queue->syclQueue_.wait();
+      std::lock_guard<std::mutex> lock(queue->mutex_);
+      if (queue->capturing_)
+        return;
+      queue->waitAll();
+      queue->pool_.trim(
+          [&](uint64_t fence) { return queue->isComplete(fence); });
+    }
+  });
+}
+
+// SYCL has no portable way to record and replay command sequences, a graph
+// submits its commands as they come and waits for them once at the end.
+extern "C" SYCL_RUNTIME_EXPORT void gpuGraphBegin(GPUSYCLQUEUE *queue,
+                                                  const void *graph) {
+  catchAll([&]() {
+    if (queue && !getenv("IMEX_ENABLE_PROFILING")) {
+      std::lock_guard<std::mutex> lock(queue->mutex_);
+      queue->capturing_ = true;
+    }
+  });
+}
+
+extern "C" SYCL_RUNTIME_EXPORT void gpuGraphEnd(GPUSYCLQUEUE *queue,
+                                                const void *graph) {
+  catchAll([&]() {
+    if (queue) {
+      std::lock_guard<std::mutex> lock(queue->mutex_);
+      queue->capturing_ = false;
+      queue->waitAll();
     }
   });
 }
@@ -12,6 +12,8 @@
 /// and
 ///     replace bf16 dtype with bitwidth equal i16 type
 ///     rewrite bf16 compute as bf16 extended, f32 compute, f32 truncated
+///     with keep-f32-chains, chains of bf16 compute stay in f32 and are only
+///     truncated once for users that are not computed in f32 (e.g. stores)
 ///
 //===----------------------------------------------------------------------===//
 
@@ -19,6 +21,7 @@
 #include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/GPU/IR/GPUDialect.h"
+#include "mlir/IR/Dominance.h"
 #include "mlir/IR/IRMapping.h"
 #include "mlir/IR/TypeUtilities.h"
 #include <mlir/Dialect/Bufferization/Transforms/BufferViewFlowAnalysis.h>
@@ -46,15 +49,7 @@ public:
         if (m) {
           Type et = m.getElementType();
           if (et.isBF16()) {
-            if (m.hasStaticShape()) {
-              llvm::ArrayRef<int64_t> s = m.getShape();
-              auto i = MemRefType::get(s, builder.getI16Type());
-              argTypes.push_back(i);
-            } else {
-              // TODO: Support dynamic shape
-              op.emitError(
-                  "Non static shape bf16 MemRefType in GPUFuncOp inputs");
-            }
+            argTypes.push_back(m.cloneWith(m.getShape(), builder.getI16Type()));
           } else {
             argTypes.push_back(t);
           }
@@ -95,22 +90,36 @@ public:
             }
             return WalkResult::advance();
           });
+      // With keep-f32-chains, f32 counterparts of bf16 values. A widened op
+      // records its f32 result for the truncated value, so that a following
+      // widened op consumes the f32 value directly instead of extending the
+      // truncated one again. Extensions are also reused by later users they
+      // dominate. Intermediate results are then no longer rounded to bf16.
+      llvm::DenseMap<Value, Value> f32Values;
+      SmallVector<Operation *, 8> truncOps;
+      DominanceInfo domInfo(op);
+      auto getF32Value = [&](Operation *user, Value v) -> Value {
+        auto it = f32Values.find(v);
+        if (it != f32Values.end() &&
+            domInfo.properlyDominates(it->second, user))
+          return it->second;
+        Type newTy = builder.getF32Type();
+        if (auto vecTy = mlir::dyn_cast<VectorType>(v.getType()))
+          newTy = VectorType::get(vecTy.getShape(), builder.getF32Type());
+        builder.setInsertionPoint(user);
+        auto newOp = builder.create<arith::ExtFOp>(user->getLoc(), newTy, v);
+        if (keepF32Chains)
+          f32Values[v] = newOp;
+        return newOp;
+      };
       for (Operation *o : widenOps) {
-        builder.setInsertionPoint(o);
         unsigned int idx = 0;
         for (const auto &oper : o->getOperands()) {
           if (auto vecTy = mlir::dyn_cast<VectorType>(oper.getType())) {
-            if (vecTy.getElementType().isBF16()) {
-              auto newTy =
-                  VectorType::get(vecTy.getShape(), builder.getF32Type());
-              auto newOp =
-                  builder.create<arith::ExtFOp>(o->getLoc(), newTy, oper);
-              o->setOperand(idx, newOp);
-            }
+            if (vecTy.getElementType().isBF16())
+              o->setOperand(idx, getF32Value(o, oper));
           } else if (oper.getType().isBF16()) {
-            auto newOp = builder.create<arith::ExtFOp>(
-                o->getLoc(), builder.getF32Type(), oper);
-            o->setOperand(idx, newOp);
+            o->setOperand(idx, getF32Value(o, oper));
           }
           idx++;
         }
@@ -126,6 +135,10 @@ public:
               auto newRes =
                   builder.create<arith::TruncFOp>(o->getLoc(), newTy, res);
               res.replaceAllUsesExcept(newRes, newRes);
+              if (keepF32Chains) {
+                f32Values[newRes] = res;
+                truncOps.push_back(newRes);
+              }
             }
           } else if (res.getType().isBF16()) {
             res.setType(builder.getF32Type());
@@ -133,9 +146,18 @@ public:
             auto newRes = builder.create<arith::TruncFOp>(
                 o->getLoc(), builder.getBF16Type(), res);
             res.replaceAllUsesExcept(newRes, newRes);
+            if (keepF32Chains) {
+              f32Values[newRes] = res;
+              truncOps.push_back(newRes);
+            }
           }
         }
       }
+      // Truncations only consumed by widened ops are dead now.
+      for (Operation *t : truncOps) {
+        if (t->use_empty())
+          t->erase();
+      }
       //  1-3: Change element type of entry block arguments
       //  This step replaces all external sources of bf16 with i16
       //  and the effect is propagated to the entire gpu.func
@@ -339,24 +361,16 @@ public:
         // op is the defining Operation*
         else if (isa<gpu::AllocOp>(dop)) {
           auto alloc = dyn_cast<gpu::AllocOp>(dop);
-          // TODO: Support dynamic size
-          if (alloc.getDynamicSizes().size() != 0) {
-            op->emitError("gpu::AllocOp with Dynamic size is not supported!");
-          }
           auto t = alloc.getType();
-          // TODO: does the check above make this check redundant?
-          if (!t.hasStaticShape()) {
-            op->emitError("gpu::AllocOp with Dynamic shape is not supported!");
-          }
           auto et = t.getElementType();
           builder.setInsertionPoint(dop);
           auto zero = builder.create<arith::ConstantIndexOp>(alloc.getLoc(), 0);
-          // get shape of kernel operand and construct a same shape
+          // get shape of root alloc and construct a same shape
           // type with i16
-          MemRefType m = mlir::dyn_cast<MemRefType>(kop.getType());
-          llvm::ArrayRef<int64_t> s = m.getShape();
+          llvm::ArrayRef<int64_t> s = t.getShape();
           auto itype = MemRefType::get(s, builder.getI16Type());
-          ValueRange sizes;
+          // Dynamic sizes of the root alloc are forwarded to the views
+          ValueRange sizes = alloc.getDynamicSizes();
           memref::ViewOp i16View = nullptr;
           // Different cases of root alloc
           // 1) bf16: create flat i8 alloc
@@ -382,11 +396,23 @@ public:
             }
             int64_t bsize = 1;
             for (int64_t d : s) {
-              bsize *= d;
+              if (!ShapedType::isDynamic(d))
+                bsize *= d;
             }
             bsize *= 2; // bf16 is twice the bit length of i8
             llvm::SmallVector<int64_t, 1> fshape;
-            fshape.push_back(bsize);
+            llvm::SmallVector<Value, 1> fsizes;
+            if (t.hasStaticShape()) {
+              fshape.push_back(bsize);
+            } else {
+              // Flat size in bytes is computed at runtime
+              fshape.push_back(ShapedType::kDynamic);
+              Value bytes = builder.create<arith::ConstantIndexOp>(
+                  alloc.getLoc(), bsize);
+              for (Value d : alloc.getDynamicSizes())
+                bytes = builder.create<arith::MulIOp>(alloc.getLoc(), bytes, d);
+              fsizes.push_back(bytes);
+            }
             auto ftype = MemRefType::get(fshape, builder.getI8Type());
             // Collect allocs to be removed later
             replacedAllocOps.push_back(dop);
@@ -395,8 +421,8 @@ public:
                 alloc.getLoc(), ftype,
                 alloc.getAsyncToken() ? alloc.getAsyncToken().getType()
                                       : nullptr,
-                alloc.getAsyncDependencies(), alloc.getDynamicSizes(),
-                alloc.getSymbolOperands(), alloc.getHostShared());
+                alloc.getAsyncDependencies(), fsizes, alloc.getSymbolOperands(),
+                alloc.getHostShared());
             // Create two views
             // 1) bf16
             // 2) i16
@@ -429,7 +455,11 @@ public:
             Operation *bf16ViewOp = (*it).getOperation();
             Type t = bf16ViewOp->getResultTypes().front();
             MemRefType mt = dyn_cast<MemRefType>(t);
-            if (!mt.hasStaticShape()) {
+            // Dynamic sizes, offsets and strides of these views are operands
+            // and carry over to the i16 view.
+            if (!mt.hasStaticShape() &&
+                !isa<memref::SubViewOp, memref::ViewOp, memref::CastOp,
+                     memref::ReinterpretCastOp>(bf16ViewOp)) {
               op->emitError(
                   "Parent views with dynamic shape is not supported.");
             }
@@ -521,15 +551,8 @@ public:
               if (m) {
                 Type et = m.getElementType();
                 if (et.isBF16()) {
-                  if (m.hasStaticShape()) {
-                    llvm::ArrayRef<int64_t> s = m.getShape();
-                    auto i = MemRefType::get(s, builder.getI16Type());
-                    argTypes.push_back(i);
-                  } else {
-                    // TODO: Support dynamic shape
-                    caller.emitError(
-                        "Non static shape bf16 MemRefType in FuncOp inputs");
-                  }
+                  argTypes.push_back(
+                      m.cloneWith(m.getShape(), builder.getI16Type()));
                 } else {
                   argTypes.push_back(t);
                 }
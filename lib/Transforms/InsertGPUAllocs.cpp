@@ -16,6 +16,14 @@
 /// gpu.alloc op, because all the operations under the gpu.launch op are device
 /// side computations and will execute on the device.
 ///
+/// Host buffers (function arguments, globals and call results) used by kernels
+/// get a device copy, allocated once at the beginning of the function and
+/// transferred at most once in each direction: in if the device reads it, back
+/// if the device writes it. Buffers only read by the device are host_shared.
+/// With device-local-outputs, buffers written by the device and not accessed
+/// by other host ops are allocated in device-local memory and transferred with
+/// gpu.memcpy.
+///
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Threading.h"
@@ -372,7 +380,8 @@ public:
     }
 
     auto add_gpu_alloc = [this](mlir::OpBuilder builder, mlir::Value op,
-                                AccessType access, auto term) {
+                                AccessType access, auto term,
+                                bool deviceOnly) {
       llvm::SmallVector<mlir::Value> dims;
       llvm::SmallPtrSet<mlir::Operation *, 8> filter;
       auto memrefType = mlir::cast<mlir::MemRefType>(op.getType());
@@ -394,15 +403,24 @@ public:
           memrefType.getShape(), memrefType.getElementType(),
           mlir::MemRefLayoutAttrInterface{}, memrefType.getMemorySpace());
       if (m_clientAPI == "opencl") {
-        bool hostShared = access.hostRead || access.hostWrite;
+        // Buffers written by the device and only accessed through the
+        // transfers on the host side can live in device-local memory.
+        bool deviceLocal = deviceLocalOutputs && deviceOnly &&
+                           access.deviceWrite && allocType == memrefType;
+        bool hostShared = !deviceLocal && (access.hostRead || access.hostWrite);
         auto gpuAlloc = builder.create<mlir::gpu::AllocOp>(
             loc, allocType, /*asyncToken*/ nullptr,
             /*asyncDependencies*/ std::nullopt, dims,
             /*symbolOperands*/ std::nullopt, hostShared);
         auto allocResult = gpuAlloc.getResult(0);
         if (access.hostWrite && access.deviceRead) {
-          auto copy =
-              builder.create<mlir::memref::CopyOp>(loc, op, allocResult);
+          mlir::Operation *copy;
+          if (deviceLocal)
+            copy = builder.create<mlir::gpu::MemcpyOp>(
+                loc, /*asyncToken*/ mlir::Type(),
+                /*asyncDependencies*/ mlir::ValueRange(), allocResult, op);
+          else
+            copy = builder.create<mlir::memref::CopyOp>(loc, op, allocResult);
           filter.insert(copy);
         }
 
@@ -421,7 +439,12 @@ public:
           op.replaceAllUsesExcept(allocResult, filter);
           builder.setInsertionPoint(term);
           if (access.hostRead && access.deviceWrite) {
-            builder.create<mlir::memref::CopyOp>(loc, allocResult, op);
+            if (deviceLocal)
+              builder.create<mlir::gpu::MemcpyOp>(
+                  loc, /*asyncToken*/ mlir::Type(),
+                  /*asyncDependencies*/ mlir::ValueRange(), op, allocResult);
+            else
+              builder.create<mlir::memref::CopyOp>(loc, allocResult, op);
           }
           builder.create<mlir::gpu::DeallocOp>(loc, std::nullopt, allocResult);
         }
@@ -461,10 +484,11 @@ public:
     for (auto &it : gpuGetMemrefGlobalParams) {
       auto getGlobalOp = mlir::cast<mlir::memref::GetGlobalOp>(it.first);
       auto access = getAccessType(getGlobalOp);
+      bool deviceOnly = !access.hostRead && !access.hostWrite;
       access.hostRead = true;
       access.hostWrite = true;
       builder.setInsertionPointAfter(getGlobalOp);
-      add_gpu_alloc(builder, getGlobalOp, access, term);
+      add_gpu_alloc(builder, getGlobalOp, access, term, deviceOnly);
     }
 
     // This is the case where the inputs are passed as arguments to the
@@ -473,10 +497,11 @@ public:
     for (const auto &it : gpuBufferParams) {
       auto param = block.getArgument(it.first);
       auto access = getAccessType(param);
+      bool deviceOnly = !access.hostRead && !access.hostWrite;
       access.hostRead = true;
       access.hostWrite = true;
       builder.setInsertionPointToStart(&block);
-      add_gpu_alloc(builder, param, access, term);
+      add_gpu_alloc(builder, param, access, term, deviceOnly);
     }
 
     // CallOp Case: This is the case where the memref producer is coming
@@ -492,7 +517,7 @@ public:
       access.hostRead = true;
       access.hostWrite = true;
       builder.setInsertionPointAfter(op);
-      add_gpu_alloc(builder, callOp, access, term);
+      add_gpu_alloc(builder, callOp, access, term, /*deviceOnly*/ false);
     }
   }
 
@@ -0,0 +1,69 @@
+//===- LinalgElementwiseFusion.cpp - fuse linalg producers ------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This pass fuses elementwise linalg.generic producers into their consumers
+/// on tensors, before bufferization. Chains of elementwise ops collapse into a
+/// single linalg.generic (loop fusion), and elementwise producers of a
+/// reduction are computed inside the reduction (input fusion). Each fused
+/// group is later lowered to a single parallel loop and GPU kernel, so the
+/// intermediates no longer round-trip through device memory.
+///
+//===----------------------------------------------------------------------===//
+
+#include "imex/Transforms/Passes.h"
+
+#include "mlir/Dialect/Linalg/IR/Linalg.h"
+#include "mlir/Dialect/Linalg/Transforms/Transforms.h"
+#include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+namespace imex {
+#define GEN_PASS_DEF_LINALGELEMENTWISEFUSION
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+using namespace mlir;
+using namespace imex;
+
+namespace {
+struct LinalgElementwiseFusionPass
+    : public imex::impl::LinalgElementwiseFusionBase<
+          LinalgElementwiseFusionPass> {
+  using LinalgElementwiseFusionBase::LinalgElementwiseFusionBase;
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    RewritePatternSet patterns(context);
+
+    // Producers with other uses would be computed once more for every
+    // consumer they are fused into. Only do so if recomputation is allowed.
+    linalg::ControlFusionFn controlFn = [&](OpOperand *fusedOperand) {
+      if (allowRecompute)
+        return true;
+      return fusedOperand->get().hasOneUse();
+    };
+    linalg::populateElementwiseOpsFusionPatterns(patterns, controlFn);
+    linalg::populateEraseUnnecessaryInputsPatterns(patterns);
+    linalg::GenericOp::getCanonicalizationPatterns(patterns, context);
+    tensor::EmptyOp::getCanonicalizationPatterns(patterns, context);
+
+    if (failed(applyPatternsAndFoldGreedily(getOperation(),
+                                            std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createLinalgElementwiseFusionPass() {
+  return std::make_unique<LinalgElementwiseFusionPass>();
+}
+} // namespace imex
@@ -9,17 +9,29 @@
 ///
 /// \file
 /// This pass lowers memref copyOp to linalg generic operations and enables
-/// simple memref copyOp canonicalization
+/// simple memref copyOp canonicalization.
+///
+/// With bulk-copies, copies between contiguous buffers are lowered to a bulk
+/// copy: gpu.memcpy if one side is device memory, otherwise a copy over the
+/// buffers collapsed to 1-D, optionally vectorized. Strided copies keep the
+/// element-wise linalg.generic form. Contiguous views of device memory with a
+/// non-identity layout, e.g. an offset, are not lowered.
 ///
 //===----------------------------------------------------------------------===//
 
 #include "imex/Transforms/Passes.h"
 
+#include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/GPU/IR/GPUDialect.h"
 #include "mlir/Dialect/Linalg/IR/Linalg.h"
 #include "mlir/Dialect/Linalg/Utils/Utils.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/MemRef/Utils/MemRefUtils.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
 #include "mlir/IR/Dominance.h"
+#include "mlir/Interfaces/ViewLikeInterface.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Support/LogicalResult.h"
 
@@ -32,51 +44,161 @@ using namespace mlir;
 using namespace imex;
 
 namespace {
+
+// Returns the memref.alloc or gpu.alloc `val` is a view of, or nullptr.
+static Operation *getAllocRoot(Value val) {
+  while (auto view = val.getDefiningOp<ViewLikeOpInterface>())
+    val = view.getViewSource();
+  Operation *op = val.getDefiningOp();
+  if (isa_and_nonnull<memref::AllocOp, gpu::AllocOp>(op))
+    return op;
+  return nullptr;
+}
+
+// Returns true if the elements of `type` are densely packed in row-major
+// order.
+static bool isContiguous(MemRefType type) {
+  if (type.getRank() == 0)
+    return false;
+  return type.getLayout().isIdentity() ||
+         memref::isStaticShapeAndContiguousRowMajor(type);
+}
+
+static Value collapseTo1D(OpBuilder &builder, Location loc, Value val) {
+  auto type = cast<MemRefType>(val.getType());
+  if (type.getRank() == 1)
+    return val;
+  SmallVector<ReassociationIndices> reassociation(1);
+  for (int64_t i = 0; i < type.getRank(); ++i)
+    reassociation[0].push_back(i);
+  return builder.create<memref::CollapseShapeOp>(loc, val, reassociation);
+}
+
+// Copies `vectorWidth` elements per iteration of a parallel loop, the
+// remainder is copied element by element.
+static void makeVectorCopy(OpBuilder &builder, Location loc, Value src,
+                           Value dst, int64_t vectorWidth) {
+  auto type = cast<MemRefType>(src.getType());
+  auto vecType = VectorType::get({vectorWidth}, type.getElementType());
+  Value c0 = builder.create<arith::ConstantIndexOp>(loc, 0);
+  Value c1 = builder.create<arith::ConstantIndexOp>(loc, 1);
+  Value width = builder.create<arith::ConstantIndexOp>(loc, vectorWidth);
+  Value size = builder.createOrFold<memref::DimOp>(loc, src, 0);
+  Value vecSize = builder.createOrFold<arith::MulIOp>(
+      loc, builder.createOrFold<arith::DivUIOp>(loc, size, width), width);
+  builder.create<scf::ParallelOp>(
+      loc, c0, vecSize, width,
+      [&](OpBuilder &b, Location bloc, ValueRange ivs) {
+        Value vec = b.create<vector::LoadOp>(bloc, vecType, src, ivs);
+        b.create<vector::StoreOp>(bloc, vec, dst, ivs);
+      });
+
+  auto staticSize = getConstantIntValue(size);
+  if (staticSize && *staticSize % vectorWidth == 0)
+    return;
+  builder.create<scf::ParallelOp>(
+      loc, vecSize, size, c1, [&](OpBuilder &b, Location bloc, ValueRange ivs) {
+        Value elem = b.create<memref::LoadOp>(bloc, src, ivs);
+        b.create<memref::StoreOp>(bloc, elem, dst, ivs);
+      });
+}
+
 struct LowerMemRefCopy
     : public imex::impl::LowerMemRefCopyBase<LowerMemRefCopy> {
+  using LowerMemRefCopyBase::LowerMemRefCopyBase;
+
   void runOnOperation() override {
     auto &domInfo = getAnalysis<DominanceInfo>();
     auto func = getOperation();
-    // walk through memref.copy ops in the funcion body
-    (void)func.walk<WalkOrder::PreOrder>([&](memref::CopyOp op) -> WalkResult {
-      if (op->getParentOp() != func)
-        return WalkResult::skip();
+    if (vectorWidth < 0) {
+      func.emitError("vector-width must not be negative");
+      return signalPassFailure();
+    }
+    // collect memref.copy ops in the function body, or outside of gpu
+    // regions with bulk-copies
+    SmallVector<memref::CopyOp> copyOps;
+    func.walk([&](memref::CopyOp op) {
+      if (bulkCopies ? !op->getParentOfType<gpu::LaunchOp>()
+                     : op->getParentOp() == func)
+        copyOps.push_back(op);
+    });
+
+    for (auto op : copyOps) {
       auto src = op.getSource();
       auto dst = op.getTarget();
-      // supposed to work on same memref type
       auto srcType = mlir::cast<MemRefType>(src.getType());
       auto dstType = mlir::cast<MemRefType>(dst.getType());
-      if (srcType != dstType)
-        return WalkResult::skip();
-      // supposed to work on memref.alloc
+      if (srcType.getShape() != dstType.getShape() ||
+          srcType.getElementType() != dstType.getElementType())
+        continue;
+
+      // coalesce buffers of same type allocated in the function body
       auto srcOp = src.getDefiningOp<memref::AllocOp>();
       auto dstOp = dst.getDefiningOp<memref::AllocOp>();
-      if (!srcOp || !dstOp)
-        return WalkResult::skip();
-      // check use of src after this copyOp, being conservative
-      // FIXME: handle dealloc of src and dst
-      bool hasSubsequentUse = false;
-      for (auto user : src.getUsers()) {
-        if (isa<memref::DeallocOp>(user)) {
+      if (srcType == dstType && srcOp && dstOp && op->getParentOp() == func) {
+        // check use of src after this copyOp, being conservative
+        // FIXME: handle dealloc of src and dst
+        bool hasSubsequentUse = false;
+        for (auto user : src.getUsers()) {
+          if (isa<memref::DeallocOp>(user)) {
+            continue;
+          }
+          if (domInfo.properlyDominates(op, user)) {
+            hasSubsequentUse = true;
+            break;
+          }
+        }
+        if (!hasSubsequentUse) {
+          dst.replaceAllUsesWith(src);
+          op.erase();
           continue;
         }
-        if (domInfo.properlyDominates(op, user)) {
-          hasSubsequentUse = true;
-          break;
+      }
+
+      if (!bulkCopies) {
+        // replace copy between allocations with linalg.generic
+        if (srcType == dstType && srcOp && dstOp) {
+          OpBuilder builder(op);
+          linalg::makeMemRefCopyOp(builder, op.getLoc(), src, dst);
+          op.erase();
         }
+        continue;
       }
 
-      // replace copy with linalg.generic
-      if (hasSubsequentUse) {
-        OpBuilder builder(op);
-        linalg::makeMemRefCopyOp(builder, op.getLoc(), src, dst);
+      // supposed to work on (views of) allocations
+      Operation *srcRoot = getAllocRoot(src);
+      Operation *dstRoot = getAllocRoot(dst);
+      if (!srcRoot || !dstRoot)
+        continue;
+
+      bool contiguous = isContiguous(srcType) && isContiguous(dstType);
+      bool onDevice = isa<gpu::AllocOp>(srcRoot) || isa<gpu::AllocOp>(dstRoot);
+      // gpu.memcpy is lowered for identity layouts only, contiguous views of
+      // device memory with an offset are left as they are
+      if (contiguous && onDevice &&
+          (!srcType.getLayout().isIdentity() ||
+           !dstType.getLayout().isIdentity()))
+        continue;
+
+      OpBuilder builder(op);
+      auto loc = op.getLoc();
+      if (!contiguous) {
+        // strided copy, element by element
+        linalg::makeMemRefCopyOp(builder, loc, src, dst);
+      } else if (onDevice) {
+        builder.create<gpu::MemcpyOp>(loc, /*asyncToken=*/Type(),
+                                      /*asyncDependencies=*/ValueRange(), dst,
+                                      src);
       } else {
-        // coalesce buffer
-        dst.replaceAllUsesWith(src);
+        Value src1D = collapseTo1D(builder, loc, src);
+        Value dst1D = collapseTo1D(builder, loc, dst);
+        if (vectorWidth > 1 && srcType.getElementType().isIntOrFloat())
+          makeVectorCopy(builder, loc, src1D, dst1D, vectorWidth);
+        else
+          linalg::makeMemRefCopyOp(builder, loc, src1D, dst1D);
       }
       op.erase();
-      return WalkResult::advance();
-    });
+    }
   }
 };
 } // namespace
@@ -0,0 +1,113 @@
+//===- MarkSpecConstants.cpp - Mark shape kernel arguments -----*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the MarkSpecConstants pass. Integer and index kernel
+/// arguments which every launch computes from memref sizes and constants only
+/// are marked with gpux.spec_id, so that they become SPIR-V specialization
+/// constants and the finalizer compiles the kernel for static shapes.
+///
+//===----------------------------------------------------------------------===//
+
+#include <imex/Transforms/Passes.h>
+
+#include <llvm/ADT/DenseMap.h>
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/IR/BuiltinOps.h>
+#include <mlir/IR/Matchers.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+
+namespace imex {
+#define GEN_PASS_DEF_MARKSPECCONSTANTS
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+namespace {
+
+static constexpr llvm::StringLiteral kSpecIdAttrName = "gpux.spec_id";
+
+// Returns true if `value` is computed by arith ops from memref sizes and
+// constants only.
+static bool isShapeValue(mlir::Value value, unsigned depth = 0) {
+  auto *op = value.getDefiningOp();
+  if (!op || depth > 8)
+    return false;
+  if (mlir::isa<mlir::memref::DimOp>(op) ||
+      mlir::matchPattern(value, mlir::m_Constant()))
+    return true;
+  if (!llvm::isa_and_nonnull<mlir::arith::ArithDialect>(op->getDialect()) ||
+      !mlir::isMemoryEffectFree(op))
+    return false;
+  return llvm::all_of(op->getOperands(), [&](mlir::Value operand) {
+    return isShapeValue(operand, depth + 1);
+  });
+}
+
+static bool isSpecializableType(mlir::Type type) {
+  if (type.isIndex())
+    return true;
+  auto intType = mlir::dyn_cast<mlir::IntegerType>(type);
+  return intType && intType.getWidth() > 1 && intType.getWidth() <= 64;
+}
+
+struct MarkSpecConstantsPass
+    : public imex::impl::MarkSpecConstantsBase<MarkSpecConstantsPass> {
+  void runOnOperation() override {
+    auto module = getOperation();
+    llvm::DenseMap<mlir::Operation *,
+                   llvm::SmallVector<mlir::gpu::LaunchFuncOp>>
+        launches;
+    module.walk([&](mlir::gpu::LaunchFuncOp launch) {
+      if (auto kernel =
+              mlir::SymbolTable::lookupNearestSymbolFrom<mlir::gpu::GPUFuncOp>(
+                  launch, launch.getKernel()))
+        launches[kernel].push_back(launch);
+    });
+
+    for (auto gpuModule : module.getOps<mlir::gpu::GPUModuleOp>()) {
+      // Ids are unique within the module, a constant is shared by all kernels
+      // marking its id.
+      uint32_t nextId = 0;
+      gpuModule.walk([&](mlir::gpu::GPUFuncOp func) {
+        for (auto i : llvm::seq(0u, func.getNumArguments()))
+          if (auto id = func.getArgAttrOfType<mlir::IntegerAttr>(
+                  i, kSpecIdAttrName))
+            nextId = std::max<uint32_t>(nextId, id.getInt() + 1);
+      });
+
+      for (auto func : gpuModule.getOps<mlir::gpu::GPUFuncOp>()) {
+        auto it = launches.find(func);
+        if (!func.isKernel() || it == launches.end())
+          continue;
+        for (auto i : llvm::seq(0u, func.getNumArguments())) {
+          if (!isSpecializableType(func.getArgument(i).getType()) ||
+              func.getArgAttr(i, kSpecIdAttrName))
+            continue;
+          bool isShape = llvm::all_of(it->second, [&](auto launch) {
+            return isShapeValue(launch.getKernelOperand(i));
+          });
+          if (isShape)
+            func.setArgAttr(i, kSpecIdAttrName,
+                            mlir::IntegerAttr::get(
+                                mlir::IntegerType::get(&getContext(), 32),
+                                nextId++));
+        }
+      }
+    }
+  }
+};
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createMarkSpecConstantsPass() {
+  return std::make_unique<MarkSpecConstantsPass>();
+}
+} // namespace imex
@@ -0,0 +1,302 @@
+//===- ParallelizeReductions.cpp - parallelize reduction loops --*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This pass turns top-level scf.for nests that reduce into a single memref
+/// location into an scf.parallel loop. The iteration space is split into
+/// chunks, each work-item reduces its chunk in registers and the partial
+/// results are combined with a single memref.atomic_rmw per work-item.
+/// Without this, imex-add-outer-parallel-loop wraps such loops in a 0..1
+/// parallel loop and the reduction runs on a single GPU work-item.
+///
+//===----------------------------------------------------------------------===//
+
+#include "imex/Transforms/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/GPU/IR/GPUDialect.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
+#include "mlir/Interfaces/LoopLikeInterface.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Interfaces/ViewLikeInterface.h"
+#include "mlir/Pass/Pass.h"
+
+#include <optional>
+
+namespace imex {
+#define GEN_PASS_DEF_PARALLELIZEREDUCTIONS
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+using namespace mlir;
+using namespace imex;
+
+namespace {
+
+// A reduction into a fixed memref location inside the innermost loop:
+//   %acc = memref.load %out[%idx...]
+//   %new = <combiner> %acc, %contrib
+//   memref.store %new, %out[%idx...]
+struct ReductionInfo {
+  memref::LoadOp load;
+  Operation *combiner;
+  memref::StoreOp store;
+  arith::AtomicRMWKind kind;
+};
+
+// Returns the atomic kind matching the combiner, if the combiner and its type
+// can be combined atomically on the device.
+static std::optional<arith::AtomicRMWKind> getAtomicKind(Operation *op) {
+  Type type = op->getResult(0).getType();
+  if (isa<arith::AddFOp>(op) && type.isF32())
+    return arith::AtomicRMWKind::addf;
+  if (!type.isInteger(32) && !type.isInteger(64))
+    return std::nullopt;
+  if (isa<arith::AddIOp>(op))
+    return arith::AtomicRMWKind::addi;
+  if (isa<arith::MaxSIOp>(op))
+    return arith::AtomicRMWKind::maxs;
+  if (isa<arith::MinSIOp>(op))
+    return arith::AtomicRMWKind::mins;
+  if (isa<arith::MaxUIOp>(op))
+    return arith::AtomicRMWKind::maxu;
+  if (isa<arith::MinUIOp>(op))
+    return arith::AtomicRMWKind::minu;
+  if (isa<arith::AndIOp>(op))
+    return arith::AtomicRMWKind::andi;
+  if (isa<arith::OrIOp>(op))
+    return arith::AtomicRMWKind::ori;
+  return std::nullopt;
+}
+
+// Returns the buffer `memref` is a view of.
+static Value getBaseBuffer(Value memref) {
+  while (auto view = memref.getDefiningOp<ViewLikeOpInterface>())
+    memref = view.getViewSource();
+  return memref;
+}
+
+// Returns true if `lhs` and `rhs` may access the same buffer. Views are
+// traced back to their base buffer. Distinct allocations and function
+// arguments are assumed not to alias, as bufferization does at function
+// boundaries. Buffers of any other origin may alias anything.
+static bool mayAlias(Value lhs, Value rhs) {
+  lhs = getBaseBuffer(lhs);
+  rhs = getBaseBuffer(rhs);
+  if (lhs == rhs)
+    return true;
+
+  auto isKnownBuffer = [](Value buffer) {
+    if (auto arg = dyn_cast<BlockArgument>(buffer))
+      return arg.getOwner()->isEntryBlock() &&
+             isa<FunctionOpInterface>(arg.getOwner()->getParentOp());
+    Operation *def = buffer.getDefiningOp();
+    return def && hasSingleEffect<MemoryEffects::Allocate>(def, buffer);
+  };
+  return !isKnownBuffer(lhs) || !isKnownBuffer(rhs);
+}
+
+// Matches a perfect nest of scf.for loops without iter_args whose innermost
+// body accumulates into a memref location that is invariant in the nest. All
+// other ops in the nest must be free of side effects, except for loads from
+// other memrefs.
+static std::optional<ReductionInfo> matchReduction(scf::ForOp outer) {
+  scf::ForOp loop = outer;
+  while (true) {
+    if (!loop.getInitArgs().empty())
+      return std::nullopt;
+    scf::ForOp inner;
+    for (Operation &op : loop.getBody()->without_terminator()) {
+      if (auto forOp = dyn_cast<scf::ForOp>(op)) {
+        if (inner)
+          return std::nullopt;
+        inner = forOp;
+      }
+    }
+    if (!inner)
+      break;
+    for (Operation &op : loop.getBody()->without_terminator()) {
+      if (&op != inner.getOperation() && !isMemoryEffectFree(&op))
+        return std::nullopt;
+    }
+    loop = inner;
+  }
+
+  // Innermost body: exactly one store whose value combines a load of the same
+  // location with a contribution.
+  memref::StoreOp store;
+  for (Operation &op : loop.getBody()->without_terminator()) {
+    if (auto storeOp = dyn_cast<memref::StoreOp>(op)) {
+      if (store)
+        return std::nullopt;
+      store = storeOp;
+    } else if (!isa<memref::LoadOp>(op) && !isMemoryEffectFree(&op)) {
+      return std::nullopt;
+    }
+  }
+  if (!store)
+    return std::nullopt;
+
+  Operation *combiner = store.getValue().getDefiningOp();
+  if (!combiner || combiner->getBlock() != loop.getBody() ||
+      combiner->getNumOperands() != 2 || combiner->getNumResults() != 1)
+    return std::nullopt;
+  auto kind = getAtomicKind(combiner);
+  if (!kind)
+    return std::nullopt;
+
+  memref::LoadOp load;
+  for (Value operand : combiner->getOperands()) {
+    auto loadOp = operand.getDefiningOp<memref::LoadOp>();
+    if (loadOp && loadOp.getMemRef() == store.getMemRef() &&
+        llvm::equal(loadOp.getIndices(), store.getIndices())) {
+      load = loadOp;
+      break;
+    }
+  }
+  if (!load || !load->hasOneUse() || load->getBlock() != loop.getBody() ||
+      combiner->getOperand(0) == combiner->getOperand(1))
+    return std::nullopt;
+
+  // The accumulator location must be the same for all iterations, and no
+  // other op may read the partially reduced value.
+  if (!outer.isDefinedOutsideOfLoop(store.getMemRef()))
+    return std::nullopt;
+  for (Value index : store.getIndices()) {
+    if (!outer.isDefinedOutsideOfLoop(index))
+      return std::nullopt;
+  }
+  bool hasOtherAccess = false;
+  outer.walk([&](memref::LoadOp loadOp) {
+    if (loadOp != load && mayAlias(loadOp.getMemRef(), store.getMemRef()))
+      hasOtherAccess = true;
+  });
+  if (hasOtherAccess)
+    return std::nullopt;
+
+  return ReductionInfo{load, combiner, store, *kind};
+}
+
+// Clones the body of `loop` at the builder's insertion point, threading the
+// partial result `acc` through the nested loops instead of going through
+// memory. Returns the updated partial result.
+static Value cloneReductionBody(OpBuilder &builder, scf::ForOp loop, Value acc,
+                                IRMapping &mapping, const ReductionInfo &info) {
+  for (Operation &op : loop.getBody()->without_terminator()) {
+    if (&op == info.load.getOperation()) {
+      mapping.map(info.load.getResult(), acc);
+    } else if (&op == info.store.getOperation()) {
+      continue;
+    } else if (&op == info.combiner) {
+      acc = builder.clone(op, mapping)->getResult(0);
+    } else if (auto inner = dyn_cast<scf::ForOp>(op)) {
+      auto newLoop = builder.create<scf::ForOp>(
+          inner.getLoc(), mapping.lookupOrDefault(inner.getLowerBound()),
+          mapping.lookupOrDefault(inner.getUpperBound()),
+          mapping.lookupOrDefault(inner.getStep()), ValueRange{acc},
+          [&](OpBuilder &b, Location loc, Value iv, ValueRange args) {
+            mapping.map(inner.getInductionVar(), iv);
+            Value res = cloneReductionBody(b, inner, args[0], mapping, info);
+            b.create<scf::YieldOp>(loc, res);
+          });
+      acc = newLoop.getResult(0);
+    } else {
+      builder.clone(op, mapping);
+    }
+  }
+  return acc;
+}
+
+struct ParallelizeReductionsPass
+    : public imex::impl::ParallelizeReductionsBase<ParallelizeReductionsPass> {
+  using ParallelizeReductionsBase::ParallelizeReductionsBase;
+
+  void runOnOperation() override {
+    auto func = getOperation();
+    if (parallelism < 1) {
+      func.emitError("parallelism must be positive");
+      return signalPassFailure();
+    }
+
+    // Only loops that are not already nested in a (parallel) loop or in a
+    // gpu.launch are considered.
+    SmallVector<std::pair<scf::ForOp, ReductionInfo>> candidates;
+    func.walk([&](scf::ForOp forOp) {
+      Operation *parent = forOp->getParentOp();
+      while (parent != func) {
+        if (isa<LoopLikeOpInterface, gpu::LaunchOp>(parent))
+          return;
+        parent = parent->getParentOp();
+      }
+      if (auto info = matchReduction(forOp))
+        candidates.emplace_back(forOp, *info);
+    });
+
+    for (auto &[forOp, info] : candidates)
+      parallelize(forOp, info);
+  }
+
+private:
+  void parallelize(scf::ForOp outer, const ReductionInfo &info) {
+    OpBuilder builder(outer);
+    Location loc = outer.getLoc();
+    Value lb = outer.getLowerBound();
+    Value ub = outer.getUpperBound();
+    Value step = outer.getStep();
+    Value c0 = builder.create<arith::ConstantIndexOp>(loc, 0);
+    Value c1 = builder.create<arith::ConstantIndexOp>(loc, 1);
+    Value maxChunks = builder.create<arith::ConstantIndexOp>(loc, parallelism);
+
+    // chunk = max(ceildiv(tripCount, parallelism), 1) iterations
+    Value span = builder.create<arith::MaxSIOp>(
+        loc, builder.create<arith::SubIOp>(loc, ub, lb), c0);
+    Value tripCount = builder.create<arith::CeilDivUIOp>(loc, span, step);
+    Value chunk = builder.create<arith::MaxUIOp>(
+        loc, builder.create<arith::CeilDivUIOp>(loc, tripCount, maxChunks),
+        c1);
+    Value numChunks = builder.create<arith::CeilDivUIOp>(loc, tripCount, chunk);
+    Value chunkSpan = builder.create<arith::MulIOp>(loc, chunk, step);
+
+    Type type = info.store.getValue().getType();
+    builder.create<scf::ParallelOp>(
+        loc, ValueRange{c0}, ValueRange{numChunks}, ValueRange{c1},
+        [&](OpBuilder &b, Location ploc, ValueRange ivs) {
+          Value begin = b.create<arith::AddIOp>(
+              ploc, lb, b.create<arith::MulIOp>(ploc, ivs[0], chunkSpan));
+          Value end = b.create<arith::MinSIOp>(
+              ploc, b.create<arith::AddIOp>(ploc, begin, chunkSpan), ub);
+          Value identity = arith::getIdentityValue(info.kind, type, b, ploc);
+          IRMapping mapping;
+          auto partial = b.create<scf::ForOp>(
+              ploc, begin, end, step, ValueRange{identity},
+              [&](OpBuilder &fb, Location floc, Value iv, ValueRange args) {
+                mapping.map(outer.getInductionVar(), iv);
+                Value res =
+                    cloneReductionBody(fb, outer, args[0], mapping, info);
+                fb.create<scf::YieldOp>(floc, res);
+              });
+          b.create<memref::AtomicRMWOp>(ploc, type, info.kind,
+                                        partial.getResult(0),
+                                        info.store.getMemRef(),
+                                        info.store.getIndices());
+        });
+    outer.erase();
+  }
+};
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createParallelizeReductionsPass() {
+  return std::make_unique<ParallelizeReductionsPass>();
+}
+} // namespace imex
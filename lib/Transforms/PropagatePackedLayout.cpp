@@ -19,8 +19,10 @@
 #include <mlir/Analysis/DataFlow/ConstantPropagationAnalysis.h>
 #include <mlir/Analysis/DataFlow/DeadCodeAnalysis.h>
 #include <mlir/Analysis/DataFlow/SparseAnalysis.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
 #include <mlir/Dialect/Vector/IR/VectorOps.h>
 #include <mlir/Dialect/XeGPU/IR/XeGPU.h>
+#include <mlir/Interfaces/LoopLikeInterface.h>
 
 namespace imex {
 #define GEN_PASS_DEF_PROPAGATEPACKEDLAYOUT
@@ -451,12 +453,27 @@ static void updateOpTypes(mlir::OpBuilder &builder, mlir::Operation &op,
   updateUnknownOp(builder, op, operands, results);
 }
 
-static void handleBranchOpInterface(mlir::OpBuilder &builder,
-                                    mlir::Block &block,
-                                    mlir::RegionBranchOpInterface branch,
-                                    mlir::TypeRange argsTypes) {
-  builder.setInsertionPointToStart(&block);
+// Converts `val` to `dstType` right before the builder insertion point.
+// Loads only used there are packed in place.
+static mlir::Value castToLayout(mlir::OpBuilder &builder, mlir::Value val,
+                                mlir::Type dstType) {
+  auto load = val.getDefiningOp<mlir::xegpu::LoadNdOp>();
+  auto srcType = mlir::dyn_cast<mlir::VectorType>(val.getType());
+  auto vecType = mlir::dyn_cast<mlir::VectorType>(dstType);
+  if (load && val.hasOneUse() && srcType && vecType &&
+      vecType.getRank() == srcType.getRank() + 1) {
+    updateLoadOp(builder, load, {}, llvm::ArrayRef<mlir::Type>(dstType));
+    return val;
+  }
+
+  return makeCast(builder, val, dstType).first;
+}
 
+static void
+handleBranchOpInterface(mlir::OpBuilder &builder, mlir::Block &block,
+                        mlir::RegionBranchOpInterface branch,
+                        mlir::TypeRange argsTypes,
+                        llvm::function_ref<mlir::Type(mlir::Value)> getLayout) {
   mlir::Operation *op = branch.getOperation();
   llvm::SmallVector<mlir::RegionSuccessor> successors;
   llvm::SmallVector<mlir::Attribute> operands(op->getNumOperands(), nullptr);
@@ -468,19 +485,18 @@ static void handleBranchOpInterface(mlir::OpBuilder &builder,
 
     mlir::OperandRange operands = branch.getEntrySuccessorOperands(successor);
     mlir::ValueRange inputs = successor.getSuccessorInputs();
-    for (auto [arg, input] : llvm::zip(operands, inputs)) {
+    for (auto [i, input] : llvm::enumerate(inputs)) {
       auto idx = mlir::cast<mlir::BlockArgument>(input).getArgNumber();
       mlir::Type dstType = argsTypes[idx];
-      if (dstType == arg.getType()) {
-        input.setType(dstType);
-        continue;
+      mlir::OpOperand &arg =
+          op->getOpOperand(operands.getBeginOperandIndex() + i);
+      // Values entering the region with another layout, e.g. the init value
+      // of a loop-carried vector, are converted once before the op.
+      if (dstType != arg.get().getType()) {
+        builder.setInsertionPoint(op);
+        arg.set(castToLayout(builder, arg.get(), dstType));
       }
-
-      auto &&[newArg, root] = makeCast(builder, arg, dstType);
-      if (newArg == arg)
-        continue;
-
-      arg.replaceAllUsesExcept(newArg, root);
+      input.setType(dstType);
     }
   }
 
@@ -492,6 +508,26 @@ static void handleBranchOpInterface(mlir::OpBuilder &builder,
   successors.clear();
   terminator.getSuccessorRegions(operandAttributes, successors);
 
+  // Values yielded back to the region must have the layout of the block
+  // arguments, so that loops carry the packed layout instead of repacking
+  // the carried value on every iteration.
+  bool isLoop = false;
+  for (const mlir::RegionSuccessor &successor : successors) {
+    if (successor.isParent() || successor.getSuccessor() != block.getParent())
+      continue;
+
+    isLoop = true;
+    mlir::ValueRange inputs = successor.getSuccessorInputs();
+    mlir::MutableOperandRange operands =
+        terminator.getMutableSuccessorOperands(successor);
+    builder.setInsertionPoint(terminator);
+    for (auto [i, input] : llvm::enumerate(inputs)) {
+      mlir::OpOperand &operand = operands[i];
+      if (operand.get().getType() != input.getType())
+        operand.set(castToLayout(builder, operand.get(), input.getType()));
+    }
+  }
+
   for (const mlir::RegionSuccessor &successor : successors) {
     if (!successor.isParent())
       continue;
@@ -499,16 +535,27 @@ static void handleBranchOpInterface(mlir::OpBuilder &builder,
     mlir::ValueRange inputs = successor.getSuccessorInputs();
     mlir::OperandRange operands = terminator.getSuccessorOperands(successor);
     for (auto [operand, input] : llvm::zip(operands, inputs)) {
+      mlir::Type expected = getLayout(input);
       input.setType(operand.getType());
+      if (!isLoop || expected == operand.getType() || input.use_empty())
+        continue;
+
+      // The loop carries another layout than its users expect, convert the
+      // result once after the loop.
+      builder.setInsertionPointAfter(op);
+      auto &&[newRes, root] = makeCast(builder, input, expected);
+      input.replaceAllUsesExcept(newRes, root);
     }
   }
 }
 
-static void updateBlockTypes(mlir::OpBuilder &builder, mlir::Block &block,
-                             mlir::TypeRange args) {
+static void
+updateBlockTypes(mlir::OpBuilder &builder, mlir::Block &block,
+                 mlir::TypeRange args,
+                 llvm::function_ref<mlir::Type(mlir::Value)> getLayout) {
   if (auto iface = mlir::dyn_cast_if_present<mlir::RegionBranchOpInterface>(
           block.getParentOp()))
-    return handleBranchOpInterface(builder, block, iface, args);
+    return handleBranchOpInterface(builder, block, iface, args, getLayout);
 
   builder.setInsertionPointToStart(&block);
   for (auto &&[arg, dstType] : llvm::zip_equal(block.getArguments(), args)) {
@@ -520,6 +567,53 @@ static void updateBlockTypes(mlir::OpBuilder &builder, mlir::Block &block,
   }
 }
 
+// Returns the `shape_cast -> shuffle -> shape_cast` chain created by
+// `makeCast` starting at `root`, or an empty chain.
+static llvm::SmallVector<mlir::Operation *, 3>
+matchLayoutCast(mlir::Operation *root) {
+  auto src = mlir::dyn_cast<mlir::vector::ShapeCastOp>(root);
+  if (!src || src->use_empty())
+    return {};
+
+  auto shuffle = mlir::dyn_cast<mlir::vector::ShuffleOp>(*src->user_begin());
+  if (!shuffle || shuffle.getV1() != src.getResult() ||
+      shuffle.getV2() != src.getResult() || !shuffle->hasOneUse() ||
+      !llvm::all_of(src->getUsers(),
+                    [&](mlir::Operation *user) { return user == shuffle; }))
+    return {};
+
+  auto dst = mlir::dyn_cast<mlir::vector::ShapeCastOp>(*shuffle->user_begin());
+  if (!dst)
+    return {};
+
+  return {src, shuffle, dst};
+}
+
+// Layout casts are created right before each op needing them, so a value
+// defined outside of a loop is repacked on every iteration. Hoist the casts
+// out of the loops when their source is loop invariant. Identical casts of
+// the same value are left to CSE.
+static void hoistLayoutCasts(mlir::Operation *root) {
+  llvm::SmallVector<llvm::SmallVector<mlir::Operation *, 3>> chains;
+  root->walk([&](mlir::vector::ShapeCastOp op) {
+    auto chain = matchLayoutCast(op);
+    if (!chain.empty())
+      chains.emplace_back(std::move(chain));
+  });
+
+  for (auto &chain : chains) {
+    mlir::Value src = chain.front()->getOperand(0);
+    while (auto loop =
+               chain.front()->getParentOfType<mlir::LoopLikeOpInterface>()) {
+      if (!loop.isDefinedOutsideOfLoop(src))
+        break;
+
+      for (auto *op : chain)
+        loop.moveOutOfLoop(op);
+    }
+  }
+}
+
 namespace imex {
 
 struct PropagatePackedLayoutPass final
@@ -558,8 +652,10 @@ struct PropagatePackedLayoutPass final
       operands.clear();
       for (auto arg : block->getArguments())
         operands.emplace_back(getLayout(arg));
-      updateBlockTypes(builder, *block, operands);
+      updateBlockTypes(builder, *block, operands, getLayout);
     });
+
+    hoistLayoutCasts(op);
   }
 };
 } // namespace imex
@@ -10,12 +10,23 @@
 /// \file
 /// This file implements the RemoveTemporaries transform.
 ///
+/// A temporary buffer that is only copied into its final destination is
+/// replaced by the destination. Besides allocations in the block of the copy,
+/// this covers buffers yielded by both branches of an scf.if, and copies at
+/// the end of an scf.for body that hand a buffer over to the next iteration,
+/// which are replaced by swapping the two buffers through iter_args.
+/// Host buffers are never forwarded into device buffers (gpu.alloc) and vice
+/// versa.
+///
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Pass/Pass.h"
 #include <imex/Utils/PassUtils.h>
 #include <mlir/Analysis/AliasAnalysis.h>
 #include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/Linalg/IR/Linalg.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
 
 namespace imex {
 #define GEN_PASS_DEF_REMOVETEMPORARIES
@@ -43,8 +54,12 @@ using namespace imex;
 namespace {
 
 /// Returns allocation operation or nullptr
+/// Async allocations also return a token and are not considered.
 ::mlir::Operation *findAllocOp(::mlir::Value value) {
   if (::mlir::Operation *op = value.getDefiningOp()) {
+    if (op->getNumResults() != 1) {
+      return nullptr;
+    }
     if (auto effects = ::mlir::dyn_cast<::mlir::MemoryEffectOpInterface>(op)) {
       if (effects.hasEffect<::mlir::MemoryEffects::Allocate>()) {
         return op;
@@ -115,6 +130,63 @@ findSubviewRootValue(::mlir::Value val,
   return val;
 }
 
+/// Returns true if `val` is (a view of) memory allocated with gpu.alloc
+static bool isDeviceMemory(::mlir::Value val) {
+  ::mlir::SmallVector<::mlir::Operation *> subviewOps;
+  auto root = findSubviewRootValue(val, subviewOps);
+  return root.getDefiningOp<::mlir::gpu::AllocOp>() != nullptr;
+}
+
+/// Returns true if `val` is used by `op` or by an op nested in `op`
+static bool isUsedIn(::mlir::Value val, ::mlir::Operation *op) {
+  return llvm::any_of(val.getUsers(), [&](::mlir::Operation *user) {
+    return op->isAncestor(user);
+  });
+}
+
+/// Returns true if `op` overwrites all elements of `buffer` without reading
+/// it: a memref.copy into `buffer`, or a linalg op with only parallel loops
+/// writing `buffer` through a permutation without using its previous value.
+static bool isFullOverwrite(::mlir::Operation *op, ::mlir::Value buffer) {
+  if (auto copy = ::mlir::dyn_cast<::mlir::memref::CopyOp>(op)) {
+    return copy.getTarget() == buffer && copy.getSource() != buffer;
+  }
+  auto linalgOp = ::mlir::dyn_cast<::mlir::linalg::LinalgOp>(op);
+  if (!linalgOp || !linalgOp.hasPureBufferSemantics() ||
+      linalgOp.getNumLoops() != linalgOp.getNumParallelLoops()) {
+    return false;
+  }
+  bool written = false;
+  for (auto &operand : op->getOpOperands()) {
+    if (operand.get() != buffer) {
+      continue;
+    }
+    if (!linalgOp.isDpsInit(&operand) ||
+        linalgOp.payloadUsesValueForOperand(&operand) ||
+        !linalgOp.getMatchingIndexingMap(&operand).isPermutation()) {
+      return false;
+    }
+    written = true;
+  }
+  return written;
+}
+
+/// Returns true if `op` or an op nested in `op` has an operand that must or
+/// partially alias `val`
+static bool accessesAlias(::mlir::Operation *op, ::mlir::Value val,
+                          ::mlir::AliasAnalysis &mAlias) {
+  auto res = op->walk([&](::mlir::Operation *nested) {
+    for (auto operand : nested->getOperands()) {
+      auto aliasRes = mAlias.alias(operand, val);
+      if (aliasRes.isMust() || aliasRes.isPartial()) {
+        return ::mlir::WalkResult::interrupt();
+      }
+    }
+    return ::mlir::WalkResult::advance();
+  });
+  return res.wasInterrupted();
+}
+
 /// Check whether `op` can have a write effect on value `val`
 static bool opHasWriteEffect(::mlir::Value val, ::mlir::Operation *op) {
   // Check whether the operation `op` has write effect on the memory.
@@ -305,15 +377,13 @@ bool opHasRAWConflict(mlir::Operation *op, mlir::Value writeVal,
   return false;
 }
 
-/// Checks whether replacing `scrAllocOp` with `dstDefOp` would result in a
+/// Checks whether replacing `scrAllocOp` with `newVal` would result in a
 /// read/write conflict in some operation that writes into `scrAllocOp` value.
 /// @return true if no conflict is found
 bool checkReadWriteConflict(mlir::Operation *op, mlir::Operation *srcAllocOp,
-                            mlir::Operation *dstDefOp,
-                            mlir::AliasAnalysis &mAlias) {
+                            mlir::Value newVal, mlir::AliasAnalysis &mAlias) {
   // find all ops that write to srcAlloc, traverse through all blocks
   auto srcVal = srcAllocOp->getResult(0);
-  auto newVal = dstDefOp->getResult(0);
   ::mlir::SmallVector<::mlir::Operation *> srcAllocWriteOps;
   if (!collectWriteEffectOps(srcAllocOp, nullptr, srcAllocWriteOps, srcVal)) {
     return false;
@@ -464,9 +534,13 @@ struct RemoveTemporaries
     : public imex::impl::RemoveTemporariesBase<RemoveTemporaries> {
   void runOnOperation() override {
     ::mlir::SmallVector<mlir::Operation *> opsToRemove;
-    getOperation()->walk([&](::mlir::CopyOpInterface copyOp) {
+    // Collect copies first, transforming loops replaces them.
+    ::mlir::SmallVector<::mlir::CopyOpInterface> copyOps;
+    getOperation()->walk(
+        [&](::mlir::CopyOpInterface copyOp) { copyOps.push_back(copyOp); });
+    for (auto copyOp : copyOps) {
       transform(copyOp, opsToRemove);
-    });
+    }
     for (::mlir::Operation *op : opsToRemove) {
       if (!op->use_empty()) {
         DEBUG_OP("RemoveTemporaries", "cannot remove op", op)
@@ -494,6 +568,10 @@ private:
     auto dstDeallocOp = findDeallocOp(dst);
     auto dstDefOp = dst.getDefiningOp();
     if (!srcAllocOp) {
+      // src may be allocated in both branches of an scf.if
+      if (auto ifOp = src.getDefiningOp<::mlir::scf::IfOp>()) {
+        transformIfResult(opi, ifOp, opsToRemove);
+      }
       // src is not associated with a temp array allocation
       return;
     }
@@ -506,10 +584,20 @@ private:
     bool srcIsReturned = findReturn(srcAllocOp->getResult(0));
 
     if (copyOpParentReg != allocOpParentReg) {
+      if (auto forOp =
+              ::mlir::dyn_cast<::mlir::scf::ForOp>(op->getParentOp())) {
+        swapLoopCarriedBuffers(opi, forOp, srcAllocOp, opsToRemove);
+        return;
+      }
       DEBUG_MSG("RemoveTemporaries",
                 "alloc and copy are in different regions, skipping")
       return;
     }
+    if (isDeviceMemory(src) != isDeviceMemory(dst)) {
+      DEBUG_MSG("RemoveTemporaries",
+                "src and dst are in different memory spaces, skipping")
+      return;
+    }
     if (dstDefOp) {
       // There is a dst defining op
       DEBUG_OP("RemoveTemporaries", "  defining op", dstDefOp)
@@ -526,7 +614,8 @@ private:
       }
       auto &memrefAlias = getAnalysis<mlir::AliasAnalysis>();
       memrefAlias.alias(src, dst);
-      if (!checkReadWriteConflict(op, srcAllocOp, dstDefOp, memrefAlias)) {
+      if (!checkReadWriteConflict(op, srcAllocOp, dstDefOp->getResult(0),
+                                  memrefAlias)) {
         DEBUG_MSG("RemoveTemporaries",
                   "found read after write conflict, skipping")
         return;
@@ -568,6 +657,173 @@ private:
     DEBUG_OP("RemoveTemporaries", "  removing src alloc op", srcAllocOp)
     opsToRemove.push_back(srcAllocOp);
   }
+
+  /// Forwards the copy destination into the allocations yielded by both
+  /// branches of an scf.if whose result is only copied:
+  ///   %r = scf.if %c {%a = alloc ... yield %a} else {%b = alloc ... yield %b}
+  ///   memref.copy %r, %dst
+  void transformIfResult(::mlir::CopyOpInterface opi, ::mlir::scf::IfOp ifOp,
+                         ::mlir::SmallVector<mlir::Operation *> &opsToRemove) {
+    auto op = opi.getOperation();
+    auto dst = opi.getTarget();
+    auto src = opi.getSource();
+    DEBUG_OP("RemoveTemporaries", "inspecting scf.if result copy", op)
+    if (ifOp.getElseRegion().empty() || src.getType() != dst.getType() ||
+        op->getBlock() != ifOp->getBlock()) {
+      return;
+    }
+    // The result may only be copied and deallocated.
+    auto srcDeallocOp = findDeallocOp(src);
+    for (auto user : src.getUsers()) {
+      if (user != op && user != srcDeallocOp) {
+        return;
+      }
+    }
+    auto &dom = getAnalysis<::mlir::DominanceInfo>();
+    if (!dom.properlyDominates(dst, ifOp)) {
+      DEBUG_MSG("RemoveTemporaries", "  dst does not dominate scf.if")
+      return;
+    }
+
+    auto resultIdx = ::mlir::cast<::mlir::OpResult>(src).getResultNumber();
+    ::mlir::SmallVector<::mlir::Operation *> allocOps;
+    for (auto region : {&ifOp.getThenRegion(), &ifOp.getElseRegion()}) {
+      auto yielded = region->front().getTerminator()->getOperand(resultIdx);
+      auto allocOp = findAllocOp(yielded);
+      if (!allocOp || allocOp->getParentRegion() != region ||
+          findDeallocOp(yielded) ||
+          isDeviceMemory(yielded) != isDeviceMemory(dst)) {
+        return;
+      }
+      allocOps.push_back(allocOp);
+    }
+
+    // dst is written earlier after forwarding. Nothing in the branches or
+    // between the scf.if and the copy may access it.
+    auto &memrefAlias = getAnalysis<mlir::AliasAnalysis>();
+    for (auto it = ifOp->getIterator(); &*it != op; ++it) {
+      if (accessesAlias(&*it, dst, memrefAlias)) {
+        DEBUG_OP("RemoveTemporaries", "  dst is accessed in", (&*it))
+        return;
+      }
+    }
+
+    mlir::IRRewriter rewriter(op->getContext());
+    for (auto allocOp : allocOps) {
+      DEBUG_OP("RemoveTemporaries", "  replacing branch alloc", allocOp)
+      replaceUsesAndPropagateType(rewriter, allocOp, dst);
+      opsToRemove.push_back(allocOp);
+    }
+    opsToRemove.push_back(op);
+    if (srcDeallocOp) {
+      opsToRemove.push_back(srcDeallocOp);
+    }
+  }
+
+  /// Replaces a copy at the end of a loop body, which hands the buffer
+  /// computed in one iteration over to the next one, by swapping the two
+  /// buffers through iter_args:
+  ///   %tmp = alloc
+  ///   scf.for ... { compute(%buf -> %tmp); memref.copy %tmp, %buf }
+  /// becomes
+  ///   %r:2 = scf.for ... iter_args(%in = %buf, %out = %tmp) {
+  ///     compute(%in -> %out); scf.yield %out, %in }
+  ///   memref.copy %r#0, %buf (only if %r#0 is not %buf)
+  void
+  swapLoopCarriedBuffers(::mlir::CopyOpInterface opi, ::mlir::scf::ForOp forOp,
+                         ::mlir::Operation *srcAllocOp,
+                         ::mlir::SmallVector<mlir::Operation *> &opsToRemove) {
+    auto op = opi.getOperation();
+    auto dst = opi.getTarget();
+    auto src = opi.getSource();
+    DEBUG_OP("RemoveTemporaries", "inspecting loop-carried copy", op)
+    if (!::mlir::isa<::mlir::memref::CopyOp>(op) || src == dst ||
+        src.getType() != dst.getType() || !forOp.isDefinedOutsideOfLoop(dst) ||
+        srcAllocOp->getBlock() != forOp->getBlock() ||
+        isDeviceMemory(src) != isDeviceMemory(dst)) {
+      return;
+    }
+    // Views would keep referring to the original buffers.
+    for (auto val : {src, dst}) {
+      for (auto user : val.getUsers()) {
+        if (::mlir::isa<::mlir::ViewLikeOpInterface>(user)) {
+          return;
+        }
+      }
+    }
+    // src must be uninitialized when entering the loop and only be
+    // deallocated after it, its content outside of the loop is irrelevant.
+    for (auto user : src.getUsers()) {
+      if (forOp->isAncestor(user)) {
+        continue;
+      }
+      auto effects = ::mlir::dyn_cast<::mlir::MemoryEffectOpInterface>(user);
+      if (!effects || !effects.hasEffect<::mlir::MemoryEffects::Free>() ||
+          user->getBlock() != forOp->getBlock() ||
+          user->isBeforeInBlock(forOp)) {
+        return;
+      }
+    }
+    // Each iteration must overwrite src before reading it: after the swap,
+    // src holds the result of the iteration before the previous one instead
+    // of the previous one.
+    for (auto &bodyOp : forOp.getBody()->without_terminator()) {
+      if (&bodyOp == op) {
+        return;
+      }
+      if (!isUsedIn(src, &bodyOp)) {
+        continue;
+      }
+      if (!isFullOverwrite(&bodyOp, src)) {
+        DEBUG_OP("RemoveTemporaries",
+                 "  temporary may be read before it is overwritten", (&bodyOp))
+        return;
+      }
+      break;
+    }
+    // The copy must be the last access to both buffers in an iteration.
+    for (auto it = ++op->getIterator(), end = forOp.getBody()->end();
+         it != end; ++it) {
+      if (isUsedIn(src, &*it) || isUsedIn(dst, &*it)) {
+        return;
+      }
+    }
+
+    DEBUG_OP("RemoveTemporaries", "  swapping buffers in loop", forOp)
+    mlir::IRRewriter rewriter(op->getContext());
+    rewriter.setInsertionPoint(forOp);
+    auto newLoop = forOp.replaceWithAdditionalYields(
+        rewriter, ::mlir::ValueRange{dst, src},
+        /*replaceInitOperandUsesInLoop=*/true,
+        [](::mlir::OpBuilder &, ::mlir::Location,
+           ::llvm::ArrayRef<::mlir::BlockArgument> newBbArgs) {
+          return ::mlir::SmallVector<::mlir::Value>{newBbArgs[1],
+                                                    newBbArgs[0]};
+        });
+    if (::mlir::failed(newLoop)) {
+      return;
+    }
+    opsToRemove.push_back(op);
+
+    // After an odd number of iterations the result is in the other buffer.
+    auto loop = *newLoop;
+    auto loc = op->getLoc();
+    auto result = loop->getResult(loop->getNumResults() - 2);
+    rewriter.setInsertionPointAfter(loop);
+    auto resultPtr =
+        rewriter.create<::mlir::memref::ExtractAlignedPointerAsIndexOp>(
+            loc, result);
+    auto dstPtr =
+        rewriter.create<::mlir::memref::ExtractAlignedPointerAsIndexOp>(loc,
+                                                                        dst);
+    auto differs = rewriter.create<::mlir::arith::CmpIOp>(
+        loc, ::mlir::arith::CmpIPredicate::ne, resultPtr, dstPtr);
+    rewriter.create<::mlir::scf::IfOp>(
+        loc, differs, [&](::mlir::OpBuilder &b, ::mlir::Location l) {
+          b.create<::mlir::memref::CopyOp>(l, result, dst);
+          b.create<::mlir::scf::YieldOp>(l);
+        });
+  }
 };
 
 } // end anonymous namespace
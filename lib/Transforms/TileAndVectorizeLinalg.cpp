@@ -0,0 +1,242 @@
+//===- TileAndVectorizeLinalg.cpp - vectorize linalg for CPUs ---*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This pass tiles linalg ops on buffers for the CPU and vectorizes the tiles
+/// to the SIMD width of the host. The parallel dimensions are first tiled
+/// into cache sized blocks. The blocks are then tiled into vectors: the
+/// innermost loop dimension by the number of SIMD lanes, and for transposes,
+/// i.e. ops reading or writing an operand whose contiguous dimension is not
+/// the innermost loop dimension, that dimension too, so both sides are
+/// accessed with full vectors. Remainder tiles are vectorized with masks.
+///
+//===----------------------------------------------------------------------===//
+
+#include "imex/Transforms/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/Linalg/IR/Linalg.h"
+#include "mlir/Dialect/Linalg/Transforms/Transforms.h"
+#include "mlir/Dialect/Linalg/Utils/Utils.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/Dialect/Vector/Transforms/LoweringPatterns.h"
+#include "mlir/Dialect/Vector/Transforms/VectorRewritePatterns.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/TargetParser/Host.h"
+
+#include <optional>
+
+namespace imex {
+#define GEN_PASS_DEF_TILEANDVECTORIZELINALG
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+using namespace mlir;
+using namespace imex;
+
+namespace {
+
+// Returns the width in bits of the widest SIMD registers of the host.
+static int64_t getHostSimdWidth() {
+  llvm::StringMap<bool> features;
+  if (!llvm::sys::getHostCPUFeatures(features))
+    return 128;
+  if (features.lookup("avx512f"))
+    return 512;
+  if (features.lookup("avx2") || features.lookup("avx"))
+    return 256;
+  return 128;
+}
+
+// Returns the loop dimension that is contiguous in memory for `operand`, i.e.
+// the dimension indexing its last memref dimension, if any.
+static std::optional<unsigned> getContiguousDim(linalg::LinalgOp op,
+                                                OpOperand &operand) {
+  AffineMap map = op.getMatchingIndexingMap(&operand);
+  if (map.getNumResults() == 0)
+    return std::nullopt;
+  auto dim = dyn_cast<AffineDimExpr>(map.getResults().back());
+  if (!dim)
+    return std::nullopt;
+  return dim.getPosition();
+}
+
+struct TileAndVectorizeLinalgPass
+    : public imex::impl::TileAndVectorizeLinalgBase<
+          TileAndVectorizeLinalgPass> {
+  using TileAndVectorizeLinalgBase::TileAndVectorizeLinalgBase;
+
+  void runOnOperation() override {
+    auto func = getOperation();
+    if (simdWidth < 0 || cacheSize < 0) {
+      func.emitError("simd-width and cache-size must not be negative");
+      return signalPassFailure();
+    }
+    int64_t simdBits = simdWidth ? simdWidth : getHostSimdWidth();
+
+    SmallVector<linalg::LinalgOp> candidates;
+    func.walk([&](linalg::LinalgOp op) {
+      if (op.hasPureBufferSemantics() && op.getNumLoops() > 0 &&
+          !op->getParentOfType<linalg::LinalgOp>())
+        candidates.push_back(op);
+    });
+
+    IRRewriter rewriter(&getContext());
+    for (auto op : candidates)
+      tileAndVectorize(rewriter, op, simdBits);
+
+    // Lower the vector ops the vectorizer produces to the 1-D ops handled by
+    // convert-vector-to-llvm. Transposed transfers become vector.transpose
+    // ops, which are lowered to shuffles, masked transfers take the mask as
+    // an operand.
+    RewritePatternSet patterns(&getContext());
+    vector::populateVectorMaskLoweringPatternsForSideEffectingOps(patterns);
+    vector::populateVectorTransferPermutationMapLoweringPatterns(patterns);
+    vector::populateVectorMultiReductionLoweringPatterns(
+        patterns, vector::VectorMultiReductionLowering::InnerReduction);
+    vector::populateCastAwayVectorLeadingOneDimPatterns(patterns);
+    vector::populateVectorTransposeLoweringPatterns(
+        patterns, vector::VectorTransformsOptions().setVectorTransposeLowering(
+                      vector::VectorTransposeLowering::Shuffle1D));
+    if (failed(applyPatternsAndFoldGreedily(func, std::move(patterns))))
+      return signalPassFailure();
+  }
+
+private:
+  void tileAndVectorize(RewriterBase &rewriter, linalg::LinalgOp op,
+                        int64_t simdBits) {
+    SmallVector<int64_t> ranges = op.getStaticLoopRanges();
+    if (llvm::any_of(ranges, ShapedType::isDynamic))
+      return;
+
+    // The lanes are sized for the widest element type of the op.
+    int64_t elementBits = 8;
+    for (Value operand : op->getOperands()) {
+      Type type = getElementTypeOrSelf(operand.getType());
+      if (type.isIntOrFloat())
+        elementBits =
+            std::max<int64_t>(elementBits, type.getIntOrFloatBitWidth());
+    }
+    int64_t lanes = std::max<int64_t>(simdBits / elementBits, 1);
+
+    unsigned numLoops = op.getNumLoops();
+    unsigned innerDim = numLoops - 1;
+    std::optional<unsigned> transposedDim;
+    for (OpOperand &operand : op->getOpOperands()) {
+      auto dim = getContiguousDim(op, operand);
+      if (dim && *dim != innerDim && ranges[*dim] > 1)
+        transposedDim = *dim;
+    }
+
+    // The vector sizes bound the loop ranges of the innermost tiles, the
+    // tiles at the end of a dimension not divided by them are masked.
+    SmallVector<int64_t> vectorSizes(numLoops, 1);
+    vectorSizes[innerDim] = lanes;
+    if (transposedDim)
+      vectorSizes[*transposedDim] = lanes;
+    for (unsigned dim = 0; dim < numLoops; ++dim)
+      vectorSizes[dim] = std::min(vectorSizes[dim], ranges[dim]);
+
+    // Grow the blocks over the parallel dimensions, starting with the
+    // contiguous ones, while the blocks of all operands fit into the cache.
+    // Reduction dimensions are not blocked.
+    SmallVector<unsigned> blockDims;
+    SmallVector<utils::IteratorType> iterators = op.getIteratorTypesArray();
+    auto addBlockDim = [&](unsigned dim) {
+      if (linalg::isParallelIterator(iterators[dim]) &&
+          !llvm::is_contained(blockDims, dim))
+        blockDims.push_back(dim);
+    };
+    addBlockDim(innerDim);
+    if (transposedDim)
+      addBlockDim(*transposedDim);
+    for (unsigned dim = numLoops; dim-- > 0;)
+      addBlockDim(dim);
+
+    SmallVector<int64_t> cacheTiles = vectorSizes;
+    for (unsigned dim = 0; dim < numLoops; ++dim) {
+      if (!linalg::isParallelIterator(iterators[dim]))
+        cacheTiles[dim] = ranges[dim];
+    }
+    int64_t elementBytes = elementBits / 8;
+    auto fitsCache = [&](ArrayRef<int64_t> tiles) {
+      int64_t bytes = 0;
+      for (OpOperand &operand : op->getOpOperands()) {
+        AffineMap map = op.getMatchingIndexingMap(&operand);
+        int64_t elements = 1;
+        for (AffineExpr expr : map.getResults()) {
+          if (auto dim = dyn_cast<AffineDimExpr>(expr))
+            elements *= tiles[dim.getPosition()];
+        }
+        bytes += elements * elementBytes;
+      }
+      return bytes <= cacheSize;
+    };
+    bool grown = true;
+    while (grown) {
+      grown = false;
+      for (unsigned dim : blockDims) {
+        SmallVector<int64_t> tiles = cacheTiles;
+        tiles[dim] = std::min(tiles[dim] * 2, ranges[dim]);
+        if (tiles[dim] != cacheTiles[dim] && fitsCache(tiles)) {
+          cacheTiles = tiles;
+          grown = true;
+        }
+      }
+    }
+
+    // A dimension tiled by its whole range is not tiled.
+    auto getTileSizes = [&](ArrayRef<int64_t> tiles) {
+      SmallVector<int64_t> sizes;
+      for (auto [tile, range] : llvm::zip_equal(tiles, ranges))
+        sizes.push_back(tile < range ? tile : 0);
+      return sizes;
+    };
+
+    auto loopType = parallelLoops ? linalg::LinalgTilingLoopType::ParallelLoops
+                                  : linalg::LinalgTilingLoopType::Loops;
+    // Replaces `op` by its tile, returns false if tiling failed.
+    auto tile = [&](ArrayRef<int64_t> tiles) {
+      SmallVector<int64_t> sizes = getTileSizes(tiles);
+      if (llvm::all_of(sizes, [](int64_t size) { return size == 0; }))
+        return true;
+      auto tiled = linalg::tileLinalgOp(
+          rewriter, op,
+          linalg::LinalgTilingOptions().setTileSizes(sizes).setLoopType(
+              loopType));
+      if (failed(tiled))
+        return false;
+      rewriter.eraseOp(op);
+      op = tiled->op;
+      // Only the outermost loops are distributed.
+      loopType = linalg::LinalgTilingLoopType::Loops;
+      return true;
+    };
+    if (!tile(cacheTiles) || !tile(vectorSizes))
+      return;
+
+    // Tiles that cannot be vectorized are left to convert-linalg-to-loops.
+    rewriter.setInsertionPoint(op);
+    (void)linalg::vectorize(rewriter, op, vectorSizes);
+  }
+};
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createTileAndVectorizeLinalgPass() {
+  return std::make_unique<TileAndVectorizeLinalgPass>();
+}
+} // namespace imex
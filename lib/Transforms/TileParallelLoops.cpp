@@ -0,0 +1,257 @@
+//===- TileParallelLoops.cpp - map scf.parallel to workgroups ---*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This pass tiles top-level scf.parallel loops into a workgroup loop and a
+/// work-item loop and attaches the gpu mapping attributes consumed by
+/// convert-parallel-loops-to-gpu. The workgroup size is derived from the
+/// device description (SIMD width and threads per EU), the innermost loop
+/// dimension is mapped to the x dimension so that neighbouring work-items
+/// access neighbouring elements. Loops with a tiny body and an iteration
+/// space much larger than the device are coarsened: every work-item handles
+/// several elements, strided by the workgroup width.
+///
+//===----------------------------------------------------------------------===//
+
+#include "imex/Transforms/Passes.h"
+#include "imex/Utils/XeArch.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/GPU/IR/GPUDialect.h"
+#include "mlir/Dialect/GPU/Transforms/ParallelLoopMapper.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/Pass/Pass.h"
+
+#include <memory>
+#include <optional>
+
+namespace imex {
+#define GEN_PASS_DEF_TILEPARALLELLOOPS
+#include "imex/Transforms/Passes.h.inc"
+} // namespace imex
+
+using namespace mlir;
+using namespace imex;
+
+namespace {
+
+// Returns the static trip count of dimension `dim`, if known.
+static std::optional<int64_t> getTripCount(scf::ParallelOp op, unsigned dim) {
+  auto lb = getConstantIntValue(op.getLowerBound()[dim]);
+  auto ub = getConstantIntValue(op.getUpperBound()[dim]);
+  auto step = getConstantIntValue(op.getStep()[dim]);
+  if (!lb || !ub || !step || *step <= 0)
+    return std::nullopt;
+  if (*ub <= *lb)
+    return 0;
+  return llvm::divideCeil(*ub - *lb, *step);
+}
+
+// The innermost loop dimension is mapped to x, the next one to y and z.
+// Remaining dimensions are iterated sequentially.
+static gpu::Processor getProcessor(unsigned dim, unsigned numDims,
+                                   bool isThread) {
+  unsigned hwDim = numDims - 1 - dim;
+  if (hwDim >= 3)
+    return gpu::Processor::Sequential;
+  static const gpu::Processor blocks[] = {
+      gpu::Processor::BlockX, gpu::Processor::BlockY, gpu::Processor::BlockZ};
+  static const gpu::Processor threads[] = {gpu::Processor::ThreadX,
+                                           gpu::Processor::ThreadY,
+                                           gpu::Processor::ThreadZ};
+  return isThread ? threads[hwDim] : blocks[hwDim];
+}
+
+static void setMapping(scf::ParallelOp op, bool isThread) {
+  OpBuilder b(op);
+  unsigned numDims = op.getNumLoops();
+  SmallVector<gpu::ParallelLoopDimMappingAttr> attrs;
+  for (unsigned i = 0; i < numDims; ++i)
+    attrs.push_back(b.getAttr<gpu::ParallelLoopDimMappingAttr>(
+        getProcessor(i, numDims, isThread), b.getDimIdentityMap(),
+        b.getDimIdentityMap()));
+  (void)gpu::setMappingAttr(op, attrs);
+}
+
+struct TileParallelLoopsPass
+    : public imex::impl::TileParallelLoopsBase<TileParallelLoopsPass> {
+  using TileParallelLoopsBase::TileParallelLoopsBase;
+
+  void runOnOperation() override {
+    auto func = getOperation();
+    std::shared_ptr<XeuArchInterface> uArch;
+    if (device == "pvc")
+      uArch = std::make_shared<XePVCuArch>();
+    if (!uArch) {
+      func.emitError("Can not get GPU Arch Definition for given Arch param");
+      return signalPassFailure();
+    }
+    if (workgroupSize < 0 || maxCoarsening < 1) {
+      func.emitError("invalid workgroup size or coarsening factor");
+      return signalPassFailure();
+    }
+
+    // One workgroup fills all hardware threads of an EU unless given.
+    simdWidth = uArch->getSIMDWidth();
+    wgSize = workgroupSize ? workgroupSize
+                           : int64_t(simdWidth) * uArch->getThreadsPerEU();
+    deviceLanes = int64_t(uArch->getNumEUs()) * uArch->getThreadsPerEU() *
+                  simdWidth;
+
+    SmallVector<scf::ParallelOp> candidates;
+    func.walk([&](scf::ParallelOp op) {
+      if (op->getParentOfType<scf::ParallelOp>() ||
+          op->getParentOfType<gpu::LaunchOp>() ||
+          op->hasAttr(gpu::getMappingAttrName()) || !op.getInitVals().empty())
+        return;
+      // Nested parallel loops are left to gpu-map-parallel-loops.
+      bool hasNested = false;
+      op.getBody()->walk([&](scf::ParallelOp) { hasNested = true; });
+      if (!hasNested)
+        candidates.push_back(op);
+    });
+
+    for (scf::ParallelOp op : candidates)
+      tile(op);
+  }
+
+private:
+  int64_t simdWidth = 0;
+  int64_t wgSize = 0;
+  int64_t deviceLanes = 0;
+
+  void tile(scf::ParallelOp op) {
+    unsigned numDims = op.getNumLoops();
+    SmallVector<std::optional<int64_t>> tripCounts;
+    for (unsigned i = 0; i < numDims; ++i)
+      tripCounts.push_back(getTripCount(op, i));
+
+    // Distribute the workgroup size over the dimensions, innermost first.
+    SmallVector<int64_t> tileSizes(numDims, 1);
+    int64_t budget = wgSize;
+    for (int i = numDims - 1; i >= 0 && budget > 1; --i) {
+      int64_t size = budget;
+      if (tripCounts[i])
+        size = std::max<int64_t>(std::min(size, *tripCounts[i]), 1);
+      tileSizes[i] = size;
+      budget /= size;
+    }
+    if (llvm::all_of(tileSizes, [](int64_t s) { return s == 1; }))
+      return;
+
+    // Coarsen the innermost dimension if the body is tiny and there are more
+    // iterations than the device has lanes.
+    int64_t coarsening = 1;
+    unsigned numBodyOps = 0;
+    for (Operation &bodyOp : op.getBody()->without_terminator())
+      bodyOp.walk([&](Operation *) { ++numBodyOps; });
+    std::optional<int64_t> totalIters = 1;
+    for (auto count : tripCounts) {
+      if (!totalIters || !count)
+        totalIters = std::nullopt;
+      else
+        totalIters = *totalIters * *count;
+    }
+    if (totalIters && numBodyOps <= unsigned(coarseningThreshold)) {
+      int64_t innerTrip = *tripCounts[numDims - 1];
+      while (coarsening * 2 <= maxCoarsening &&
+             *totalIters / (coarsening * 2) >= deviceLanes &&
+             tileSizes[numDims - 1] * coarsening * 2 <= innerTrip)
+        coarsening *= 2;
+    }
+
+    OpBuilder b(op);
+    Location loc = op.getLoc();
+    Value c0 = b.create<arith::ConstantIndexOp>(loc, 0);
+    Value c1 = b.create<arith::ConstantIndexOp>(loc, 1);
+    SmallVector<Value> zeros(numDims, c0), ones(numDims, c1);
+    SmallVector<Value> threadCounts, blockSteps;
+    SmallVector<bool> needsGuard;
+    for (unsigned i = 0; i < numDims; ++i) {
+      int64_t span = tileSizes[i] * (i == numDims - 1 ? coarsening : 1);
+      threadCounts.push_back(
+          b.create<arith::ConstantIndexOp>(loc, tileSizes[i]));
+      blockSteps.push_back(b.createOrFold<arith::MulIOp>(
+          loc, op.getStep()[i], b.create<arith::ConstantIndexOp>(loc, span)));
+      needsGuard.push_back(!tripCounts[i] || *tripCounts[i] % span != 0);
+    }
+    Value numCoarsened = b.create<arith::ConstantIndexOp>(loc, coarsening);
+
+    // Computes the original induction variables and clones the body, guarded
+    // against the remainder of partial tiles.
+    auto buildBody = [&](OpBuilder &builder, Location bloc, ValueRange blockIvs,
+                         ValueRange threadIvs, Value coarseIv) {
+      SmallVector<Value> ivs;
+      Value inBounds;
+      for (unsigned i = 0; i < numDims; ++i) {
+        Value offset = threadIvs[i];
+        if (coarseIv && i == numDims - 1)
+          offset = builder.create<arith::AddIOp>(
+              bloc, offset,
+              builder.create<arith::MulIOp>(bloc, coarseIv, threadCounts[i]));
+        Value iv = builder.create<arith::AddIOp>(
+            bloc, blockIvs[i],
+            builder.create<arith::MulIOp>(bloc, offset, op.getStep()[i]));
+        ivs.push_back(iv);
+        if (!needsGuard[i])
+          continue;
+        Value cond = builder.create<arith::CmpIOp>(
+            bloc, arith::CmpIPredicate::slt, iv, op.getUpperBound()[i]);
+        inBounds =
+            inBounds ? builder.create<arith::AndIOp>(bloc, inBounds, cond)
+                     : cond;
+      }
+
+      auto cloneBody = [&](OpBuilder &cb) {
+        IRMapping mapping;
+        mapping.map(op.getInductionVars(), ivs);
+        for (Operation &bodyOp : op.getBody()->without_terminator())
+          cb.clone(bodyOp, mapping);
+      };
+      if (!inBounds)
+        return cloneBody(builder);
+      builder.create<scf::IfOp>(bloc, inBounds,
+                                [&](OpBuilder &ib, Location iloc) {
+                                  cloneBody(ib);
+                                  ib.create<scf::YieldOp>(iloc);
+                                });
+    };
+
+    scf::ParallelOp inner;
+    auto outer = b.create<scf::ParallelOp>(
+        loc, op.getLowerBound(), op.getUpperBound(), blockSteps,
+        [&](OpBuilder &ob, Location oloc, ValueRange blockIvs) {
+          inner = ob.create<scf::ParallelOp>(
+              oloc, zeros, threadCounts, ones,
+              [&](OpBuilder &ib, Location iloc, ValueRange threadIvs) {
+                if (coarsening == 1)
+                  return buildBody(ib, iloc, blockIvs, threadIvs, Value());
+                ib.create<scf::ForOp>(
+                    iloc, c0, numCoarsened, c1, ValueRange{},
+                    [&](OpBuilder &fb, Location floc, Value iv, ValueRange) {
+                      buildBody(fb, floc, blockIvs, threadIvs, iv);
+                      fb.create<scf::YieldOp>(floc);
+                    });
+              });
+        });
+    setMapping(outer, /*isThread=*/false);
+    setMapping(inner, /*isThread=*/true);
+    op.erase();
+  }
+};
+} // namespace
+
+namespace imex {
+std::unique_ptr<mlir::Pass> createTileParallelLoopsPass() {
+  return std::make_unique<TileParallelLoopsPass>();
+}
+} // namespace imex
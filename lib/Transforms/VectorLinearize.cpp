@@ -36,10 +36,49 @@ namespace imex {
 
 namespace {
 
+// Returns true if a slice of the given sizes, taken over the leading
+// dimensions of a vector of shape `shape` (trailing dimensions taken in full),
+// covers a single contiguous range of the row-major linearized vector. This
+// is the case when every dimension outside the innermost partially covered
+// one has size 1.
+static bool isContiguousSlice(llvm::ArrayRef<int64_t> shape,
+                              llvm::ArrayRef<int64_t> sizes) {
+  bool partial = false;
+  for (int64_t i = sizes.size() - 1; i >= 0; --i) {
+    if (partial && sizes[i] != 1)
+      return false;
+    if (sizes[i] != shape[i])
+      partial = true;
+  }
+  return true;
+}
+
+// Replaces `op` with the contiguous range [offset, offset + size) of the
+// linearized vector `src`. A range that covers the whole vector folds to the
+// source itself, the type converter takes care of the shape_cast.
+static void
+replaceWithContiguousExtract(mlir::Operation *op, mlir::Value src,
+                             int64_t offset, int64_t size,
+                             mlir::ConversionPatternRewriter &rewriter) {
+  auto srcTy = mlir::cast<mlir::VectorType>(src.getType());
+  if (offset == 0 && size == srcTy.getNumElements()) {
+    rewriter.replaceOp(op, src);
+    return;
+  }
+  int64_t offsets[] = {offset};
+  int64_t sizes[] = {size};
+  int64_t strides[] = {1};
+  rewriter.replaceOpWithNewOp<mlir::vector::ExtractStridedSliceOp>(
+      op, src, offsets, sizes, strides);
+}
+
 struct VectorExtractStridedSliceConversion final
     : public mlir::OpConversionPattern<mlir::vector::ExtractStridedSliceOp> {
-  using mlir::OpConversionPattern<
-      mlir::vector::ExtractStridedSliceOp>::OpConversionPattern;
+  VectorExtractStridedSliceConversion(mlir::TypeConverter &typeConverter,
+                                      mlir::MLIRContext *context,
+                                      bool contiguousSlices)
+      : OpConversionPattern(typeConverter, context),
+        contiguousSlices(contiguousSlices) {}
 
   mlir::LogicalResult
   matchAndRewrite(mlir::vector::ExtractStridedSliceOp extractOp,
@@ -91,6 +130,27 @@ struct VectorExtractStridedSliceConversion final
       sourceStrides[i] = sourceStrides[i + 1] *
                          extractOp.getSourceVectorType().getShape()[i + 1];
     }
+
+    // A slice which is a contiguous range of the linearized source does not
+    // need a per-element shuffle mask, a 1-D strided slice is enough.
+    if (contiguousSlices) {
+      llvm::SmallVector<int64_t> sizesInt;
+      for (auto size : sizes)
+        sizesInt.push_back(mlir::cast<mlir::IntegerAttr>(size).getInt());
+      if (isContiguousSlice(extractOp.getSourceVectorType().getShape(),
+                            sizesInt)) {
+        int64_t linearizedOffset = 0;
+        for (int64_t j = 0; j < k; ++j)
+          linearizedOffset +=
+              mlir::cast<mlir::IntegerAttr>(offsets[j]).getInt() *
+              sourceStrides[j];
+        replaceWithContiguousExtract(extractOp, srcVector, linearizedOffset,
+                                     nExtractedSlices * extractSliceLen,
+                                     rewriter);
+        return mlir::success();
+      }
+    }
+
     // final shuffle indices has nExtractedElems * extractSliceLen elements
     llvm::SmallVector<int64_t, 4> indices(nExtractedSlices * extractSliceLen);
     // compute the strides of the extracted kD vector
@@ -143,6 +203,9 @@ struct VectorExtractStridedSliceConversion final
     }
     return mlir::success();
   }
+
+private:
+  bool contiguousSlices;
 };
 
 struct VectorShffleOpConversion final
@@ -196,7 +259,11 @@ struct VectorShffleOpConversion final
 
 struct VectorExtractOpConversion final
     : public mlir::OpConversionPattern<mlir::vector::ExtractOp> {
-  using OpConversionPattern::OpConversionPattern;
+  VectorExtractOpConversion(mlir::TypeConverter &typeConverter,
+                            mlir::MLIRContext *context, bool contiguousSlices)
+      : OpConversionPattern(typeConverter, context),
+        contiguousSlices(contiguousSlices) {}
+
   mlir::LogicalResult
   matchAndRewrite(mlir::vector::ExtractOp extractOp, OpAdaptor adaptor,
                   mlir::ConversionPatternRewriter &rewriter) const override {
@@ -229,6 +296,10 @@ struct VectorExtractOpConversion final
           extractOp.getLoc(), rewriter.getI32IntegerAttr(linearizedOffset));
       rewriter.replaceOpWithNewOp<mlir::vector::ExtractElementOp>(
           extractOp, srcVector, pos);
+    } else if (contiguousSlices) {
+      // the extracted sub-vector is always a contiguous range.
+      replaceWithContiguousExtract(extractOp, srcVector, linearizedOffset,
+                                   size, rewriter);
     } else {
       llvm::SmallVector<int64_t, 2> indices(size);
       std::iota(indices.begin(), indices.end(), linearizedOffset);
@@ -239,11 +310,18 @@ struct VectorExtractOpConversion final
 
     return mlir::success();
   }
+
+private:
+  bool contiguousSlices;
 };
 
 struct VectorInsertOpConversion final
     : public mlir::OpConversionPattern<mlir::vector::InsertOp> {
-  using OpConversionPattern::OpConversionPattern;
+  VectorInsertOpConversion(mlir::TypeConverter &typeConverter,
+                           mlir::MLIRContext *context, bool contiguousSlices)
+      : OpConversionPattern(typeConverter, context),
+        contiguousSlices(contiguousSlices) {}
+
   mlir::LogicalResult
   matchAndRewrite(mlir::vector::InsertOp insertOp, OpAdaptor adaptor,
                   mlir::ConversionPatternRewriter &rewriter) const override {
@@ -277,6 +355,22 @@ struct VectorInsertOpConversion final
       linearizedOffset += offset * dstSizeForOffsets;
     }
 
+    // the inserted sub-vector is always a contiguous range of the
+    // destination, so a 1-D strided slice insert does the job without
+    // building two dstSize-long shuffle masks.
+    if (contiguousSlices) {
+      if ((int64_t)srcSize == dstSize) {
+        rewriter.replaceOp(insertOp, adaptor.getSource());
+      } else {
+        int64_t offsets[] = {linearizedOffset};
+        int64_t strides[] = {1};
+        rewriter.replaceOpWithNewOp<mlir::vector::InsertStridedSliceOp>(
+            insertOp, adaptor.getSource(), adaptor.getDest(), offsets,
+            strides);
+      }
+      return mlir::success();
+    }
+
     llvm::SmallVector<int64_t, 2> indices(dstSize);
     auto origValsUntil = indices.begin();
     std::advance(origValsUntil, linearizedOffset);
@@ -308,6 +402,9 @@ struct VectorInsertOpConversion final
 
     return mlir::success();
   }
+
+private:
+  bool contiguousSlices;
 };
 
 struct VectorSplatOpConversion final
@@ -327,6 +424,7 @@ struct VectorSplatOpConversion final
 
 struct VectorLinearizePass final
     : public imex::impl::VectorLinearizeBase<VectorLinearizePass> {
+  using VectorLinearizeBase::VectorLinearizeBase;
 
   void runOnOperation() override {
     auto *context = &getContext();
@@ -366,9 +464,11 @@ struct VectorLinearizePass final
           return (op && op.getAggregate().getType().getRank() == 1);
         });
 
-    patterns.add<VectorExtractStridedSliceConversion, VectorShffleOpConversion,
-                 VectorExtractOpConversion, VectorInsertOpConversion,
-                 VectorSplatOpConversion>(typeConverter, context);
+    patterns.add<VectorShffleOpConversion, VectorSplatOpConversion>(
+        typeConverter, context);
+    patterns.add<VectorExtractStridedSliceConversion, VectorExtractOpConversion,
+                 VectorInsertOpConversion>(typeConverter, context,
+                                           contiguousSlices);
 
     // Shuffle16x16 will fallback to Shuffle1D for non 16x16 sizes.
     mlir::vector::populateVectorTransposeLoweringPatterns(
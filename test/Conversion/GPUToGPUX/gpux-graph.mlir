@@ -0,0 +1,43 @@
+// RUN: imex-opt --convert-gpu-to-gpux="form-graphs=true" %s | FileCheck %s
+// RUN: imex-opt --convert-gpu-to-gpux="form-graphs=true shared-streams=true" %s | FileCheck %s --check-prefix=SHARED
+
+module attributes {gpu.container_module} {
+// CHECK-LABEL: func @main
+func.func @main(%arg0: memref<8xf32>) {
+  %c1 = arith.constant 1 : index
+  %c8 = arith.constant 8 : index
+  // CHECK: %[[STREAM:.*]] = "gpux.create_stream"() : () -> !gpux.StreamType
+  // CHECK: %[[ALLOC:.*]] = "gpux.alloc"(%[[STREAM]])
+  %memref = gpu.alloc () : memref<8xf32>
+  // CHECK: "gpux.graph"(%[[STREAM]]) ({
+  // CHECK-NEXT: "gpux.memcpy"(%[[STREAM]], %[[ALLOC]], %{{.*}})
+  // CHECK-NEXT: "gpux.launch_func"(%[[STREAM]]
+  // CHECK-NEXT: "gpux.launch_func"(%[[STREAM]]
+  // CHECK-NEXT: "gpux.memcpy"(%[[STREAM]], %{{.*}}, %[[ALLOC]])
+  // CHECK-NEXT: }) : (!gpux.StreamType) -> ()
+  gpu.memcpy %memref, %arg0 : memref<8xf32>, memref<8xf32>
+  gpu.launch_func @Kernels::@kernel_1 blocks in (%c8, %c1, %c1) threads in (%c1, %c1, %c1) args(%memref : memref<8xf32>)
+  %c4 = arith.constant 4 : index
+  gpu.launch_func @Kernels::@kernel_1 blocks in (%c4, %c1, %c1) threads in (%c1, %c1, %c1) args(%memref : memref<8xf32>)
+  gpu.memcpy %arg0, %memref : memref<8xf32>, memref<8xf32>
+  // A single launch is not worth a graph.
+  // CHECK-NEXT: "gpux.dealloc"(%[[STREAM]], %[[ALLOC]])
+  // CHECK-NEXT: "gpux.launch_func"(%[[STREAM]]
+  // CHECK-NEXT: "gpux.destroy_stream"(%[[STREAM]])
+  gpu.dealloc %memref : memref<8xf32>
+  gpu.launch_func @Kernels::@kernel_1 blocks in (%c8, %c1, %c1) threads in (%c1, %c1, %c1) args(%arg0 : memref<8xf32>)
+  return
+}
+
+// A shared stream serves all threads, its commands are not recorded.
+// SHARED-LABEL: func @main
+// SHARED: "gpux.create_stream"() <{shared}>
+// SHARED-NOT: "gpux.graph"
+// SHARED: return
+
+gpu.module @Kernels {
+  gpu.func @kernel_1(%arg0: memref<8xf32>) kernel {
+    gpu.return
+  }
+}
+}
@@ -0,0 +1,23 @@
+// RUN: imex-opt --convert-gpu-to-gpux="shared-streams=true" %s | FileCheck %s
+
+// CHECK-LABEL: func @main
+func.func @main() attributes {llvm.emit_c_interface} {
+  // CHECK: %[[STREAM:.*]] = "gpux.create_stream"() <{shared}> : () -> !gpux.StreamType
+  // CHECK: %[[ALLOC:.*]] = "gpux.alloc"(%[[STREAM]])
+  %memref = gpu.alloc  () : memref<8xf32>
+  // CHECK: "gpux.dealloc"(%[[STREAM]], %[[ALLOC]])
+  gpu.dealloc  %memref : memref<8xf32>
+  // CHECK-NOT: "gpux.destroy_stream"
+  // CHECK: return
+  return
+}
+
+// CHECK-LABEL: func @other
+func.func @other() {
+  // CHECK: %[[STREAM:.*]] = "gpux.create_stream"() <{shared}> : () -> !gpux.StreamType
+  // CHECK: "gpux.alloc"(%[[STREAM]])
+  %memref = gpu.alloc  () : memref<8xf32>
+  // CHECK-NOT: "gpux.destroy_stream"
+  // CHECK: return
+  return
+}
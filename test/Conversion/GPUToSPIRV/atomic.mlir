@@ -0,0 +1,27 @@
+// RUN: imex-opt -allow-unregistered-dialect -split-input-file -imex-convert-gpu-to-spirv -verify-diagnostics %s -o - | FileCheck %s
+
+module attributes {
+  gpu.container_module,
+  spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR], [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume]>, #spirv.resource_limits<>>
+} {
+  func.func @atomic_addf(%arg0: memref<f32>, %arg1: f32) {
+    %c1 = arith.constant 1 : index
+    gpu.launch_func @kernels::@atomic_addf_kernel
+        blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%arg0: memref<f32>, %arg1: f32)
+    return
+  }
+
+  // CHECK-LABEL: spirv.module @{{.*}} Physical64 OpenCL
+  gpu.module @kernels {
+    // CHECK-LABEL: spirv.func @atomic_addf_kernel(
+    // CHECK-SAME: %[[ARG0:.*]]: !spirv.ptr<!spirv.array<1 x f32>, CrossWorkgroup>{{.*}}, %[[ARG1:.*]]: f32
+    gpu.func @atomic_addf_kernel(%arg0: memref<f32>, %arg1: f32) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      // CHECK: %[[PTR:.*]] = spirv.AccessChain %[[ARG0]]
+      // CHECK: spirv.EXT.AtomicFAdd <Device> <AcquireRelease> %[[PTR]], %[[ARG1]] : !spirv.ptr<f32, CrossWorkgroup>
+      %0 = memref.atomic_rmw addf %arg1, %arg0[] : (f32, memref<f32>) -> f32
+      gpu.return
+    }
+  }
+}
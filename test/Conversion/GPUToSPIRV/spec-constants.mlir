@@ -0,0 +1,79 @@
+// RUN: imex-opt -allow-unregistered-dialect -split-input-file -imex-convert-gpu-to-spirv -verify-diagnostics %s -o - | FileCheck %s
+
+module attributes {
+  gpu.container_module,
+  spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64], []>, #spirv.resource_limits<>>
+} {
+  func.func @main(%arg0: memref<?xf32>, %arg1: index, %arg2: i32) {
+    %c1 = arith.constant 1 : index
+    gpu.launch_func @kernels::@fill_kernel
+        blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%arg0: memref<?xf32>, %arg1: index, %arg2: i32)
+    gpu.launch_func @kernels::@scale_kernel
+        blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%arg0: memref<?xf32>, %arg1: index)
+    return
+  }
+
+  // CHECK-LABEL: spirv.module @{{.*}} Physical64 OpenCL
+  // CHECK-DAG: spirv.SpecConstant @[[SPEC0:spec_arg0]] spec_id(0) = 0 : i64
+  // CHECK-DAG: spirv.SpecConstant @[[SPEC1:spec_arg1]] spec_id(1) = 0 : i32
+  gpu.module @kernels {
+    // The arguments are kept, their uses read the specialization constants.
+    // CHECK-LABEL: spirv.func @fill_kernel(
+    // CHECK-SAME: %{{.*}}: !spirv.ptr<{{.*}}>{{.*}}, %{{.*}}: i64{{.*}}, %{{.*}}: i32
+    // CHECK-DAG: %[[SIZE:.*]] = spirv.mlir.referenceof @[[SPEC0]] : i64
+    // CHECK-DAG: %[[VALUE:.*]] = spirv.mlir.referenceof @[[SPEC1]] : i32
+    // CHECK: spirv.ConvertSToF %[[VALUE]] : i32 to f32
+    // CHECK: spirv.mlir.loop
+    // CHECK: spirv.SLessThan %{{.*}}, %[[SIZE]] : i64
+    gpu.func @fill_kernel(%arg0: memref<?xf32>, %arg1: index {gpux.spec_id = 0 : i32}, %arg2: i32 {gpux.spec_id = 1 : i32}) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %value = arith.sitofp %arg2 : i32 to f32
+      scf.for %i = %c0 to %arg1 step %c1 {
+        memref.store %value, %arg0[%i] : memref<?xf32>
+      }
+      gpu.return
+    }
+
+    // Kernels of a module marking the same id share the constant.
+    // CHECK-LABEL: spirv.func @scale_kernel(
+    // CHECK: spirv.mlir.referenceof @[[SPEC0]] : i64
+    gpu.func @scale_kernel(%arg0: memref<?xf32>, %arg1: index {gpux.spec_id = 0 : i32}) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      scf.for %i = %c0 to %arg1 step %c1 {
+        %0 = memref.load %arg0[%i] : memref<?xf32>
+        %1 = arith.addf %0, %0 : f32
+        memref.store %1, %arg0[%i] : memref<?xf32>
+      }
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+module attributes {
+  gpu.container_module,
+  spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64], []>, #spirv.resource_limits<>>
+} {
+  func.func @main(%arg0: f32) {
+    %c1 = arith.constant 1 : index
+    gpu.launch_func @kernels::@float_kernel
+        blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%arg0: f32)
+    return
+  }
+
+  gpu.module @kernels {
+    // expected-error @+1 {{argument 0 with gpux.spec_id must be an integer or index}}
+    gpu.func @float_kernel(%arg0: f32 {gpux.spec_id = 0 : i32}) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      gpu.return
+    }
+  }
+}
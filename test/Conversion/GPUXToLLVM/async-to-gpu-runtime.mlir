@@ -0,0 +1,46 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm %s | FileCheck %s
+
+module attributes {gpu.container_module} {
+  // CHECK-LABEL: llvm.func @main
+  func.func @main(%arg0: memref<8xf32>) attributes {llvm.emit_c_interface} {
+    %c1 = arith.constant 1 : index
+    %c8 = arith.constant 8 : index
+    // CHECK: %[[STREAM:.*]] = llvm.call @gpuCreateStream
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    %memref = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<8xf32>
+
+    // An async copy without dependencies.
+    // CHECK: %[[T0:.*]] = llvm.call @gpuMemCopyAsync(%[[STREAM]], %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, !llvm.ptr, i64, !llvm.ptr, i64) -> !llvm.ptr
+    %t0 = "gpux.memcpy"(%0, %memref, %arg0) : (!gpux.StreamType, memref<8xf32>, memref<8xf32>) -> !gpu.async.token
+
+    // The launch depends on the copy.
+    // CHECK: llvm.store %[[T0]], %{{.*}} : !llvm.ptr, !llvm.ptr
+    // CHECK: %[[T1:.*]] = llvm.call @gpuLaunchKernelAsync(%[[STREAM]], %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, i64, i64, i64, i64, i64, i64, i32, !llvm.ptr, !llvm.ptr, i64) -> !llvm.ptr
+    // CHECK-NOT: llvm.call @gpuWait(
+    %t1 = "gpux.launch_func"(%t0, %0, %c8, %c1, %c1, %c1, %c1, %c1, %memref) {kernel = @Kernels::@kernel_1, operandSegmentSizes = array<i32: 1, 1, 1, 1, 1, 1, 1, 1, 0, 1>} : (!gpu.async.token, !gpux.StreamType, index, index, index, index, index, index, memref<8xf32>) -> !gpu.async.token
+
+    // CHECK: llvm.store %[[T1]], %{{.*}} : !llvm.ptr, !llvm.ptr
+    // CHECK: %[[T2:.*]] = llvm.call @gpuMemCopyAsync(%[[STREAM]], %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}})
+    %t2 = "gpux.memcpy"(%t1, %0, %arg0, %memref) : (!gpu.async.token, !gpux.StreamType, memref<8xf32>, memref<8xf32>) -> !gpu.async.token
+
+    // CHECK: llvm.store %[[T2]], %{{.*}} : !llvm.ptr, !llvm.ptr
+    // CHECK: %[[T3:.*]] = llvm.call @gpuEventJoin(%[[STREAM]], %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, i64) -> !llvm.ptr
+    %t3 = "gpux.wait"(%t2, %0) : (!gpu.async.token, !gpux.StreamType) -> !gpu.async.token
+
+    // CHECK: llvm.store %[[T3]], %{{.*}} : !llvm.ptr, !llvm.ptr
+    // CHECK: llvm.call @gpuWaitEvents(%[[STREAM]], %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, i64) -> ()
+    "gpux.wait"(%t3, %0) : (!gpu.async.token, !gpux.StreamType) -> ()
+
+    // CHECK: llvm.call @gpuWait(%[[STREAM]]) : (!llvm.ptr) -> ()
+    "gpux.wait"(%0) : (!gpux.StreamType) -> ()
+    "gpux.dealloc"(%0, %memref) : (!gpux.StreamType, memref<8xf32>) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+
+  gpu.module @Kernels attributes {gpu.binary = "\03\02#\07"} {
+    gpu.func @kernel_1(%arg0: memref<8xf32>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      gpu.return
+    }
+  }
+}
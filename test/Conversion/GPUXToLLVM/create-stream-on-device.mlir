@@ -0,0 +1,21 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm %s | FileCheck %s
+
+module attributes {gpu.container_module}{
+  // CHECK-LABEL: llvm.func @main
+  func.func @main() attributes {llvm.emit_c_interface} {
+    // CHECK: %[[DEVICE:.*]] = llvm.mlir.constant(1 : i32) : i32
+    // CHECK: %[[QUEUE:.*]] = llvm.mlir.constant(2 : i32) : i32
+    // CHECK: %[[STREAM:.*]] = llvm.call @gpuCreateStreamOnDevice(%[[DEVICE]], %[[QUEUE]]) : (i32, i32) -> !llvm.ptr
+    %0 = "gpux.create_stream"() {device_index = 1 : i32, queue_index = 2 : i32} : () -> !gpux.StreamType
+    // A missing index defaults to 0.
+    // CHECK: %[[DEVICE0:.*]] = llvm.mlir.constant(0 : i32) : i32
+    // CHECK: %[[QUEUE1:.*]] = llvm.mlir.constant(1 : i32) : i32
+    // CHECK: %[[STREAM1:.*]] = llvm.call @gpuCreateStreamOnDevice(%[[DEVICE0]], %[[QUEUE1]]) : (i32, i32) -> !llvm.ptr
+    %1 = "gpux.create_stream"() {queue_index = 1 : i32} : () -> !gpux.StreamType
+    // CHECK: llvm.call @gpuStreamDestroy(%[[STREAM1]]) : (!llvm.ptr)
+    "gpux.destroy_stream"(%1) : (!gpux.StreamType) -> ()
+    // CHECK: llvm.call @gpuStreamDestroy(%[[STREAM]]) : (!llvm.ptr)
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+}
@@ -0,0 +1,33 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm %s | FileCheck %s
+
+module attributes {gpu.container_module} {
+  // CHECK-LABEL: llvm.func @main
+  func.func @main(%arg0: memref<8xf32>) attributes {llvm.emit_c_interface} {
+    // CHECK: %[[STREAM:.*]] = llvm.call @gpuCreateStream
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    %memref = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<8xf32>
+    // CHECK: %[[GRAPH:.*]] = llvm.mlir.addressof @gpux_graph_0 : !llvm.ptr
+    // CHECK: llvm.call @gpuGraphBegin(%[[STREAM]], %[[GRAPH]]) : (!llvm.ptr, !llvm.ptr) -> ()
+    // CHECK: llvm.call @gpuMemCopy(%[[STREAM]],
+    // CHECK: llvm.call @gpuMemCopy(%[[STREAM]],
+    // CHECK: llvm.call @gpuGraphEnd(%[[STREAM]], %[[GRAPH]]) : (!llvm.ptr, !llvm.ptr) -> ()
+    "gpux.graph"(%0) ({
+      "gpux.memcpy"(%0, %memref, %arg0) : (!gpux.StreamType, memref<8xf32>, memref<8xf32>) -> ()
+      "gpux.memcpy"(%0, %arg0, %memref) : (!gpux.StreamType, memref<8xf32>, memref<8xf32>) -> ()
+    }) : (!gpux.StreamType) -> ()
+    // Every graph has its own identifier.
+    // CHECK: %[[GRAPH1:.*]] = llvm.mlir.addressof @gpux_graph_1 : !llvm.ptr
+    // CHECK: llvm.call @gpuGraphBegin(%[[STREAM]], %[[GRAPH1]])
+    // CHECK: llvm.call @gpuMemCopy(%[[STREAM]],
+    // CHECK: llvm.call @gpuGraphEnd(%[[STREAM]], %[[GRAPH1]])
+    "gpux.graph"(%0) ({
+      "gpux.memcpy"(%0, %memref, %arg0) : (!gpux.StreamType, memref<8xf32>, memref<8xf32>) -> ()
+    }) : (!gpux.StreamType) -> ()
+    "gpux.dealloc"(%0, %memref) : (!gpux.StreamType, memref<8xf32>) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+
+  // CHECK: llvm.mlir.global internal @gpux_graph_0() {addr_space = 0 : i32} : !llvm.ptr
+  // CHECK: llvm.mlir.global internal @gpux_graph_1() {addr_space = 0 : i32} : !llvm.ptr
+}
@@ -14,12 +14,14 @@ module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#s
     %memref_0 = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<8xf32>
     %memref_1 = "gpux.alloc"(%0) {operandSegmentSizes = array<i32: 0, 1, 0, 0>} : (!gpux.StreamType) -> memref<8xf32>
 
-    // CHECK: llvm.mlir.addressof @Kernels_spirv_binary : !llvm.ptr
-    // CHECK: %[[MODULE:.*]] = llvm.call @gpuModuleLoad(%[[STREAM]], %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, i64) -> !llvm.ptr
-    // CHECK: llvm.mlir.addressof @Kernels_kernel_1_kernel_name : !llvm.ptr
-    // CHECK: %[[KERNEL:.*]] = llvm.call @gpuKernelGet(%[[STREAM]], %[[MODULE]], %{{.*}}) : (!llvm.ptr, !llvm.ptr, !llvm.ptr) -> !llvm.ptr
+    // CHECK-NOT: llvm.call @gpuKernelGetSpecialized
+    // CHECK: %[[KERNEL:.*]] = llvm.call @Kernels_kernel_1_get_kernel(%[[STREAM]]) : (!llvm.ptr) -> !llvm.ptr
     // CHECK: llvm.call @gpuLaunchKernel(%[[STREAM]], %[[KERNEL]], %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}) : (!llvm.ptr, !llvm.ptr, i64, i64, i64, i64, i64, i64, i32, !llvm.ptr) -> ()
     "gpux.launch_func"(%0, %c8, %c1, %c1, %c1, %c1, %c1, %memref, %memref_0, %memref_1) {kernel = @Kernels::@kernel_1, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 3>} : (!gpux.StreamType, index, index, index, index, index, index, memref<8xf32>, memref<8xf32>, memref<8xf32>) -> ()
+    // CHECK-NOT: llvm.call @gpuKernelGetSpecialized
+    // CHECK: %[[KERNEL2:.*]] = llvm.call @Kernels_kernel_1_get_kernel(%[[STREAM]]) : (!llvm.ptr) -> !llvm.ptr
+    // CHECK: llvm.call @gpuLaunchKernel(%[[STREAM]], %[[KERNEL2]],
+    "gpux.launch_func"(%0, %c8, %c1, %c1, %c1, %c1, %c1, %memref, %memref_0, %memref_1) {kernel = @Kernels::@kernel_1, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 3>} : (!gpux.StreamType, index, index, index, index, index, index, memref<8xf32>, memref<8xf32>, memref<8xf32>) -> ()
     "gpux.dealloc"(%0, %memref) : (!gpux.StreamType, memref<8xf32>) -> ()
     "gpux.dealloc"(%0, %memref_0) : (!gpux.StreamType, memref<8xf32>) -> ()
     "gpux.dealloc"(%0, %memref_1) : (!gpux.StreamType, memref<8xf32>) -> ()
@@ -38,4 +40,15 @@ module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#s
       gpu.return
     }
   }
+
+  // CHECK: llvm.mlir.global internal @Kernels_kernel_1_kernel_handle()
+  // CHECK: llvm.mlir.zero : !llvm.ptr
+  // CHECK: llvm.func internal @Kernels_kernel_1_get_kernel(%[[ARG:.*]]: !llvm.ptr) -> !llvm.ptr
+  // CHECK: %[[HANDLE:.*]] = llvm.mlir.addressof @Kernels_kernel_1_kernel_handle : !llvm.ptr
+  // CHECK: llvm.mlir.addressof @Kernels_spirv_binary : !llvm.ptr
+  // CHECK: llvm.mlir.addressof @Kernels_kernel_1_kernel_name : !llvm.ptr
+  // CHECK: %[[NULL:.*]] = llvm.mlir.zero : !llvm.ptr
+  // CHECK: %[[ZERO:.*]] = llvm.mlir.constant(0 : i64) : i64
+  // CHECK: %[[KERNEL:.*]] = llvm.call @gpuKernelGetSpecialized(%[[ARG]], %[[HANDLE]], %{{.*}}, %{{.*}}, %{{.*}}, %[[NULL]], %[[NULL]], %[[ZERO]]) : (!llvm.ptr, !llvm.ptr, !llvm.ptr, i64, !llvm.ptr, !llvm.ptr, !llvm.ptr, i64) -> !llvm.ptr
+  // CHECK: llvm.return %[[KERNEL]] : !llvm.ptr
 }
@@ -0,0 +1,30 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm %s | FileCheck %s
+
+module attributes {gpu.container_module}{
+  // CHECK-LABEL: llvm.func @main
+  func.func @main() attributes {llvm.emit_c_interface} {
+    // CHECK: %[[SLOT:.*]] = llvm.mlir.addressof @gpux_shared_stream_0_0 : !llvm.ptr
+    // CHECK: %[[DEVICE:.*]] = llvm.mlir.constant(0 : i32) : i32
+    // CHECK: %[[QUEUE:.*]] = llvm.mlir.constant(0 : i32) : i32
+    // CHECK: llvm.call @gpuGetSharedStream(%[[SLOT]], %[[DEVICE]], %[[QUEUE]]) : (!llvm.ptr, i32, i32) -> !llvm.ptr
+    %0 = "gpux.create_stream"() {shared} : () -> !gpux.StreamType
+    // CHECK-NOT: llvm.call @gpuStreamDestroy
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+
+  // Streams with the same indices share the same global.
+  // CHECK-LABEL: llvm.func @other
+  func.func @other() attributes {llvm.emit_c_interface} {
+    // CHECK: llvm.mlir.addressof @gpux_shared_stream_0_0 : !llvm.ptr
+    // CHECK: llvm.call @gpuGetSharedStream
+    %0 = "gpux.create_stream"() {shared} : () -> !gpux.StreamType
+    // CHECK: llvm.mlir.addressof @gpux_shared_stream_1_0 : !llvm.ptr
+    // CHECK: llvm.call @gpuGetSharedStream
+    %1 = "gpux.create_stream"() {device_index = 1 : i32, shared} : () -> !gpux.StreamType
+    return
+  }
+
+  // CHECK: llvm.mlir.global internal @gpux_shared_stream_0_0() {addr_space = 0 : i32} : !llvm.ptr
+  // CHECK: llvm.mlir.global internal @gpux_shared_stream_1_0() {addr_space = 0 : i32} : !llvm.ptr
+}
@@ -0,0 +1,54 @@
+// RUN: imex-opt -convert-func-to-llvm -convert-gpux-to-llvm %s | FileCheck %s
+
+module attributes {gpu.container_module} {
+  // CHECK-LABEL: llvm.func @main
+  // CHECK-SAME: (%[[N:.*]]: i64, %[[M:.*]]: i32, %[[X:.*]]: f32)
+  func.func @main(%n: index, %m: i32, %x: f32) attributes {llvm.emit_c_interface} {
+    %c1 = arith.constant 1 : index
+    // CHECK: %[[STREAM:.*]] = llvm.call @gpuCreateStream
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+
+    // The ids and the values of the specialized arguments are passed to the
+    // getter on every launch.
+    // CHECK-NOT: llvm.call @Kernels_spec_kernel_get_kernel
+    // CHECK: %[[IDS:.*]] = llvm.alloca %{{.*}} x i32 : (i64) -> !llvm.ptr
+    // CHECK: %[[VALUES:.*]] = llvm.alloca %{{.*}} x i64 : (i64) -> !llvm.ptr
+    // CHECK: %[[ID0:.*]] = llvm.mlir.constant(0 : i32) : i32
+    // CHECK: %[[IDPTR0:.*]] = llvm.getelementptr %[[IDS]][0] : (!llvm.ptr) -> !llvm.ptr, i32
+    // CHECK: llvm.store %[[ID0]], %[[IDPTR0]] : i32, !llvm.ptr
+    // CHECK: %[[VALUEPTR0:.*]] = llvm.getelementptr %[[VALUES]][0] : (!llvm.ptr) -> !llvm.ptr, i64
+    // CHECK: llvm.store %[[N]], %[[VALUEPTR0]] : i64, !llvm.ptr
+    // CHECK: %[[EXT:.*]] = llvm.sext %[[M]] : i32 to i64
+    // CHECK: %[[ID1:.*]] = llvm.mlir.constant(3 : i32) : i32
+    // CHECK: %[[IDPTR1:.*]] = llvm.getelementptr %[[IDS]][1] : (!llvm.ptr) -> !llvm.ptr, i32
+    // CHECK: llvm.store %[[ID1]], %[[IDPTR1]] : i32, !llvm.ptr
+    // CHECK: %[[VALUEPTR1:.*]] = llvm.getelementptr %[[VALUES]][1] : (!llvm.ptr) -> !llvm.ptr, i64
+    // CHECK: llvm.store %[[EXT]], %[[VALUEPTR1]] : i64, !llvm.ptr
+    // CHECK: %[[COUNT:.*]] = llvm.mlir.constant(2 : i64) : i64
+    // CHECK: %[[SLOT:.*]] = llvm.mlir.addressof @Kernels_spec_kernel_kernel_slot_0 : !llvm.ptr
+    // CHECK: %[[KERNEL:.*]] = llvm.call @Kernels_spec_kernel_get_specialized_kernel(%[[STREAM]], %[[SLOT]], %[[IDS]], %[[VALUES]], %[[COUNT]]) : (!llvm.ptr, !llvm.ptr, !llvm.ptr, !llvm.ptr, i64) -> !llvm.ptr
+    // CHECK: llvm.call @gpuLaunchKernel(%[[STREAM]], %[[KERNEL]],
+    "gpux.launch_func"(%0, %c1, %c1, %c1, %c1, %c1, %c1, %n, %m, %x) {kernel = @Kernels::@spec_kernel, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 3>} : (!gpux.StreamType, index, index, index, index, index, index, index, i32, f32) -> ()
+
+    // Every launch site caches its kernel in its own slot.
+    // CHECK: %[[SLOT1:.*]] = llvm.mlir.addressof @Kernels_spec_kernel_kernel_slot_1 : !llvm.ptr
+    // CHECK: llvm.call @Kernels_spec_kernel_get_specialized_kernel(%[[STREAM]], %[[SLOT1]],
+    "gpux.launch_func"(%0, %c1, %c1, %c1, %c1, %c1, %c1, %n, %m, %x) {kernel = @Kernels::@spec_kernel, operandSegmentSizes = array<i32: 0, 1, 1, 1, 1, 1, 1, 1, 0, 3>} : (!gpux.StreamType, index, index, index, index, index, index, index, i32, f32) -> ()
+    "gpux.destroy_stream"(%0) : (!gpux.StreamType) -> ()
+    return
+  }
+  gpu.module @Kernels attributes {gpu.binary = "\03\02#\07"} {
+    gpu.func @spec_kernel(%arg0: index {gpux.spec_id = 0 : i32}, %arg1: i32 {gpux.spec_id = 3 : i32}, %arg2: f32) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      gpu.return
+    }
+  }
+
+  // CHECK: llvm.func internal @Kernels_spec_kernel_get_specialized_kernel(%[[S:.*]]: !llvm.ptr, %[[SL:.*]]: !llvm.ptr, %[[I:.*]]: !llvm.ptr, %[[V:.*]]: !llvm.ptr, %[[C:.*]]: i64) -> !llvm.ptr
+  // CHECK: llvm.mlir.addressof @Kernels_spirv_binary : !llvm.ptr
+  // CHECK: %[[SIZE:.*]] = llvm.mlir.constant(4 : i64) : i64
+  // CHECK: llvm.mlir.addressof @Kernels_spec_kernel_kernel_name : !llvm.ptr
+  // CHECK: %[[K:.*]] = llvm.call @gpuKernelGetSpecialized(%[[S]], %[[SL]], %{{.*}}, %[[SIZE]], %{{.*}}, %[[I]], %[[V]], %[[C]]) : (!llvm.ptr, !llvm.ptr, !llvm.ptr, i64, !llvm.ptr, !llvm.ptr, !llvm.ptr, i64) -> !llvm.ptr
+  // CHECK: llvm.return %[[K]] : !llvm.ptr
+  // CHECK: llvm.mlir.global internal @Kernels_spec_kernel_kernel_slot_0() {{.*}} : !llvm.ptr
+  // CHECK: llvm.mlir.global internal @Kernels_spec_kernel_kernel_slot_1() {{.*}} : !llvm.ptr
+}
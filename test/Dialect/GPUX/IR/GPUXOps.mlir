@@ -7,6 +7,20 @@ func.func @test_create_stream() -> !gpux.StreamType{
     return %3 : !gpux.StreamType
 }
 
+// CHECK-LABEL: @test_create_stream_on_device
+func.func @test_create_stream_on_device() -> !gpux.StreamType{
+    // CHECK: "gpux.create_stream"() <{device_index = 1 : i32, queue_index = 2 : i32}> : () -> !gpux.StreamType
+    %0 = "gpux.create_stream"() {device_index = 1 : i32, queue_index = 2 : i32} : () -> !gpux.StreamType
+    return %0 : !gpux.StreamType
+}
+
+// CHECK-LABEL: @test_create_shared_stream
+func.func @test_create_shared_stream() -> !gpux.StreamType{
+    // CHECK: "gpux.create_stream"() <{shared}> : () -> !gpux.StreamType
+    %0 = "gpux.create_stream"() {shared} : () -> !gpux.StreamType
+    return %0 : !gpux.StreamType
+}
+
 // CHECK-LABEL: @test_destroy_stream
 func.func @test_destroy_stream() {
     %0 = "gpux.create_stream"() : () -> !gpux.StreamType
@@ -68,3 +82,17 @@ func.func @test_gpux_memset(%dst : memref<3x7xf32>, %value : f32) {
     "gpux.memset"(%0, %dst, %value) : (!gpux.StreamType, memref<3x7xf32>, f32) -> ()
     return
 }
+
+// CHECK-LABEL: @test_gpux_graph
+func.func @test_gpux_graph(%dst : memref<3x7xf32>, %src : memref<3x7xf32, 1>) {
+    %0 = "gpux.create_stream"() : () -> !gpux.StreamType
+    // CHECK: "gpux.graph"(%{{.*}}) ({
+    // CHECK: "gpux.memcpy"
+    // CHECK: "gpux.memcpy"
+    // CHECK: }) : (!gpux.StreamType) -> ()
+    "gpux.graph"(%0) ({
+      "gpux.memcpy"(%0, %dst, %src) : (!gpux.StreamType, memref<3x7xf32>, memref<3x7xf32, 1>) -> ()
+      "gpux.memcpy"(%0, %src, %dst) : (!gpux.StreamType, memref<3x7xf32, 1>, memref<3x7xf32>) -> ()
+    }) : (!gpux.StreamType) -> ()
+    return
+}
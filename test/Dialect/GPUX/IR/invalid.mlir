@@ -0,0 +1,28 @@
+// RUN: imex-opt %s -split-input-file -verify-diagnostics
+
+func.func @create_stream_device_index_with_device(%device : !gpux.DeviceType, %context : !gpux.ContextType) -> !gpux.StreamType {
+    // expected-error@+1 {{cannot have a device_index or queue_index with a device or context operand}}
+    %0 = "gpux.create_stream"(%device, %context) {device_index = 1 : i32} : (!gpux.DeviceType, !gpux.ContextType) -> !gpux.StreamType
+    return %0 : !gpux.StreamType
+}
+
+// -----
+func.func @create_stream_queue_index_with_device(%device : !gpux.DeviceType, %context : !gpux.ContextType) -> !gpux.StreamType {
+    // expected-error@+1 {{cannot have a device_index or queue_index with a device or context operand}}
+    %0 = "gpux.create_stream"(%device, %context) {queue_index = 2 : i32} : (!gpux.DeviceType, !gpux.ContextType) -> !gpux.StreamType
+    return %0 : !gpux.StreamType
+}
+
+// -----
+func.func @create_stream_indices_with_device(%device : !gpux.DeviceType, %context : !gpux.ContextType) -> !gpux.StreamType {
+    // expected-error@+1 {{cannot have a device_index or queue_index with a device or context operand}}
+    %0 = "gpux.create_stream"(%device, %context) {device_index = 1 : i32, queue_index = 2 : i32} : (!gpux.DeviceType, !gpux.ContextType) -> !gpux.StreamType
+    return %0 : !gpux.StreamType
+}
+
+// -----
+func.func @create_shared_stream_with_device(%device : !gpux.DeviceType, %context : !gpux.ContextType) -> !gpux.StreamType {
+    // expected-error@+1 {{cannot be shared with a device or context operand}}
+    %0 = "gpux.create_stream"(%device, %context) {shared} : (!gpux.DeviceType, !gpux.ContextType) -> !gpux.StreamType
+    return %0 : !gpux.StreamType
+}
@@ -380,3 +380,18 @@ gpu.module @test_kernel {
     }
 
 }
+
+// -----
+gpu.module @test_kernel {
+  // CHECK-LABEL: gpu.func @sg_load_tile_transpose_f32
+  // CHECK-SAME: (%[[arg0:.*]]: memref<512x1024xf32, strided<[1, 512]>>)
+  gpu.func @sg_load_tile_transpose_f32(%a: memref<512x1024xf32, strided<[1, 512]>>) {
+    %c0 = arith.constant 0 : index
+    // The inner blocks are computed for the transposed (memory) shape, i.e. 16x8, and swapped.
+    // CHECK: %[[r0:.*]] = xetile.init_tile %[[arg0]][%{{.*}}, %{{.*}}] : memref<512x1024xf32, strided<[1, 512]>> -> !xetile.tile<32x16xf32, #xetile.tile_attr<order = [0, 1], inner_blocks = [8, 16]>>
+    %t = xetile.init_tile %a[%c0, %c0] : memref<512x1024xf32, strided<[1, 512]>> -> !xetile.tile<32x16xf32, #xetile.tile_attr<order = [0, 1]>>
+    // CHECK: %{{.*}} = xetile.load_tile %[[r0]] {{.*}} -> vector<4x1x8x16xf32>
+    %v = xetile.load_tile %t : !xetile.tile<32x16xf32, #xetile.tile_attr<order = [0, 1]>> -> vector<32x16xf32>
+    gpu.return
+  }
+}
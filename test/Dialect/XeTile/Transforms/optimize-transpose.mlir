@@ -150,3 +150,48 @@ gpu.module @mod2 {
     gpu.return
   }
 }
+
+// -----
+gpu.module @mod3 {
+  // CHECK-LABEL: gpu.func @transpose_f32
+  // CHECK-SAME: (%[[ARG0:.*]]: memref<64x32xf32>, %[[ARG1:.*]]: memref<32x64xf32>) {
+  gpu.func @transpose_f32(%A: memref<64x32xf32>, %B: memref<32x64xf32>) {
+    %c0 = arith.constant 0 : index
+    // 32-bit transposed loads are fused regardless of the consumer of the transpose.
+    // CHECK: %[[CAST:.*]] = memref.reinterpret_cast %[[ARG0]] to offset: [0], sizes: [32, 64], strides: [1, 32]
+    // CHECK-SAME: memref<64x32xf32> to memref<32x64xf32, strided<[1, 32]>>
+    // CHECK-NEXT: %[[TILE:.*]] = xetile.init_tile %[[CAST]][%{{.*}}, %{{.*}}]
+    // CHECK-SAME: memref<32x64xf32, strided<[1, 32]>> -> !xetile.tile<16x32xf32, #xetile.tile_attr<order = [0, 1]>>
+    %a_tile = xetile.init_tile %A[%c0, %c0] : memref<64x32xf32> -> !xetile.tile<32x16xf32>
+    // CHECK-NEXT: %[[VALUE:.*]] = xetile.load_tile %[[TILE]] {{.*}} : !xetile.tile<16x32xf32, #xetile.tile_attr<order = [0, 1]>> -> vector<16x32xf32>
+    // CHECK-NOT: vector.transpose
+    %a_value = xetile.load_tile %a_tile : !xetile.tile<32x16xf32> -> vector<32x16xf32>
+    %a_trans = vector.transpose %a_value, [1, 0] : vector<32x16xf32> to vector<16x32xf32>
+    // CHECK: %[[BTILE:.*]] = xetile.init_tile %[[ARG1]]
+    %b_tile = xetile.init_tile %B[%c0, %c0] : memref<32x64xf32> -> !xetile.tile<16x32xf32>
+    // CHECK: xetile.store_tile %[[VALUE]], %[[BTILE]]
+    xetile.store_tile %a_trans, %b_tile : vector<16x32xf32>, !xetile.tile<16x32xf32>
+    gpu.return
+  }
+}
+
+// -----
+gpu.module @mod4 {
+  // CHECK-LABEL: gpu.func @transpose_f16_no_mma
+  // CHECK-SAME: (%[[ARG0:.*]]: memref<64x32xf16>, %[[ARG1:.*]]: memref<32x64xf16>) {
+  gpu.func @transpose_f16_no_mma(%A: memref<64x32xf16>, %B: memref<32x64xf16>) {
+    %c0 = arith.constant 0 : index
+    // 16-bit transposed loads are only fused for the B operand of tile_mma.
+    // CHECK-NOT: memref.reinterpret_cast
+    // CHECK: %[[TILE:.*]] = xetile.init_tile %[[ARG0]]
+    // CHECK-SAME: memref<64x32xf16> -> !xetile.tile<32x16xf16>
+    %a_tile = xetile.init_tile %A[%c0, %c0] : memref<64x32xf16> -> !xetile.tile<32x16xf16>
+    // CHECK: %[[VALUE:.*]] = xetile.load_tile %[[TILE]]
+    // CHECK: vector.transpose %[[VALUE]], [1, 0] : vector<32x16xf16> to vector<16x32xf16>
+    %a_value = xetile.load_tile %a_tile : !xetile.tile<32x16xf16> -> vector<32x16xf16>
+    %a_trans = vector.transpose %a_value, [1, 0] : vector<32x16xf16> to vector<16x32xf16>
+    %b_tile = xetile.init_tile %B[%c0, %c0] : memref<32x64xf16> -> !xetile.tile<16x32xf16>
+    xetile.store_tile %a_trans, %b_tile : vector<16x32xf16>, !xetile.tile<16x32xf16>
+    gpu.return
+  }
+}
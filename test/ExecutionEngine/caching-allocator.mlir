@@ -0,0 +1,23 @@
+// RUN: imex-runtime-check allocator | FileCheck %s
+
+// Checks the caching allocator of the GPU runtimes on host memory.
+
+// Steady state loops do not reach the backend after the first iteration.
+// CHECK: first iteration: 3 backend allocs
+// CHECK-NEXT: steady state: 3 backend allocs, 0 backend frees
+
+// A freed block is only handed out again once its fence completes.
+// CHECK-NEXT: fence pending: new block
+// CHECK-NEXT: fence complete: reused
+// CHECK-NEXT: other kind: new block
+
+// The cached blocks are released on destruction.
+// CHECK-NEXT: before destruction: 6 blocks outstanding
+// CHECK-NEXT: after destruction: 0 blocks outstanding
+
+// Trimming releases blocks that are not reused for a whole interval, however
+// the sizes of a steady state loop alternate, and waits for their fences.
+// CHECK-NEXT: alternating sizes: 3 backend allocs, 1 backend frees
+// CHECK-NEXT: trim, fence pending: 1 blocks outstanding
+// CHECK-NEXT: trim, fence complete: 0 blocks outstanding
+// CHECK-NEXT: foreign block: waited for fence 7
@@ -0,0 +1,24 @@
+// RUN: rm -rf %t
+// RUN: env IMEX_KERNEL_CACHE_DIR=%t imex-runtime-check binary-cache | FileCheck %s
+
+// Checks the on-disk kernel binary cache of the GPU runtimes.
+
+// CHECK: key: {{[0-9a-f]{16}-[0-9a-f]{16}-8$}}
+// CHECK-NEXT: same inputs: same key
+// CHECK-NEXT: empty cache: miss
+// CHECK-NEXT: stored: hit
+
+// Changing any component of the key is a miss.
+// CHECK-NEXT: other spirv: miss
+// CHECK-NEXT: other flags: miss
+// CHECK-NEXT: other device: miss
+// CHECK-NEXT: other spec constants: miss
+
+// The entry is the binary behind a 24 byte header, a damaged entry is a miss.
+// CHECK-NEXT: entry: 30 bytes
+// CHECK-NEXT: truncated: miss
+// CHECK-NEXT: corrupt: miss
+// CHECK-NEXT: no header: miss
+// CHECK-NEXT: empty file: miss
+// CHECK-NEXT: stored again: hit
+// CHECK-NEXT: removed: miss
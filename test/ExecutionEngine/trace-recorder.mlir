@@ -0,0 +1,24 @@
+// RUN: env IMEX_TRACE_FILE=%t.json IMEX_TRACE_HOST_TIMER=1 imex-runtime-check trace | FileCheck %s
+// RUN: FileCheck %s --check-prefix=TRACE < %t.json
+
+// Checks the Chrome trace written by the trace recorder of the GPU runtimes
+// with the host timer, which does not need a device.
+
+// CHECK: host timer: on
+// CHECK-NEXT: module: pid 1, tid 1
+// CHECK-NEXT: alloc: pid 1, tid 1
+// CHECK-NEXT: free: pid 1, tid 1
+// CHECK-NEXT: kernel: pid 2, tid 1
+// CHECK-NEXT: alloc in module: yes
+// CHECK-NEXT: free in module: yes
+// CHECK-NEXT: kernel in module: yes
+// CHECK-NEXT: alloc before free: yes
+
+// TRACE: {"displayTimeUnit":"ns","traceEvents":[
+// TRACE-NEXT: {"ph":"M","name":"process_name","pid":1,"args":{"name":"host"}},
+// TRACE-NEXT: {"ph":"M","name":"process_name","pid":2,"args":{"name":"device"}},
+// TRACE-NEXT: {"ph":"X","cat":"module","name":"module \"load\"","pid":1,"tid":1,"ts":0.000,"dur":{{[0-9]+\.[0-9]+}},"args":{"bytes":64}},
+// TRACE-NEXT: {"ph":"X","cat":"alloc","name":"alloc device","pid":1,"tid":1,"ts":{{[0-9]+\.[0-9]+}},"dur":{{[0-9]+\.[0-9]+}},"args":{}},
+// TRACE-NEXT: {"ph":"X","cat":"free","name":"free","pid":1,"tid":1,"ts":{{[0-9]+\.[0-9]+}},"dur":{{[0-9]+\.[0-9]+}},"args":{}},
+// TRACE-NEXT: {"ph":"X","cat":"kernel","name":"kernel","pid":2,"tid":1,"ts":{{[0-9]+\.[0-9]+}},"dur":{{[0-9]+\.[0-9]+}},"args":{}}
+// TRACE-NEXT: ]}
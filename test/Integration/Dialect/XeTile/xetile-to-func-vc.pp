@@ -6,7 +6,7 @@ builtin.module(
         convert-xetile-to-xegpu
         imex-propagate-packed-layout)
     cse
-    imex-vector-linearize
+    imex-vector-linearize{contiguous-slices=true}
     gpu.module(convert-xegpu-to-vc)
     reconcile-unrealized-casts
     bf16-to-gpu
@@ -0,0 +1,27 @@
+// RUN: %python_executable %imex_runner -i %s --pass-pipeline-file=%p/bf16-to-gpu.pp \
+// RUN:                                       --no-mlir-runner --filecheck
+
+// Dynamically shaped views of a bf16 alloc are replicated on the i16 view.
+module @subview attributes {gpu.container_module} {
+  func.func @test(%arg0: index, %arg1: index) {
+    %c1 = arith.constant 1 : index
+    // CHECK: %[[ALLOC:.*]] = gpu.alloc  host_shared (%{{.*}}) : memref<?xi8>
+    // CHECK: %[[I16:.*]] = memref.view %[[ALLOC]][%{{.*}}][%arg0, %arg1] : memref<?xi8> to memref<?x?xi16>
+    // CHECK: %[[SUB:.*]] = memref.subview %[[I16]][1, 0] [%arg0, %arg1] [1, 1] : memref<?x?xi16> to memref<?x?xi16, strided<[?, 1], offset: ?>>
+    // CHECK: args(%[[SUB]] : memref<?x?xi16, strided<[?, 1], offset: ?>>)
+    %memref = gpu.alloc  host_shared (%arg0, %arg1) : memref<?x?xbf16>
+    %view = memref.subview %memref[1, 0] [%arg0, %arg1] [1, 1] : memref<?x?xbf16> to memref<?x?xbf16, strided<[?, 1], offset: ?>>
+    gpu.launch_func  @test_kernel::@test_kernel blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1) args(%view : memref<?x?xbf16, strided<[?, 1], offset: ?>>)
+    gpu.dealloc  %memref : memref<?x?xbf16>
+    return
+  }
+  gpu.module @test_kernel {
+    // CHECK: gpu.func @test_kernel(%arg0: memref<?x?xi16, strided<[?, 1], offset: ?>>)
+    gpu.func @test_kernel(%arg0: memref<?x?xbf16, strided<[?, 1], offset: ?>>) kernel {
+      %0 = gpu.block_id  x
+      %cst = arith.constant 1.000000e+00 : bf16
+      memref.store %cst, %arg0[%0, %0] : memref<?x?xbf16, strided<[?, 1], offset: ?>>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,61 @@
+// RUN: %python_executable %imex_runner -i %s --pass-pipeline-file=%p/bf16-to-gpu.pp \
+// RUN:                                       --no-mlir-runner --filecheck
+
+module @silu attributes {gpu.container_module} {
+  func.func @test(%arg0: memref<?x?xbf16>) -> memref<?x?xbf16> {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %d0 = memref.dim %arg0, %c0 : memref<?x?xbf16>
+    %d1 = memref.dim %arg0, %c1 : memref<?x?xbf16>
+    // CHECK: %[[MEMREF:.*]] = gpu.alloc  host_shared (%{{.*}}) : memref<?xi8>
+    // CHECK: %[[VIEW:.*]] = memref.view %[[MEMREF]][%[[CONST0:.*]]][%[[D0:.*]], %[[D1:.*]]] : memref<?xi8> to memref<?x?xbf16>
+    // CHECK: %[[VIEW_0:.*]] = memref.view %[[MEMREF]][%[[CONST0]]][%[[D0]], %[[D1]]] : memref<?xi8> to memref<?x?xi16>
+    // CHECK: memref.copy %arg0, %[[VIEW]] : memref<?x?xbf16> to memref<?x?xbf16>
+    %memref = gpu.alloc  host_shared (%d0, %d1) : memref<?x?xbf16>
+    memref.copy %arg0, %memref : memref<?x?xbf16> to memref<?x?xbf16>
+    // CHECK: %[[MEMREF_1:.*]] = gpu.alloc  host_shared (%{{.*}}) : memref<?xi8>
+    // CHECK: %[[VIEW_2:.*]] = memref.view %[[MEMREF_1]][%[[CONST0]]][%[[D0]], %[[D1]]] : memref<?xi8> to memref<?x?xbf16>
+    // CHECK: %[[VIEW_3:.*]] = memref.view %[[MEMREF_1]][%[[CONST0]]][%[[D0]], %[[D1]]] : memref<?xi8> to memref<?x?xi16>
+    %memref_0 = gpu.alloc  host_shared (%d0, %d1) : memref<?x?xbf16>
+    // CHECK: args(%[[VIEW_0]] : memref<?x?xi16>, %[[VIEW_3]] : memref<?x?xi16>)
+    gpu.launch_func  @test_kernel::@test_kernel blocks in (%d0, %d1, %c1) threads in (%c1, %c1, %c1) args(%memref : memref<?x?xbf16>, %memref_0 : memref<?x?xbf16>)
+    // CHECK: gpu.dealloc  %[[MEMREF]] : memref<?xi8>
+    // CHECK: return %[[VIEW_2]] : memref<?x?xbf16>
+    gpu.dealloc  %memref : memref<?x?xbf16>
+    return %memref_0 : memref<?x?xbf16>
+  }
+  gpu.module @test_kernel attributes {spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Float16Buffer, Int64, Int16, Int8, Kernel, Linkage, Vector16, GenericPointer, Groups, Float16, Float64, AtomicFloat32AddEXT, ExpectAssumeKHR], [SPV_EXT_shader_atomic_float_add, SPV_KHR_expect_assume]>, api=OpenCL, #spirv.resource_limits<>>} {
+    // CHECK: gpu.func @test_kernel(%arg0: memref<?x?xi16>, %arg1: memref<?x?xi16>)
+    gpu.func @test_kernel(%arg0: memref<?x?xbf16>, %arg1: memref<?x?xbf16>) kernel attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = gpu.block_id  x
+      %1 = gpu.block_id  y
+      %cst = arith.constant 1.000000e+00 : bf16
+      // Each op extends its operands and rounds its result to bf16.
+      // CHECK: %[[VAR2:.*]] = memref.load %arg0[%[[VAR0:.*]], %[[VAR1:.*]]] : memref<?x?xi16>
+      // CHECK: %[[VAR3:.*]] = arith.bitcast %[[VAR2]] : i16 to bf16
+      // CHECK: %[[VAR4:.*]] = arith.extf %[[VAR3]] : bf16 to f32
+      // CHECK: %[[VAR5:.*]] = arith.negf %[[VAR4]] : f32
+      // CHECK: %[[VAR6:.*]] = arith.truncf %[[VAR5]] : f32 to bf16
+      // CHECK: %[[VAR7:.*]] = arith.extf %[[VAR6]] : bf16 to f32
+      // CHECK: %[[VAR8:.*]] = math.exp %[[VAR7]] : f32
+      // CHECK: %[[VAR9:.*]] = arith.truncf %[[VAR8]] : f32 to bf16
+      // CHECK: %[[VAR10:.*]] = arith.extf %[[VAR9]] : bf16 to f32
+      // CHECK: %[[VAR11:.*]] = arith.addf %[[VAR10]], %{{.*}} : f32
+      // CHECK: %[[VAR12:.*]] = arith.truncf %[[VAR11]] : f32 to bf16
+      // CHECK: %[[VAR13:.*]] = arith.bitcast %[[VAR2]] : i16 to bf16
+      // CHECK: %[[VAR14:.*]] = arith.extf %[[VAR13]] : bf16 to f32
+      // CHECK: %[[VAR15:.*]] = arith.extf %[[VAR12]] : bf16 to f32
+      // CHECK: %[[VAR16:.*]] = arith.divf %[[VAR14]], %[[VAR15]] : f32
+      // CHECK: %[[VAR17:.*]] = arith.truncf %[[VAR16]] : f32 to bf16
+      // CHECK: %[[VAR18:.*]] = arith.bitcast %[[VAR17]] : bf16 to i16
+      // CHECK: memref.store %[[VAR18]], %arg1[%[[VAR0]], %[[VAR1]]] : memref<?x?xi16>
+      %2 = memref.load %arg0[%0, %1] : memref<?x?xbf16>
+      %3 = arith.negf %2 : bf16
+      %4 = math.exp %3 : bf16
+      %5 = arith.addf %4, %cst : bf16
+      %6 = arith.divf %2, %5 : bf16
+      memref.store %6, %arg1[%0, %1] : memref<?x?xbf16>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,32 @@
+// RUN: %python_executable %imex_runner -i %s --pass-pipeline-file=%p/bf16-to-gpu-f32-chains.pp \
+// RUN:                                       --no-mlir-runner --filecheck
+
+// With keep-f32-chains, intermediate results are not rounded to bf16: the
+// loaded value is extended once and the whole chain is computed in f32.
+module @silu attributes {gpu.container_module} {
+  gpu.module @test_kernel {
+    // CHECK: gpu.func @test_kernel(%arg0: memref<4x4xi16>, %arg1: memref<4x4xi16>)
+    gpu.func @test_kernel(%arg0: memref<4x4xbf16>, %arg1: memref<4x4xbf16>) kernel {
+      %0 = gpu.block_id  x
+      %1 = gpu.block_id  y
+      %cst = arith.constant 1.000000e+00 : bf16
+      // CHECK: %[[VAR2:.*]] = memref.load %arg0[%[[VAR0:.*]], %[[VAR1:.*]]] : memref<4x4xi16>
+      // CHECK-NEXT: %[[VAR3:.*]] = arith.bitcast %[[VAR2]] : i16 to bf16
+      // CHECK-NEXT: %[[VAR4:.*]] = arith.extf %[[VAR3]] : bf16 to f32
+      // CHECK-NEXT: %[[VAR5:.*]] = arith.negf %[[VAR4]] : f32
+      // CHECK-NEXT: %[[VAR6:.*]] = math.exp %[[VAR5]] : f32
+      // CHECK-NEXT: %[[VAR7:.*]] = arith.addf %[[VAR6]], %{{.*}} : f32
+      // CHECK-NEXT: %[[VAR8:.*]] = arith.divf %[[VAR4]], %[[VAR7]] : f32
+      // CHECK-NEXT: %[[VAR9:.*]] = arith.truncf %[[VAR8]] : f32 to bf16
+      // CHECK-NEXT: %[[VAR10:.*]] = arith.bitcast %[[VAR9]] : bf16 to i16
+      // CHECK-NEXT: memref.store %[[VAR10]], %arg1[%[[VAR0]], %[[VAR1]]] : memref<4x4xi16>
+      %2 = memref.load %arg0[%0, %1] : memref<4x4xbf16>
+      %3 = arith.negf %2 : bf16
+      %4 = math.exp %3 : bf16
+      %5 = arith.addf %4, %cst : bf16
+      %6 = arith.divf %2, %5 : bf16
+      memref.store %6, %arg1[%0, %1] : memref<4x4xbf16>
+      gpu.return
+    }
+  }
+}
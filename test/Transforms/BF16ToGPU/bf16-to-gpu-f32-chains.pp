@@ -0,0 +1,3 @@
+builtin.module(bf16-to-gpu{keep-f32-chains=true}
+    canonicalize
+    )
@@ -0,0 +1,60 @@
+// RUN: imex-opt --insert-gpu-allocs='client-api=opencl device-local-outputs=true' %s | FileCheck %s
+
+// Inputs only read by the device are uploaded into host_shared memory, the
+// ones written by the device live in device-local memory. Each buffer is
+// transferred at most once in each direction.
+func.func @transfers(%arg0: memref<8xf32>, %arg1: memref<8xf32>, %arg2: memref<8xf32>) {
+  // CHECK-LABEL: func.func @transfers
+  // CHECK-SAME: (%[[A0:.*]]: memref<8xf32>, %[[A1:.*]]: memref<8xf32>, %[[A2:.*]]: memref<8xf32>)
+  // CHECK: %[[G2:.*]] = gpu.alloc () : memref<8xf32>
+  // CHECK-NOT: gpu.memcpy
+  // CHECK: %[[G1:.*]] = gpu.alloc () : memref<8xf32>
+  // CHECK-NEXT: gpu.memcpy %[[G1]], %[[A1]] : memref<8xf32>, memref<8xf32>
+  // CHECK: %[[G0:.*]] = gpu.alloc host_shared () : memref<8xf32>
+  // CHECK-NEXT: memref.copy %[[A0]], %[[G0]] : memref<8xf32> to memref<8xf32>
+  // CHECK: gpu.launch
+  // CHECK: memref.load %[[G0]]
+  // CHECK: memref.load %[[G1]]
+  // CHECK: memref.store %{{.*}}, %[[G1]]
+  // CHECK: memref.store %{{.*}}, %[[G2]]
+  // CHECK: gpu.dealloc %[[G0]] : memref<8xf32>
+  // CHECK-NEXT: gpu.memcpy %[[A1]], %[[G1]] : memref<8xf32>, memref<8xf32>
+  // CHECK-NEXT: gpu.dealloc %[[G1]] : memref<8xf32>
+  // CHECK-NEXT: gpu.memcpy %[[A2]], %[[G2]] : memref<8xf32>, memref<8xf32>
+  // CHECK-NEXT: gpu.dealloc %[[G2]] : memref<8xf32>
+  // CHECK-NEXT: return
+  %c1 = arith.constant 1 : index
+  %c8 = arith.constant 8 : index
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %c8, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %c1, %sy = %c1, %sz = %c1) {
+    %0 = memref.load %arg0[%bx] : memref<8xf32>
+    %1 = memref.load %arg1[%bx] : memref<8xf32>
+    %2 = arith.addf %0, %1 : f32
+    memref.store %2, %arg1[%bx] : memref<8xf32>
+    memref.store %2, %arg2[%bx] : memref<8xf32>
+    gpu.terminator
+  } {SCFToGPU_visited}
+  return
+}
+
+// A buffer also accessed by the host stays host_shared.
+func.func @host_access(%arg0: memref<8xf32>) -> f32 {
+  // CHECK-LABEL: func.func @host_access
+  // CHECK-SAME: (%[[A0:.*]]: memref<8xf32>)
+  // CHECK: %[[G0:.*]] = gpu.alloc host_shared () : memref<8xf32>
+  // CHECK-NOT: memref.copy
+  // CHECK: gpu.launch
+  // CHECK: memref.load %[[G0]]
+  // CHECK: memref.copy %[[G0]], %[[A0]] : memref<8xf32> to memref<8xf32>
+  // CHECK-NOT: gpu.memcpy
+  // CHECK: return
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c8 = arith.constant 8 : index
+  %cst = arith.constant 1.0 : f32
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %c8, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %c1, %sy = %c1, %sz = %c1) {
+    memref.store %cst, %arg0[%bx] : memref<8xf32>
+    gpu.terminator
+  } {SCFToGPU_visited}
+  %0 = memref.load %arg0[%c0] : memref<8xf32>
+  return %0 : f32
+}
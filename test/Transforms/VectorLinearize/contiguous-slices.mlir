@@ -0,0 +1,92 @@
+// RUN: imex-opt %s -split-input-file -imex-vector-linearize="contiguous-slices=true" | FileCheck %s
+
+// CHECK-LABEL: test_extract_strided_slice_strided
+//  CHECK-SAME: (%[[ORIG_ARG:.*]]: vector<8x16xf32>) -> vector<8x8xf32>
+//       CHECK: %[[ARG:.*]] = vector.shape_cast %[[ORIG_ARG]] : vector<8x16xf32> to vector<128xf32>
+//       CHECK: %[[SHUFFLE:.*]] = vector.shuffle %[[ARG]], %[[ARG]]
+//       CHECK: [8, 9, 10, 11, 12, 13, 14, 15,
+//       CHECK: 120, 121, 122, 123, 124, 125, 126, 127] : vector<128xf32>, vector<128xf32>
+//       CHECK: %[[RES:.*]] = vector.shape_cast %[[SHUFFLE]] : vector<64xf32> to vector<8x8xf32>
+//       CHECK: return %[[RES]] : vector<8x8xf32>
+func.func @test_extract_strided_slice_strided(%arg0 : vector<8x16xf32>) -> vector<8x8xf32> {
+  %0 = vector.extract_strided_slice %arg0 { sizes = [8, 8], strides = [1, 1], offsets = [0, 8]}
+     : vector<8x16xf32> to vector<8x8xf32>
+  return %0 : vector<8x8xf32>
+}
+
+// -----
+// CHECK-LABEL: test_extract_strided_slice_contiguous
+//  CHECK-SAME: (%[[ORIG_ARG:.*]]: vector<2x32x8xf32>) -> vector<1x8x8xf32>
+//       CHECK: %[[ARG:.*]] = vector.shape_cast %[[ORIG_ARG]] : vector<2x32x8xf32> to vector<512xf32>
+//   CHECK-NOT: vector.shuffle
+//       CHECK: %[[SLICE:.*]] = vector.extract_strided_slice %[[ARG]] {offsets = [448], sizes = [64], strides = [1]} : vector<512xf32> to vector<64xf32>
+//       CHECK: %[[RES:.*]] = vector.shape_cast %[[SLICE]] : vector<64xf32> to vector<1x8x8xf32>
+//       CHECK: return %[[RES]] : vector<1x8x8xf32>
+func.func @test_extract_strided_slice_contiguous(%arg0 : vector<2x32x8xf32>) -> vector<1x8x8xf32> {
+  %0 = vector.extract_strided_slice %arg0 { offsets = [1, 24], strides = [1, 1], sizes = [1, 8] }
+    : vector<2x32x8xf32> to vector<1x8x8xf32>
+  return %0 : vector<1x8x8xf32>
+}
+
+// -----
+// CHECK-LABEL: test_extract_strided_slice_rows
+//  CHECK-SAME: (%[[ORIG_ARG:.*]]: vector<32x64xf16>) -> vector<8x64xf16>
+//       CHECK: %[[ARG:.*]] = vector.shape_cast %[[ORIG_ARG]] : vector<32x64xf16> to vector<2048xf16>
+//       CHECK: %[[SLICE:.*]] = vector.extract_strided_slice %[[ARG]] {offsets = [1024], sizes = [512], strides = [1]} : vector<2048xf16> to vector<512xf16>
+//       CHECK: %[[RES:.*]] = vector.shape_cast %[[SLICE]] : vector<512xf16> to vector<8x64xf16>
+//       CHECK: return %[[RES]] : vector<8x64xf16>
+func.func @test_extract_strided_slice_rows(%arg0 : vector<32x64xf16>) -> vector<8x64xf16> {
+  %0 = vector.extract_strided_slice %arg0 { offsets = [16], strides = [1], sizes = [8] }
+    : vector<32x64xf16> to vector<8x64xf16>
+  return %0 : vector<8x64xf16>
+}
+
+// -----
+// CHECK-LABEL: test_vector_extract
+// CHECK-SAME: (%[[ORIG_ARG:.*]]: vector<2x8x4xf32>) -> vector<8x4xf32>
+// CHECK: %[[ARG:.*]] = vector.shape_cast %[[ORIG_ARG]] : vector<2x8x4xf32> to vector<64xf32>
+// CHECK: %[[SLICE:.*]] = vector.extract_strided_slice %[[ARG]] {offsets = [32], sizes = [32], strides = [1]} : vector<64xf32> to vector<32xf32>
+// CHECK: %[[RES:.*]] = vector.shape_cast %[[SLICE]] : vector<32xf32> to vector<8x4xf32>
+// CHECK: return %[[RES]] : vector<8x4xf32>
+func.func @test_vector_extract(%arg0: vector<2x8x4xf32>) -> vector<8x4xf32> {
+  %0 = vector.extract %arg0[1]: vector<8x4xf32> from vector<2x8x4xf32>
+  return %0 : vector<8x4xf32>
+}
+
+// -----
+// CHECK-LABEL: test_vector_extract_whole
+// CHECK-SAME: (%[[ORIG_ARG:.*]]: vector<1x8x4xf32>) -> vector<8x4xf32>
+// CHECK: %[[ARG:.*]] = vector.shape_cast %[[ORIG_ARG]] : vector<1x8x4xf32> to vector<32xf32>
+// CHECK-NOT: vector.extract_strided_slice
+// CHECK: %[[RES:.*]] = vector.shape_cast %[[ARG]] : vector<32xf32> to vector<8x4xf32>
+// CHECK: return %[[RES]] : vector<8x4xf32>
+func.func @test_vector_extract_whole(%arg0: vector<1x8x4xf32>) -> vector<8x4xf32> {
+  %0 = vector.extract %arg0[0]: vector<8x4xf32> from vector<1x8x4xf32>
+  return %0 : vector<8x4xf32>
+}
+
+// -----
+// CHECK-LABEL: test_vector_insert
+// CHECK-SAME: (%[[DEST:.*]]: vector<2x8x4xf32>, %[[SRC:.*]]: vector<8x4xf32>) -> vector<2x8x4xf32>
+// CHECK-DAG: %[[ARG_SRC:.*]] = vector.shape_cast %[[SRC]] : vector<8x4xf32> to vector<32xf32>
+// CHECK-DAG: %[[ARG_DEST:.*]] = vector.shape_cast %[[DEST]] : vector<2x8x4xf32> to vector<64xf32>
+// CHECK-NOT: vector.shuffle
+// CHECK: %[[INSERT:.*]] = vector.insert_strided_slice %[[ARG_SRC]], %[[ARG_DEST]] {offsets = [32], strides = [1]} : vector<32xf32> into vector<64xf32>
+// CHECK: %[[RES:.*]] = vector.shape_cast %[[INSERT]] : vector<64xf32> to vector<2x8x4xf32>
+// CHECK: return %[[RES]] : vector<2x8x4xf32>
+func.func @test_vector_insert(%arg0: vector<2x8x4xf32>, %arg1: vector<8x4xf32>) -> vector<2x8x4xf32> {
+  %0 = vector.insert %arg1, %arg0[1]: vector<8x4xf32> into vector<2x8x4xf32>
+  return %0 : vector<2x8x4xf32>
+}
+
+// -----
+// CHECK-LABEL: test_vector_insert_2d_idx
+// CHECK-SAME: (%[[DEST:.*]]: vector<2x8x4xf32>, %[[SRC:.*]]: vector<4xf32>) -> vector<2x8x4xf32>
+// CHECK: %[[ARG_DEST:.*]] = vector.shape_cast %[[DEST]] : vector<2x8x4xf32> to vector<64xf32>
+// CHECK: %[[INSERT:.*]] = vector.insert_strided_slice %[[SRC]], %[[ARG_DEST]] {offsets = [12], strides = [1]} : vector<4xf32> into vector<64xf32>
+// CHECK: %[[RES:.*]] = vector.shape_cast %[[INSERT]] : vector<64xf32> to vector<2x8x4xf32>
+// CHECK: return %[[RES]] : vector<2x8x4xf32>
+func.func @test_vector_insert_2d_idx(%arg0: vector<2x8x4xf32>, %arg1: vector<4xf32>) -> vector<2x8x4xf32> {
+  %0 = vector.insert %arg1, %arg0[0, 3]: vector<4xf32> into vector<2x8x4xf32>
+  return %0 : vector<2x8x4xf32>
+}
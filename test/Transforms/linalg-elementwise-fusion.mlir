@@ -0,0 +1,115 @@
+// RUN: imex-opt --split-input-file --imex-linalg-elementwise-fusion %s | FileCheck %s
+// RUN: imex-opt --split-input-file --imex-linalg-elementwise-fusion=allow-recompute=true %s | FileCheck %s --check-prefix=RECOMPUTE
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+
+// Loop fusion: the elementwise chain becomes a single linalg.generic.
+// CHECK-LABEL: func.func @loop_fusion
+// CHECK-SAME: (%[[ARG0:.*]]: tensor<512x1024xf32>, %[[ARG1:.*]]: tensor<512x1024xf32>)
+// CHECK: %[[RES:.*]] = linalg.generic
+// CHECK-DAG: math.log
+// CHECK-DAG: math.absf
+// CHECK: arith.addf
+// CHECK: arith.subf
+// CHECK-NOT: linalg.generic
+// CHECK: return %[[RES]]
+func.func @loop_fusion(%arg0: tensor<512x1024xf32>, %arg1: tensor<512x1024xf32>) -> tensor<512x1024xf32> {
+  %0 = tensor.empty() : tensor<512x1024xf32>
+  %1 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel", "parallel"]} ins(%arg0 : tensor<512x1024xf32>) outs(%0 : tensor<512x1024xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %8 = math.log %in : f32
+    linalg.yield %8 : f32
+  } -> tensor<512x1024xf32>
+  %2 = tensor.empty() : tensor<512x1024xf32>
+  %3 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel", "parallel"]} ins(%arg1 : tensor<512x1024xf32>) outs(%2 : tensor<512x1024xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %8 = math.absf %in : f32
+    linalg.yield %8 : f32
+  } -> tensor<512x1024xf32>
+  %4 = tensor.empty() : tensor<512x1024xf32>
+  %5 = linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel", "parallel"]} ins(%1, %3 : tensor<512x1024xf32>, tensor<512x1024xf32>) outs(%4 : tensor<512x1024xf32>) {
+  ^bb0(%in: f32, %in_4: f32, %out: f32):
+    %8 = arith.addf %in, %in_4 : f32
+    linalg.yield %8 : f32
+  } -> tensor<512x1024xf32>
+  %6 = tensor.empty() : tensor<512x1024xf32>
+  %7 = linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel", "parallel"]} ins(%5, %arg0 : tensor<512x1024xf32>, tensor<512x1024xf32>) outs(%6 : tensor<512x1024xf32>) {
+  ^bb0(%in: f32, %in_4: f32, %out: f32):
+    %8 = arith.subf %in, %in_4 : f32
+    linalg.yield %8 : f32
+  } -> tensor<512x1024xf32>
+  return %7 : tensor<512x1024xf32>
+}
+
+// -----
+
+#map1 = affine_map<(d0, d1) -> (d0, d1)>
+#map2 = affine_map<(d0, d1) -> (d1, d0)>
+#map3 = affine_map<(d0, d1) -> (d0)>
+
+// Input fusion: the elementwise producer is computed inside the reduction.
+// CHECK-LABEL: func.func @input_fusion
+// CHECK-SAME: (%[[ARG0:.*]]: tensor<512x1024xf32>)
+// CHECK: %[[FILL:.*]] = linalg.fill
+// CHECK: %[[RES:.*]] = linalg.generic
+// CHECK-SAME: iterator_types = ["parallel", "reduction"]
+// CHECK-SAME: ins(%[[ARG0]] : tensor<512x1024xf32>) outs(%[[FILL]] : tensor<1024xf32>)
+// CHECK: math.absf
+// CHECK: arith.addf
+// CHECK-NOT: linalg.generic
+// CHECK: return %[[RES]]
+func.func @input_fusion(%arg0: tensor<512x1024xf32>) -> tensor<1024xf32> {
+  %0 = tensor.empty() : tensor<512x1024xf32>
+  %1 = linalg.generic {indexing_maps = [#map1, #map1], iterator_types = ["parallel", "parallel"]} ins(%arg0 : tensor<512x1024xf32>) outs(%0 : tensor<512x1024xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %5 = math.absf %in : f32
+    linalg.yield %5 : f32
+  } -> tensor<512x1024xf32>
+  %cst = arith.constant 0.000000e+00 : f32
+  %2 = tensor.empty() : tensor<1024xf32>
+  %3 = linalg.fill ins(%cst : f32) outs(%2 : tensor<1024xf32>) -> tensor<1024xf32>
+  %4 = linalg.generic {indexing_maps = [#map2, #map3], iterator_types = ["parallel", "reduction"]} ins(%1 : tensor<512x1024xf32>) outs(%3 : tensor<1024xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %5 = arith.addf %out, %in : f32
+    linalg.yield %5 : f32
+  } -> tensor<1024xf32>
+  return %4 : tensor<1024xf32>
+}
+
+// -----
+
+#map4 = affine_map<(d0) -> (d0)>
+
+// A producer with multiple uses is only fused when recomputation is allowed.
+// CHECK-LABEL: func.func @multi_use
+// CHECK: math.exp
+// CHECK: linalg.generic
+// CHECK: arith.addf
+// CHECK: linalg.generic
+// CHECK: arith.mulf
+// RECOMPUTE-LABEL: func.func @multi_use
+// RECOMPUTE: linalg.generic
+// RECOMPUTE: math.exp
+// RECOMPUTE: arith.addf
+// RECOMPUTE: linalg.generic
+// RECOMPUTE: math.exp
+// RECOMPUTE: arith.mulf
+func.func @multi_use(%arg0: tensor<64xf32>) -> (tensor<64xf32>, tensor<64xf32>) {
+  %0 = tensor.empty() : tensor<64xf32>
+  %1 = linalg.generic {indexing_maps = [#map4, #map4], iterator_types = ["parallel"]} ins(%arg0 : tensor<64xf32>) outs(%0 : tensor<64xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %4 = math.exp %in : f32
+    linalg.yield %4 : f32
+  } -> tensor<64xf32>
+  %2 = linalg.generic {indexing_maps = [#map4, #map4], iterator_types = ["parallel"]} ins(%1 : tensor<64xf32>) outs(%0 : tensor<64xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %4 = arith.addf %in, %in : f32
+    linalg.yield %4 : f32
+  } -> tensor<64xf32>
+  %3 = linalg.generic {indexing_maps = [#map4, #map4], iterator_types = ["parallel"]} ins(%1 : tensor<64xf32>) outs(%0 : tensor<64xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %4 = arith.mulf %in, %in : f32
+    linalg.yield %4 : f32
+  } -> tensor<64xf32>
+  return %2, %3 : tensor<64xf32>, tensor<64xf32>
+}
@@ -1,4 +1,6 @@
 // RUN: imex-opt -imex-lower-memref-copy -allow-unregistered-dialect %s | FileCheck %s
+// RUN: imex-opt -imex-lower-memref-copy="bulk-copies=true" -allow-unregistered-dialect %s | FileCheck %s --check-prefix=BULK
+// RUN: imex-opt -imex-lower-memref-copy="bulk-copies=true vector-width=4" -allow-unregistered-dialect %s | FileCheck %s --check-prefix=VEC
 #map = affine_map<(d0, d1) -> (d0, d1)>
 module {
   func.func @copy_with_later_use(%arg0: memref<10x20xf32>) -> memref<10x20xf32> {
@@ -36,4 +38,94 @@ module {
     }
     return %alloc_1 : memref<10x20xf32>
   }
+  func.func @copy_strided() -> memref<10x40xf32> {
+    %alloc = memref.alloc() {alignment = 128 : i64} : memref<10x20xf32>
+    "some_use" (%alloc) {} : (memref<10x20xf32>) -> ()
+    %alloc_0 = memref.alloc() {alignment = 128 : i64} : memref<10x40xf32>
+    %subview = memref.subview %alloc_0[0, 0] [10, 20] [1, 1] : memref<10x40xf32> to memref<10x20xf32, strided<[40, 1]>>
+    memref.copy %alloc, %subview : memref<10x20xf32> to memref<10x20xf32, strided<[40, 1]>>
+    // CHECK-LABEL: func @copy_strided
+    // CHECK:       memref.copy
+    // BULK-LABEL: func @copy_strided
+    // BULK-NOT:   memref.collapse_shape
+    // BULK:       linalg.generic {{.*}} iterator_types = ["parallel", "parallel"]}
+    // BULK-SAME:  ins(%{{.*}} : memref<10x20xf32>) outs(%{{.*}} : memref<10x20xf32, strided<[40, 1]>>)
+    // BULK-NOT:   memref.copy
+    return %alloc_0 : memref<10x40xf32>
+  }
+  func.func @copy_in_loop(%n: index) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %alloc = memref.alloc() {alignment = 128 : i64} : memref<4x8xf32>
+    %alloc_0 = memref.alloc() {alignment = 128 : i64} : memref<4x8xf32>
+    scf.for %i = %c0 to %n step %c1 {
+      "some_use" (%alloc) {} : (memref<4x8xf32>) -> ()
+      memref.copy %alloc, %alloc_0 : memref<4x8xf32> to memref<4x8xf32>
+      "some_use" (%alloc_0) {} : (memref<4x8xf32>) -> ()
+    }
+    // Copies nested in regions are only lowered with bulk-copies.
+    // CHECK-LABEL: func @copy_in_loop
+    // CHECK:       scf.for
+    // CHECK:       memref.copy
+    // BULK-LABEL: func @copy_in_loop
+    // BULK:       scf.for
+    // BULK:       %[[SRC:.*]] = memref.collapse_shape %{{.*}} {{\[\[}}0, 1]] : memref<4x8xf32> into memref<32xf32>
+    // BULK-NEXT:  %[[DST:.*]] = memref.collapse_shape %{{.*}} {{\[\[}}0, 1]] : memref<4x8xf32> into memref<32xf32>
+    // BULK-NEXT:  linalg.generic {{.*}} iterator_types = ["parallel"]} ins(%[[SRC]] : memref<32xf32>) outs(%[[DST]] : memref<32xf32>)
+    // BULK-NOT:   memref.copy
+    // VEC-LABEL:   func @copy_in_loop
+    // VEC:         %[[SRC:.*]] = memref.collapse_shape
+    // VEC-NEXT:    %[[DST:.*]] = memref.collapse_shape
+    // VEC:         scf.parallel (%[[I:.*]]) = (%{{.*}}) to (%{{.*}}) step (%{{.*}}) {
+    // VEC-NEXT:    %[[V:.*]] = vector.load %[[SRC]][%[[I]]] : memref<32xf32>, vector<4xf32>
+    // VEC-NEXT:    vector.store %[[V]], %[[DST]][%[[I]]] : memref<32xf32>, vector<4xf32>
+    // VEC-NOT:     memref.load
+    // VEC:         return
+    return
+  }
+  func.func @copy_remainder() {
+    %alloc = memref.alloc() {alignment = 128 : i64} : memref<3x6xi32>
+    "some_use" (%alloc) {} : (memref<3x6xi32>) -> ()
+    %alloc_0 = memref.alloc() {alignment = 128 : i64} : memref<3x6xi32>
+    memref.copy %alloc, %alloc_0 : memref<3x6xi32> to memref<3x6xi32>
+    "some_use" (%alloc) {} : (memref<3x6xi32>) -> ()
+    "some_use" (%alloc_0) {} : (memref<3x6xi32>) -> ()
+    // VEC-LABEL:   func @copy_remainder
+    // VEC-DAG:     %[[C16:.*]] = arith.constant 16 : index
+    // VEC-DAG:     %[[C18:.*]] = arith.constant 18 : index
+    // VEC:         scf.parallel (%{{.*}}) = (%{{.*}}) to (%[[C16]]) step (%{{.*}}) {
+    // VEC:         vector.store
+    // VEC:         scf.parallel (%[[J:.*]]) = (%[[C16]]) to (%[[C18]]) step (%{{.*}}) {
+    // VEC-NEXT:    %[[E:.*]] = memref.load %{{.*}}[%[[J]]] : memref<18xi32>
+    // VEC-NEXT:    memref.store %[[E]], %{{.*}}[%[[J]]] : memref<18xi32>
+    return
+  }
+  func.func @copy_gpu() {
+    %0 = gpu.alloc () : memref<16x16xf32>
+    "some_use" (%0) {} : (memref<16x16xf32>) -> ()
+    %alloc = memref.alloc() {alignment = 128 : i64} : memref<16x16xf32>
+    memref.copy %0, %alloc : memref<16x16xf32> to memref<16x16xf32>
+    "some_use" (%alloc) {} : (memref<16x16xf32>) -> ()
+    // CHECK-LABEL: func @copy_gpu
+    // CHECK:       memref.copy
+    // BULK-LABEL: func @copy_gpu
+    // BULK:       %[[SRC:.*]] = gpu.alloc
+    // BULK:       %[[DST:.*]] = memref.alloc
+    // BULK-NEXT:  gpu.memcpy {{.*}}%[[DST]], %[[SRC]] : memref<16x16xf32>, memref<16x16xf32>
+    // BULK-NOT:   memref.copy
+    return
+  }
+  func.func @copy_gpu_offset() {
+    %0 = gpu.alloc () : memref<32x16xf32>
+    "some_use" (%0) {} : (memref<32x16xf32>) -> ()
+    %subview = memref.subview %0[16, 0] [16, 16] [1, 1] : memref<32x16xf32> to memref<16x16xf32, strided<[16, 1], offset: 256>>
+    %alloc = memref.alloc() {alignment = 128 : i64} : memref<16x16xf32>
+    memref.copy %subview, %alloc : memref<16x16xf32, strided<[16, 1], offset: 256>> to memref<16x16xf32>
+    "some_use" (%alloc) {} : (memref<16x16xf32>) -> ()
+    // The device side has an offset, which gpu.memcpy cannot express.
+    // BULK-LABEL: func @copy_gpu_offset
+    // BULK-NOT:   gpu.memcpy
+    // BULK:       memref.copy %{{.*}}, %{{.*}} : memref<16x16xf32, strided<[16, 1], offset: 256>> to memref<16x16xf32>
+    return
+  }
 }
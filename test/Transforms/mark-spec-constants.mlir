@@ -0,0 +1,57 @@
+// RUN: imex-opt --split-input-file --imex-mark-spec-constants %s | FileCheck %s
+
+module attributes {gpu.container_module} {
+  func.func @main(%arg0: memref<?x?xf32>, %arg1: index, %arg2: i32) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c4 = arith.constant 4 : i32
+    %d0 = memref.dim %arg0, %c0 : memref<?x?xf32>
+    %d1 = memref.dim %arg0, %c1 : memref<?x?xf32>
+    %size = arith.muli %d0, %d1 : index
+    %tiles = arith.ceildivui %size, %arg1 : index
+    gpu.launch_func @kernels::@kernel blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%arg0 : memref<?x?xf32>, %d0 : index, %size : index, %tiles : index, %c4 : i32, %arg2 : i32)
+    gpu.launch_func @kernels::@kernel blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%arg0 : memref<?x?xf32>, %d1 : index, %arg1 : index, %tiles : index, %c4 : i32, %arg2 : i32)
+    return
+  }
+
+  gpu.module @kernels {
+    // Only the arguments computed from sizes and constants at every launch are
+    // marked, with ids after the ones already used in the module.
+    // CHECK-LABEL: gpu.func @kernel
+    // CHECK-SAME: %arg0: memref<?x?xf32>,
+    // CHECK-SAME: %arg1: index {gpux.spec_id = 6 : i32},
+    // CHECK-SAME: %arg2: index,
+    // CHECK-SAME: %arg3: index,
+    // CHECK-SAME: %arg4: i32 {gpux.spec_id = 7 : i32},
+    // CHECK-SAME: %arg5: i32)
+    gpu.func @kernel(%arg0: memref<?x?xf32>, %arg1: index, %arg2: index, %arg3: index, %arg4: i32, %arg5: i32) kernel {
+      gpu.return
+    }
+
+    // CHECK-LABEL: gpu.func @marked
+    // CHECK-SAME: %arg0: index {gpux.spec_id = 5 : i32})
+    gpu.func @marked(%arg0: index {gpux.spec_id = 5 : i32}) kernel {
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+// Kernels without launches and non-kernel functions are left alone.
+module attributes {gpu.container_module} {
+  gpu.module @kernels {
+    // CHECK-LABEL: gpu.func @unused
+    // CHECK-NOT: gpux.spec_id
+    gpu.func @unused(%arg0: index) kernel {
+      gpu.return
+    }
+    // CHECK-LABEL: gpu.func @helper
+    // CHECK-NOT: gpux.spec_id
+    gpu.func @helper(%arg0: index) {
+      gpu.return
+    }
+  }
+}
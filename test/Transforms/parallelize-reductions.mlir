@@ -0,0 +1,113 @@
+// RUN: imex-opt --split-input-file --imex-parallelize-reductions=parallelism=64 %s | FileCheck %s
+
+// CHECK-LABEL: func.func @full_reduction
+// CHECK-SAME: (%[[IN:.*]]: memref<512x1024xf32>, %[[OUT:.*]]: memref<f32>)
+func.func @full_reduction(%arg0: memref<512x1024xf32>, %arg1: memref<f32>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c512 = arith.constant 512 : index
+  %c1024 = arith.constant 1024 : index
+  // CHECK: %[[SPAN:.*]] = arith.muli
+  // CHECK: scf.parallel (%[[CHUNK:.*]]) = (%{{.*}}) to (%{{.*}}) step (%{{.*}}) {
+  // CHECK: %[[OFF:.*]] = arith.muli %[[CHUNK]], %[[SPAN]] : index
+  // CHECK: %[[BEGIN:.*]] = arith.addi %{{.*}}, %[[OFF]] : index
+  // CHECK: %[[END:.*]] = arith.minsi
+  // CHECK: %[[ZERO:.*]] = arith.constant 0.000000e+00 : f32
+  // CHECK: %[[PARTIAL:.*]] = scf.for %[[I:.*]] = %[[BEGIN]] to %[[END]] step %{{.*}} iter_args(%[[ACC0:.*]] = %[[ZERO]]) -> (f32) {
+  // CHECK: %[[INNER:.*]] = scf.for %[[J:.*]] = %{{.*}} to %{{.*}} step %{{.*}} iter_args(%[[ACC1:.*]] = %[[ACC0]]) -> (f32) {
+  // CHECK-NOT: memref.load %[[OUT]]
+  // CHECK: %[[V:.*]] = memref.load %[[IN]][%[[I]], %[[J]]] : memref<512x1024xf32>
+  // CHECK: %[[SUM:.*]] = arith.addf %[[ACC1]], %[[V]] : f32
+  // CHECK-NOT: memref.store
+  // CHECK: scf.yield %[[SUM]] : f32
+  // CHECK: scf.yield %[[INNER]] : f32
+  // CHECK: memref.atomic_rmw addf %[[PARTIAL]], %[[OUT]][] : (f32, memref<f32>) -> f32
+  scf.for %i = %c0 to %c512 step %c1 {
+    scf.for %j = %c0 to %c1024 step %c1 {
+      %0 = memref.load %arg0[%i, %j] : memref<512x1024xf32>
+      %1 = memref.load %arg1[] : memref<f32>
+      %2 = arith.addf %1, %0 : f32
+      memref.store %2, %arg1[] : memref<f32>
+    }
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func.func @max_reduction
+// CHECK-SAME: (%[[IN:.*]]: memref<?xi32>, %[[OUT:.*]]: memref<4xi32>, %[[N:.*]]: index)
+func.func @max_reduction(%arg0: memref<?xi32>, %arg1: memref<4xi32>, %n: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c2 = arith.constant 2 : index
+  // CHECK: scf.parallel
+  // CHECK: %[[PARTIAL:.*]] = scf.for {{.*}} -> (i32) {
+  // CHECK: arith.maxsi
+  // CHECK: memref.atomic_rmw maxs %[[PARTIAL]], %[[OUT]][%{{.*}}] : (i32, memref<4xi32>) -> i32
+  scf.for %i = %c0 to %n step %c1 {
+    %0 = memref.load %arg0[%i] : memref<?xi32>
+    %1 = memref.load %arg1[%c2] : memref<4xi32>
+    %2 = arith.maxsi %1, %0 : i32
+    memref.store %2, %arg1[%c2] : memref<4xi32>
+  }
+  return
+}
+
+// -----
+
+// The accumulator location depends on the loop, so this is not a reduction.
+// CHECK-LABEL: func.func @not_a_reduction
+// CHECK-NOT: scf.parallel
+// CHECK-NOT: memref.atomic_rmw
+func.func @not_a_reduction(%arg0: memref<512xf32>, %arg1: memref<512xf32>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c512 = arith.constant 512 : index
+  scf.for %i = %c0 to %c512 step %c1 {
+    %0 = memref.load %arg0[%i] : memref<512xf32>
+    %1 = memref.load %arg1[%i] : memref<512xf32>
+    %2 = arith.addf %1, %0 : f32
+    memref.store %2, %arg1[%i] : memref<512xf32>
+  }
+  return
+}
+
+// -----
+
+// f16 additions cannot be combined atomically.
+// CHECK-LABEL: func.func @f16_reduction
+// CHECK-NOT: scf.parallel
+func.func @f16_reduction(%arg0: memref<512xf16>, %arg1: memref<f16>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c512 = arith.constant 512 : index
+  scf.for %i = %c0 to %c512 step %c1 {
+    %0 = memref.load %arg0[%i] : memref<512xf16>
+    %1 = memref.load %arg1[] : memref<f16>
+    %2 = arith.addf %1, %0 : f16
+    memref.store %2, %arg1[] : memref<f16>
+  }
+  return
+}
+
+// -----
+
+// The accumulator is a view of a buffer also read by the loop, so the
+// partial results would race with the reads.
+// CHECK-LABEL: func.func @aliasing_subview
+// CHECK-NOT: scf.parallel
+// CHECK-NOT: memref.atomic_rmw
+func.func @aliasing_subview(%arg0: memref<512xf32>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c512 = arith.constant 512 : index
+  %sub = memref.subview %arg0[0] [1] [1] : memref<512xf32> to memref<1xf32, strided<[1]>>
+  scf.for %i = %c0 to %c512 step %c1 {
+    %0 = memref.load %arg0[%i] : memref<512xf32>
+    %1 = memref.load %sub[%c0] : memref<1xf32, strided<[1]>>
+    %2 = arith.addf %1, %0 : f32
+    memref.store %2, %sub[%c0] : memref<1xf32, strided<[1]>>
+  }
+  return
+}
@@ -0,0 +1,90 @@
+// RUN: imex-opt %s -split-input-file -imex-propagate-packed-layout -cse | FileCheck %s
+
+// Layout casts of the same value are merged by CSE, casts of loop invariant
+// values are hoisted and loop-carried values keep the packed layout.
+
+// CHECK-LABEL: @test
+//  CHECK-SAME: (%[[ARG1:.*]]: !xegpu.tensor_desc<8x16xf16>, %[[ARG2:.*]]: !xegpu.tensor_desc<16x16xf16>)
+//       CHECK:  %[[A:.*]] = xegpu.load_nd %[[ARG1]]  : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+//       CHECK:  %[[B:.*]] = xegpu.load_nd %[[ARG2]] : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+//       CHECK:  %[[B1:.*]] = vector.shape_cast %[[B]] : vector<16x16xf16> to vector<256xf16>
+//       CHECK:  %[[B2:.*]] = vector.shuffle %[[B1]], %[[B1]]
+//       CHECK:  %[[B3:.*]] = vector.shape_cast %[[B2]] : vector<256xf16> to vector<8x16x2xf16>
+//   CHECK-NOT:  vector.shuffle
+//       CHECK:  %[[RES1:.*]] = xegpu.dpas %[[A]], %[[B3]] : vector<8x16xf16>, vector<8x16x2xf16> -> vector<8x16xf32>
+//       CHECK:  %[[RES2:.*]] = xegpu.dpas %[[A]], %[[B3]] : vector<8x16xf16>, vector<8x16x2xf16> -> vector<8x16xf32>
+//       CHECK:  return %[[RES1]], %[[RES2]], %[[B]]
+
+func.func @test(%arg1 : !xegpu.tensor_desc<8x16xf16>, %arg2 : !xegpu.tensor_desc<16x16xf16>) -> (vector<8x16xf32>, vector<8x16xf32>, vector<16x16xf16>) {
+  %0 = xegpu.load_nd %arg1 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  %1 = xegpu.load_nd %arg2 : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+  %2 = xegpu.dpas %0, %1 : vector<8x16xf16>, vector<16x16xf16> -> vector<8x16xf32>
+  %3 = xegpu.dpas %0, %1 : vector<8x16xf16>, vector<16x16xf16> -> vector<8x16xf32>
+  return %2, %3, %1 : vector<8x16xf32>, vector<8x16xf32>, vector<16x16xf16>
+}
+
+// -----
+
+// CHECK-LABEL: @test
+//  CHECK-SAME: (%[[ARG1:.*]]: !xegpu.tensor_desc<8x16xf16>, %[[ARG2:.*]]: !xegpu.tensor_desc<16x16xf16>, %{{.*}}: index)
+//       CHECK:  %[[A:.*]] = xegpu.load_nd %[[ARG1]]  : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+//       CHECK:  %[[B:.*]] = xegpu.load_nd %[[ARG2]] : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+//       CHECK:  %[[B1:.*]] = vector.shape_cast %[[B]] : vector<16x16xf16> to vector<256xf16>
+//       CHECK:  %[[B2:.*]] = vector.shuffle %[[B1]], %[[B1]]
+//       CHECK:  %[[B3:.*]] = vector.shape_cast %[[B2]] : vector<256xf16> to vector<8x16x2xf16>
+//       CHECK:  %[[RES:.*]] = scf.for
+//   CHECK-NOT:  vector.shuffle
+//       CHECK:  %[[RES1:.*]] = xegpu.dpas %[[A]], %[[B3]] : vector<8x16xf16>, vector<8x16x2xf16> -> vector<8x16xf32>
+//       CHECK:  %[[RES2:.*]] = xegpu.dpas %[[A]], %[[B3]] : vector<8x16xf16>, vector<8x16x2xf16> -> vector<8x16xf32>
+//       CHECK:  scf.yield
+//       CHECK:  }
+//       CHECK:  return %[[RES]], %[[B]]
+
+func.func @test(%arg1 : !xegpu.tensor_desc<8x16xf16>, %arg2 : !xegpu.tensor_desc<16x16xf16>, %arg3 : index) -> (vector<8x16xf32>, vector<16x16xf16>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant dense<0.0> : vector<8x16xf32>
+  %0 = xegpu.load_nd %arg1 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  %1 = xegpu.load_nd %arg2 : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+  %2 = scf.for %i = %c0 to %arg3 step %c1 iter_args(%res = %cst) -> (vector<8x16xf32>) {
+    %3 = xegpu.dpas %0, %1 : vector<8x16xf16>, vector<16x16xf16> -> vector<8x16xf32>
+    %4 = xegpu.dpas %0, %1 : vector<8x16xf16>, vector<16x16xf16> -> vector<8x16xf32>
+    %5 = arith.addf %3, %4 : vector<8x16xf32>
+    %6 = arith.addf %res, %5 : vector<8x16xf32>
+    scf.yield %6 : vector<8x16xf32>
+  }
+  return %2, %1 : vector<8x16xf32>, vector<16x16xf16>
+}
+
+// -----
+
+// CHECK-LABEL: @test
+//  CHECK-SAME: (%[[ARG1:.*]]: !xegpu.tensor_desc<8x16xf16>, %[[ARG2:.*]]: !xegpu.tensor_desc<16x16xf16>, %{{.*}}: index)
+//       CHECK:  %[[A:.*]] = xegpu.load_nd %[[ARG1]]  : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+//       CHECK:  %[[B:.*]] = xegpu.load_nd %[[ARG2]] <{packed}> : !xegpu.tensor_desc<16x16xf16> -> vector<8x16x2xf16>
+//       CHECK:  %[[RES:.*]]:2 = scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}} iter_args(%[[ITER1:.*]] = %[[B]], %[[ITER2:.*]] = %{{.*}}) -> (vector<8x16x2xf16>, vector<8x16xf32>) {
+//   CHECK-NOT:  vector.shuffle
+//       CHECK:  %[[D:.*]] = xegpu.dpas %[[A]], %[[ITER1]] : vector<8x16xf16>, vector<8x16x2xf16> -> vector<8x16xf32>
+//       CHECK:  %[[SUM:.*]] = arith.addf %[[ITER2]], %[[D]] : vector<8x16xf32>
+//       CHECK:  %[[B1:.*]] = xegpu.load_nd %[[ARG2]] <{packed}> : !xegpu.tensor_desc<16x16xf16> -> vector<8x16x2xf16>
+//       CHECK:  scf.yield %[[B1]], %[[SUM]] : vector<8x16x2xf16>, vector<8x16xf32>
+//       CHECK:  }
+//       CHECK:  %[[C1:.*]] = vector.shape_cast %[[RES]]#0 : vector<8x16x2xf16> to vector<256xf16>
+//       CHECK:  %[[C2:.*]] = vector.shuffle %[[C1]], %[[C1]]
+//       CHECK:  %[[C3:.*]] = vector.shape_cast %[[C2]] : vector<256xf16> to vector<16x16xf16>
+//       CHECK:  return %[[RES]]#1, %[[C3]]
+
+func.func @test(%arg1 : !xegpu.tensor_desc<8x16xf16>, %arg2 : !xegpu.tensor_desc<16x16xf16>, %arg3 : index) -> (vector<8x16xf32>, vector<16x16xf16>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant dense<0.0> : vector<8x16xf32>
+  %0 = xegpu.load_nd %arg1 : !xegpu.tensor_desc<8x16xf16> -> vector<8x16xf16>
+  %1 = xegpu.load_nd %arg2 : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+  %2:2 = scf.for %i = %c0 to %arg3 step %c1 iter_args(%b = %1, %res = %cst) -> (vector<16x16xf16>, vector<8x16xf32>) {
+    %3 = xegpu.dpas %0, %b : vector<8x16xf16>, vector<16x16xf16> -> vector<8x16xf32>
+    %4 = arith.addf %res, %3 : vector<8x16xf32>
+    %5 = xegpu.load_nd %arg2 : !xegpu.tensor_desc<16x16xf16> -> vector<16x16xf16>
+    scf.yield %5, %4 : vector<16x16xf16>, vector<8x16xf32>
+  }
+  return %2#1, %2#0 : vector<8x16xf32>, vector<16x16xf16>
+}
@@ -299,4 +299,128 @@ module {
     // CHECK-NEXT:  }
     // CHECK-NEXT:  memref.copy
   }
+  func.func @if_branches(%arg0: memref<64xf32>, %arg1: memref<64xf32>, %cond: i1) {
+    %0 = scf.if %cond -> (memref<64xf32>) {
+      %alloc = memref.alloc() {alignment = 64 : i64} : memref<64xf32>
+      linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%arg0 : memref<64xf32>) outs(%alloc : memref<64xf32>) {
+      ^bb0(%in: f32, %out: f32):
+        %1 = arith.negf %in : f32
+        linalg.yield %1 : f32
+      }
+      scf.yield %alloc : memref<64xf32>
+    } else {
+      %alloc = memref.alloc() {alignment = 64 : i64} : memref<64xf32>
+      linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%arg0 : memref<64xf32>) outs(%alloc : memref<64xf32>) {
+      ^bb0(%in: f32, %out: f32):
+        %1 = math.absf %in : f32
+        linalg.yield %1 : f32
+      }
+      scf.yield %alloc : memref<64xf32>
+    }
+    memref.copy %0, %arg1 : memref<64xf32> to memref<64xf32>
+    memref.dealloc %0 : memref<64xf32>
+    return
+    // CHECK-LABEL: func @if_branches
+    // CHECK-SAME:  (%{{.*}}: memref<64xf32>, %[[ARG1:.*]]: memref<64xf32>, %{{.*}}: i1)
+    // CHECK-NOT:   memref.alloc
+    // CHECK:       scf.if
+    // CHECK-NEXT:  linalg.generic {{.*}} outs(%[[ARG1]] : memref<64xf32>)
+    // CHECK:       scf.yield %[[ARG1]]
+    // CHECK:       } else {
+    // CHECK-NEXT:  linalg.generic {{.*}} outs(%[[ARG1]] : memref<64xf32>)
+    // CHECK:       scf.yield %[[ARG1]]
+    // CHECK-NOT:   memref.copy
+    // CHECK-NOT:   memref.dealloc
+    // CHECK:       return
+  }
+  func.func @loop_double_buffer(%arg0: memref<64xf32>, %n: index) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %alloc = memref.alloc() {alignment = 64 : i64} : memref<64xf32>
+    scf.for %i = %c0 to %n step %c1 {
+      linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%arg0 : memref<64xf32>) outs(%alloc : memref<64xf32>) {
+      ^bb0(%in: f32, %out: f32):
+        %0 = arith.addf %in, %in : f32
+        linalg.yield %0 : f32
+      }
+      memref.copy %alloc, %arg0 : memref<64xf32> to memref<64xf32>
+    }
+    memref.dealloc %alloc : memref<64xf32>
+    return
+    // CHECK-LABEL: func @loop_double_buffer
+    // CHECK-SAME:  (%[[ARG0:.*]]: memref<64xf32>, %{{.*}}: index)
+    // CHECK:       %[[ALLOC:.*]] = memref.alloc()
+    // CHECK:       %[[RES:.*]]:2 = scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}} iter_args(%[[IN:.*]] = %[[ARG0]], %[[OUT:.*]] = %[[ALLOC]])
+    // CHECK-NEXT:  linalg.generic {{.*}} ins(%[[IN]] : memref<64xf32>) outs(%[[OUT]] : memref<64xf32>)
+    // CHECK-NOT:   memref.copy
+    // CHECK:       scf.yield %[[OUT]], %[[IN]]
+    // CHECK:       %[[P0:.*]] = memref.extract_aligned_pointer_as_index %[[RES]]#0
+    // CHECK:       %[[P1:.*]] = memref.extract_aligned_pointer_as_index %[[ARG0]]
+    // CHECK:       %[[NE:.*]] = arith.cmpi ne, %[[P0]], %[[P1]] : index
+    // CHECK:       scf.if %[[NE]] {
+    // CHECK-NEXT:  memref.copy %[[RES]]#0, %[[ARG0]]
+    // CHECK:       memref.dealloc %[[ALLOC]]
+  }
+  func.func @loop_double_buffer_read_first(%arg0: memref<64xf32>, %n: index) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %alloc = memref.alloc() {alignment = 64 : i64} : memref<64xf32>
+    scf.for %i = %c0 to %n step %c1 {
+      linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%arg0 : memref<64xf32>) outs(%alloc : memref<64xf32>) {
+      ^bb0(%in: f32, %out: f32):
+        %0 = arith.addf %in, %out : f32
+        linalg.yield %0 : f32
+      }
+      memref.copy %alloc, %arg0 : memref<64xf32> to memref<64xf32>
+    }
+    memref.dealloc %alloc : memref<64xf32>
+    return
+    // The body reads the temporary before overwriting it, swapping the
+    // buffers would change the values read.
+    // CHECK-LABEL: func @loop_double_buffer_read_first
+    // CHECK-SAME:  (%[[ARG0:.*]]: memref<64xf32>, %{{.*}}: index)
+    // CHECK:       %[[ALLOC:.*]] = memref.alloc()
+    // CHECK:       scf.for
+    // CHECK-NOT:   iter_args
+    // CHECK:       linalg.generic {{.*}} ins(%[[ARG0]] : memref<64xf32>) outs(%[[ALLOC]] : memref<64xf32>)
+    // CHECK:       memref.copy %[[ALLOC]], %[[ARG0]]
+    // CHECK:       memref.dealloc %[[ALLOC]]
+  }
+  func.func @gpu_alloc_forward(%arg0: memref<64xf32>) {
+    %tmp = gpu.alloc () : memref<64xf32>
+    %dst = gpu.alloc () : memref<64xf32>
+    linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%arg0 : memref<64xf32>) outs(%tmp : memref<64xf32>) {
+    ^bb0(%in: f32, %out: f32):
+      %0 = arith.addf %in, %in : f32
+      linalg.yield %0 : f32
+    }
+    memref.copy %tmp, %dst : memref<64xf32> to memref<64xf32>
+    gpu.dealloc %tmp : memref<64xf32>
+    "test.use"(%dst) : (memref<64xf32>) -> ()
+    gpu.dealloc %dst : memref<64xf32>
+    return
+    // CHECK-LABEL: func @gpu_alloc_forward
+    // CHECK-NEXT:  %[[DST:.*]] = gpu.alloc () : memref<64xf32>
+    // CHECK-NEXT:  linalg.generic {{.*}} outs(%[[DST]] : memref<64xf32>)
+    // CHECK-NOT:   memref.copy
+    // CHECK:       "test.use"(%[[DST]])
+    // CHECK-NEXT:  gpu.dealloc %[[DST]]
+    // CHECK-NEXT:  return
+  }
+  func.func @gpu_alloc_to_host(%arg0: memref<64xf32>, %arg1: memref<64xf32>) {
+    %tmp = gpu.alloc () : memref<64xf32>
+    linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%arg0 : memref<64xf32>) outs(%tmp : memref<64xf32>) {
+    ^bb0(%in: f32, %out: f32):
+      %0 = arith.addf %in, %in : f32
+      linalg.yield %0 : f32
+    }
+    memref.copy %tmp, %arg1 : memref<64xf32> to memref<64xf32>
+    gpu.dealloc %tmp : memref<64xf32>
+    return
+    // CHECK-LABEL: func @gpu_alloc_to_host
+    // CHECK-NEXT:  gpu.alloc
+    // CHECK-NEXT:  linalg.generic
+    // CHECK:       memref.copy
+    // CHECK-NEXT:  gpu.dealloc
+  }
 }
@@ -0,0 +1,170 @@
+// RUN: imex-opt --split-input-file --imex-tile-and-vectorize-linalg="simd-width=256 cache-size=4096" %s | FileCheck %s
+// RUN: imex-opt --split-input-file --imex-tile-and-vectorize-linalg="simd-width=512 parallel-loops=true" %s | FileCheck %s --check-prefix=AVX512
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+
+// The rows are blocked by 4, so that the blocks of the three operands fit into
+// 4 KiB, the whole matrices fit into the default cache size. The innermost
+// dimension is tiled by the number of f32 lanes, 8 with 256 bit registers and
+// 16 with 512 bit registers.
+func.func @eltwise(%arg0: memref<16x64xf32>, %arg1: memref<16x64xf32>, %arg2: memref<16x64xf32>) {
+  // CHECK-LABEL: func @eltwise
+  // CHECK: %[[C4:.*]] = arith.constant 4 : index
+  // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %[[C4]]
+  // CHECK-DAG: %[[C1:.*]] = arith.constant 1 : index
+  // CHECK-DAG: %[[C8:.*]] = arith.constant 8 : index
+  // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %[[C1]]
+  // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %[[C8]]
+  // CHECK: vector.transfer_read {{.*}}vector<8xf32>
+  // CHECK: vector.transfer_read {{.*}}vector<8xf32>
+  // CHECK: arith.addf %{{.*}}, %{{.*}} : vector<8xf32>
+  // CHECK: vector.transfer_write
+  // CHECK-NOT: linalg.generic
+  // AVX512-LABEL: func @eltwise
+  // AVX512: scf.parallel
+  // AVX512: arith.addf %{{.*}}, %{{.*}} : vector<16xf32>
+  // AVX512-NOT: linalg.generic
+  linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel", "parallel"]}
+      ins(%arg0, %arg1 : memref<16x64xf32>, memref<16x64xf32>)
+      outs(%arg2 : memref<16x64xf32>) {
+  ^bb0(%in: f32, %in_0: f32, %out: f32):
+    %0 = arith.addf %in, %in_0 : f32
+    linalg.yield %0 : f32
+  }
+  return
+}
+
+// -----
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+#map1 = affine_map<(d0, d1) -> (d1, d0)>
+
+// The input is read along d0: the op is tiled into cache blocks, 16x32 for
+// 4 KiB, and then into 8x8 vector blocks transposed with shuffles.
+func.func @transpose(%arg0: memref<64x64xf32>, %arg1: memref<64x64xf32>) {
+  // CHECK-LABEL: func @transpose
+  // CHECK-DAG: %[[C8:.*]] = arith.constant 8 : index
+  // CHECK-DAG: %[[C16:.*]] = arith.constant 16 : index
+  // CHECK-DAG: %[[C32:.*]] = arith.constant 32 : index
+  // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %[[C16]]
+  // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %[[C32]]
+  // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %[[C8]]
+  // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %[[C8]]
+  // CHECK: vector.transfer_read {{.*}}vector<8x8xf32>
+  // CHECK: vector.shuffle
+  // CHECK-NOT: vector.transpose
+  // CHECK: vector.transfer_write {{.*}}vector<8x8xf32>
+  // CHECK-NOT: linalg.generic
+  linalg.generic {indexing_maps = [#map1, #map], iterator_types = ["parallel", "parallel"]}
+      ins(%arg0 : memref<64x64xf32>)
+      outs(%arg1 : memref<64x64xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    linalg.yield %in : f32
+  }
+  return
+}
+
+// -----
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+#map1 = affine_map<(d0, d1) -> (d0)>
+
+// Row sums become horizontal vector reductions.
+func.func @reduction(%arg0: memref<16x64xf32>, %arg1: memref<16xf32>) {
+  // CHECK-LABEL: func @reduction
+  // CHECK: vector.transfer_read {{.*}}vector<8x8xf32>
+  // CHECK: vector.reduction <add>, %{{.*}}, %{{.*}} : vector<8xf32> into f32
+  // CHECK-NOT: linalg.generic
+  linalg.generic {indexing_maps = [#map, #map1], iterator_types = ["parallel", "reduction"]}
+      ins(%arg0 : memref<16x64xf32>)
+      outs(%arg1 : memref<16xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %0 = arith.addf %in, %out : f32
+    linalg.yield %0 : f32
+  }
+  return
+}
+
+// -----
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+
+// 100 columns are blocked by 64 and tiled by 8, the tiles at the end of a
+// block are masked instead of falling back to scalar code.
+func.func @remainder(%arg0: memref<16x100xf32>, %arg1: memref<16x100xf32>, %arg2: memref<16x100xf32>) {
+  // CHECK-LABEL: func @remainder
+  // CHECK-DAG: %[[C4:.*]] = arith.constant 4 : index
+  // CHECK-DAG: %[[C64:.*]] = arith.constant 64 : index
+  // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %[[C4]]
+  // CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %[[C64]]
+  // CHECK: affine.min
+  // CHECK: vector.create_mask
+  // CHECK: arith.addf %{{.*}}, %{{.*}} : vector<8xf32>
+  // CHECK: vector.transfer_write
+  // CHECK-NOT: linalg.generic
+  linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel", "parallel"]}
+      ins(%arg0, %arg1 : memref<16x100xf32>, memref<16x100xf32>)
+      outs(%arg2 : memref<16x100xf32>) {
+  ^bb0(%in: f32, %in_0: f32, %out: f32):
+    %0 = arith.addf %in, %in_0 : f32
+    linalg.yield %0 : f32
+  }
+  return
+}
+
+// -----
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+#map1 = affine_map<(d0, d1) -> (d0)>
+
+// A softmax over rows of 100 elements: every step is vectorized, the row
+// reductions and the broadcasts of their results use 8x8 blocks.
+func.func @softmax(%arg0: memref<16x100xf32>, %arg1: memref<16x100xf32>, %max: memref<16xf32>, %sum: memref<16xf32>) {
+  // CHECK-LABEL: func @softmax
+  // CHECK: vector.create_mask
+  // CHECK: vector.reduction <maximumf>
+  // CHECK: math.exp %{{.*}} : vector<8x8xf32>
+  // CHECK: vector.reduction <add>
+  // CHECK: arith.divf %{{.*}}, %{{.*}} : vector<8x8xf32>
+  // CHECK-NOT: linalg.generic
+  linalg.generic {indexing_maps = [#map, #map1], iterator_types = ["parallel", "reduction"]}
+      ins(%arg0 : memref<16x100xf32>)
+      outs(%max : memref<16xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %0 = arith.maximumf %in, %out : f32
+    linalg.yield %0 : f32
+  }
+  linalg.generic {indexing_maps = [#map, #map1, #map], iterator_types = ["parallel", "parallel"]}
+      ins(%arg0, %max : memref<16x100xf32>, memref<16xf32>)
+      outs(%arg1 : memref<16x100xf32>) {
+  ^bb0(%in: f32, %in_0: f32, %out: f32):
+    %0 = arith.subf %in, %in_0 : f32
+    %1 = math.exp %0 : f32
+    linalg.yield %1 : f32
+  }
+  linalg.generic {indexing_maps = [#map, #map1], iterator_types = ["parallel", "reduction"]}
+      ins(%arg1 : memref<16x100xf32>)
+      outs(%sum : memref<16xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %0 = arith.addf %in, %out : f32
+    linalg.yield %0 : f32
+  }
+  linalg.generic {indexing_maps = [#map, #map1, #map], iterator_types = ["parallel", "parallel"]}
+      ins(%arg1, %sum : memref<16x100xf32>, memref<16xf32>)
+      outs(%arg1 : memref<16x100xf32>) {
+  ^bb0(%in: f32, %in_0: f32, %out: f32):
+    %0 = arith.divf %in, %in_0 : f32
+    linalg.yield %0 : f32
+  }
+  return
+}
+
+// -----
+
+// Dynamic shapes are left to convert-linalg-to-loops.
+func.func @dynamic(%arg0: memref<?xf32>, %arg1: memref<?xf32>) {
+  // CHECK-LABEL: func @dynamic
+  // CHECK: linalg.copy
+  linalg.copy ins(%arg0 : memref<?xf32>) outs(%arg1 : memref<?xf32>)
+  return
+}
@@ -0,0 +1,135 @@
+// RUN: imex-opt --split-input-file --imex-tile-parallel-loops %s | FileCheck %s
+// RUN: imex-opt --split-input-file --imex-tile-parallel-loops="workgroup-size=64 max-coarsening=1" %s | FileCheck %s --check-prefix=WG64
+
+// The iteration space is a multiple of the workgroup size (16 x 8 on pvc):
+// no guard, innermost dimension mapped to x.
+func.func @tile_1d(%arg0: memref<1024xf32>) {
+  // CHECK-LABEL: func @tile_1d
+  // CHECK-DAG: %[[C128:.*]] = arith.constant 128 : index
+  // CHECK: scf.parallel (%[[B:.*]]) = (%{{.*}}) to (%{{.*}}) step (%{{.*}}) {
+  // CHECK-NEXT: scf.parallel (%[[T:.*]]) = (%{{.*}}) to (%[[C128]]) step (%{{.*}}) {
+  // CHECK-NEXT: %[[OFF:.*]] = arith.muli %[[T]], %{{.*}} : index
+  // CHECK-NEXT: %[[IV:.*]] = arith.addi %[[B]], %[[OFF]] : index
+  // CHECK-NEXT: memref.load %{{.*}}[%[[IV]]] : memref<1024xf32>
+  // CHECK-NOT: scf.if
+  // CHECK: {mapping = [#gpu.loop_dim_map<processor = thread_x, map = (d0) -> (d0), bound = (d0) -> (d0)>]}
+  // CHECK: {mapping = [#gpu.loop_dim_map<processor = block_x, map = (d0) -> (d0), bound = (d0) -> (d0)>]}
+  // WG64-LABEL: func @tile_1d
+  // WG64: scf.parallel
+  // WG64-NEXT: scf.parallel (%{{.*}}) = (%{{.*}}) to (%c64) step (%{{.*}}) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c1024 = arith.constant 1024 : index
+  scf.parallel (%i) = (%c0) to (%c1024) step (%c1) {
+    %0 = memref.load %arg0[%i] : memref<1024xf32>
+    %1 = arith.addf %0, %0 : f32
+    memref.store %1, %arg0[%i] : memref<1024xf32>
+  }
+  return
+}
+
+// -----
+
+// The whole workgroup goes to the innermost dimension, which is not a
+// multiple of it and needs a guard.
+func.func @tile_2d(%arg0: memref<100x1000xf32>) {
+  // CHECK-LABEL: func @tile_2d
+  // CHECK-DAG: %[[C1000:.*]] = arith.constant 1000 : index
+  // CHECK-DAG: %[[C128:.*]] = arith.constant 128 : index
+  // CHECK: scf.parallel (%[[B0:.*]], %[[B1:.*]]) =
+  // CHECK-NEXT: scf.parallel (%[[T0:.*]], %[[T1:.*]]) = (%{{.*}}, %{{.*}}) to (%{{.*}}, %[[C128]])
+  // CHECK: %[[IV0:.*]] = arith.addi %[[B0]]
+  // CHECK: %[[IV1:.*]] = arith.addi %[[B1]]
+  // CHECK-NEXT: %[[COND:.*]] = arith.cmpi slt, %[[IV1]], %[[C1000]] : index
+  // CHECK-NEXT: scf.if %[[COND]] {
+  // CHECK-NEXT: memref.load %{{.*}}[%[[IV0]], %[[IV1]]] : memref<100x1000xf32>
+  // CHECK: {mapping = [#gpu.loop_dim_map<processor = thread_y, map = (d0) -> (d0), bound = (d0) -> (d0)>, #gpu.loop_dim_map<processor = thread_x, map = (d0) -> (d0), bound = (d0) -> (d0)>]}
+  // CHECK: {mapping = [#gpu.loop_dim_map<processor = block_y, map = (d0) -> (d0), bound = (d0) -> (d0)>, #gpu.loop_dim_map<processor = block_x, map = (d0) -> (d0), bound = (d0) -> (d0)>]}
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c100 = arith.constant 100 : index
+  %c1000 = arith.constant 1000 : index
+  scf.parallel (%i, %j) = (%c0, %c0) to (%c100, %c1000) step (%c1, %c1) {
+    %0 = memref.load %arg0[%i, %j] : memref<100x1000xf32>
+    %1 = arith.addf %0, %0 : f32
+    memref.store %1, %arg0[%i, %j] : memref<100x1000xf32>
+  }
+  return
+}
+
+// -----
+
+// A tiny body over many more elements than the device has lanes: every
+// work-item handles 4 elements strided by the workgroup width.
+func.func @coarsen(%arg0: memref<4194304xf32>) {
+  // CHECK-LABEL: func @coarsen
+  // CHECK-DAG: %[[C4:.*]] = arith.constant 4 : index
+  // CHECK-DAG: %[[C128:.*]] = arith.constant 128 : index
+  // CHECK: scf.parallel (%[[B:.*]]) =
+  // CHECK-NEXT: scf.parallel (%[[T:.*]]) = (%{{.*}}) to (%[[C128]])
+  // CHECK-NEXT: scf.for %[[K:.*]] = %{{.*}} to %[[C4]]
+  // CHECK-NEXT: %[[STRIDE:.*]] = arith.muli %[[K]], %[[C128]] : index
+  // CHECK-NEXT: %[[OFF:.*]] = arith.addi %[[T]], %[[STRIDE]] : index
+  // CHECK-NEXT: arith.muli %[[OFF]]
+  // CHECK-NEXT: %[[IV:.*]] = arith.addi %[[B]]
+  // CHECK-NEXT: memref.load %{{.*}}[%[[IV]]]
+  // WG64-LABEL: func @coarsen
+  // WG64-NOT: scf.for
+  // WG64: return
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = arith.constant 4194304 : index
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = memref.load %arg0[%i] : memref<4194304xf32>
+    %1 = arith.addf %0, %0 : f32
+    memref.store %1, %arg0[%i] : memref<4194304xf32>
+  }
+  return
+}
+
+// -----
+
+// Dynamic bounds are always guarded.
+func.func @dynamic(%arg0: memref<?xf32>, %n: index) {
+  // CHECK-LABEL: func @dynamic
+  // CHECK-SAME: (%{{.*}}: memref<?xf32>, %[[N:.*]]: index)
+  // CHECK: scf.parallel
+  // CHECK: arith.cmpi slt, %{{.*}}, %[[N]] : index
+  // CHECK-NEXT: scf.if
+  // CHECK: {mapping = [#gpu.loop_dim_map<processor = thread_x
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = memref.load %arg0[%i] : memref<?xf32>
+    memref.store %0, %arg0[%i] : memref<?xf32>
+  }
+  return
+}
+
+// -----
+
+// Loops with nested parallel loops, single iteration loops and empty loops
+// are left to gpu-map-parallel-loops.
+func.func @untouched(%arg0: memref<16x16xf32>) {
+  // CHECK-LABEL: func @untouched
+  // CHECK-NOT: mapping
+  // CHECK: return
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c16 = arith.constant 16 : index
+  scf.parallel (%i) = (%c0) to (%c16) step (%c1) {
+    scf.parallel (%j) = (%c0) to (%c16) step (%c1) {
+      %0 = memref.load %arg0[%i, %j] : memref<16x16xf32>
+      memref.store %0, %arg0[%i, %j] : memref<16x16xf32>
+    }
+  }
+  scf.parallel (%i) = (%c0) to (%c1) step (%c1) {
+    %0 = memref.load %arg0[%i, %i] : memref<16x16xf32>
+    memref.store %0, %arg0[%i, %i] : memref<16x16xf32>
+  }
+  scf.parallel (%i) = (%c16) to (%c1) step (%c1) {
+    %0 = memref.load %arg0[%i, %i] : memref<16x16xf32>
+    memref.store %0, %arg0[%i, %i] : memref<16x16xf32>
+  }
+  return
+}
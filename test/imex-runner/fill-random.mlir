@@ -0,0 +1,52 @@
+// RUN: %python_executable %imex_runner -i %s --pass-pipeline-file=%p/../PlaidML/linalg-to-cpu.pp -e main \
+// RUN:   --entry-point-result=void --shared-libs=%irunner_utils,%mlir_runner_utils,%mlir_c_runner_utils --filecheck
+
+// The values only depend on the seed and on the position of the elements,
+// not on the layout or the element type.
+func.func @main() {
+  %lower = arith.constant 0.0 : f32
+  %upper = arith.constant 100.0 : f32
+  %true = arith.constant true
+  %seed = arith.constant 7 : i64
+
+  %a = memref.alloc() : memref<4x4xf32>
+  %a_cast = memref.cast %a : memref<4x4xf32> to memref<*xf32>
+  call @fillResourceRandomF32(%a_cast, %lower, %upper, %true, %seed) : (memref<*xf32>, f32, f32, i1, i64) -> ()
+  call @printMemrefF32(%a_cast) : (memref<*xf32>) -> ()
+  // CHECK: Unranked Memref base@ = {{(0x)?[-9a-f]*}}
+  // CHECK: [95, 52, 62, 10]
+  // CHECK: [52, 42, 12, 78]
+  // CHECK: [87, 89, 22, 58]
+  // CHECK: [5, 84, 9, 3]
+
+  %b = memref.alloc() : memref<4x8xf32>
+  %b_view = memref.subview %b[0, 2] [4, 4] [1, 1] : memref<4x8xf32> to memref<4x4xf32, strided<[8, 1], offset: 2>>
+  %b_cast = memref.cast %b_view : memref<4x4xf32, strided<[8, 1], offset: 2>> to memref<*xf32>
+  call @fillResourceRandomF32(%b_cast, %lower, %upper, %true, %seed) : (memref<*xf32>, f32, f32, i1, i64) -> ()
+  call @printMemrefF32(%b_cast) : (memref<*xf32>) -> ()
+  // CHECK: Unranked Memref base@ = {{(0x)?[-9a-f]*}}
+  // CHECK: [95, 52, 62, 10]
+  // CHECK: [52, 42, 12, 78]
+  // CHECK: [87, 89, 22, 58]
+  // CHECK: [5, 84, 9, 3]
+
+  %c = memref.alloc() : memref<4x4xi32>
+  %c_cast = memref.cast %c : memref<4x4xi32> to memref<*xi32>
+  call @fillResourceRandomI32(%c_cast, %lower, %upper, %true, %seed) : (memref<*xi32>, f32, f32, i1, i64) -> ()
+  call @printMemrefI32(%c_cast) : (memref<*xi32>) -> ()
+  // CHECK: Unranked Memref base@ = {{(0x)?[-9a-f]*}}
+  // CHECK: [95, 52, 62, 10]
+  // CHECK: [52, 42, 12, 78]
+  // CHECK: [87, 89, 22, 58]
+  // CHECK: [5, 84, 9, 3]
+
+  memref.dealloc %a : memref<4x4xf32>
+  memref.dealloc %b : memref<4x8xf32>
+  memref.dealloc %c : memref<4x4xi32>
+  return
+}
+
+func.func private @fillResourceRandomF32(memref<*xf32>, f32, f32, i1, i64) attributes {llvm.emit_c_interface}
+func.func private @fillResourceRandomI32(memref<*xi32>, f32, f32, i1, i64) attributes {llvm.emit_c_interface}
+func.func private @printMemrefF32(memref<*xf32>) attributes {llvm.emit_c_interface}
+func.func private @printMemrefI32(memref<*xi32>) attributes {llvm.emit_c_interface}
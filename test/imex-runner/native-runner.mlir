@@ -0,0 +1,39 @@
+// RUN: imex-runner %s --pass-pipeline-file=%p/../PlaidML/linalg-to-cpu.pp -e main --entry-point-result=void \
+// RUN:   --shared-libs=%mlir_runner_utils,%mlir_c_runner_utils | FileCheck %s
+// RUN: imex-runner %s --pass-pipeline-file=%p/../PlaidML/linalg-to-cpu.pp -e main --entry-point-result=void \
+// RUN:   --shared-libs=%mlir_runner_utils,%mlir_c_runner_utils --mlir-timing 2>&1 >/dev/null | FileCheck %s --check-prefix=TIMING
+// RUN: not imex-runner %s --pass-pipeline='func.func(canonicalize)' -e main --entry-point-result=void \
+// RUN:   --shared-libs=%mlir_runner_utils,%mlir_c_runner_utils 2>&1 | FileCheck %s --check-prefix=ANCHOR
+// RUN: %python_executable %imex_runner -i %s --pass-pipeline-file=%p/../PlaidML/linalg-to-cpu.pp --native -e main \
+// RUN:   --entry-point-result=void --shared-libs=%mlir_runner_utils,%mlir_c_runner_utils --filecheck
+// RUN: %python_executable %imex_runner -i %s --pass-pipeline-file=%p/../PlaidML/linalg-to-cpu.pp -e main \
+// RUN:   --entry-point-result=void --shared-libs=%mlir_runner_utils,%mlir_c_runner_utils --filecheck
+
+// ANCHOR: error: pass pipeline anchored on 'func.func' cannot run on 'builtin.module'
+
+// TIMING-DAG: Parse
+// TIMING-DAG: Passes
+// TIMING-DAG: Translate to LLVM IR
+// TIMING-DAG: Codegen
+// TIMING-DAG: Execute
+
+#map = affine_map<(d0) -> (d0)>
+module {
+  func.func @main() {
+    %0 = arith.constant dense<[1.0, 2.0, 3.0, 4.0]> : tensor<4xf32>
+    %1 = tensor.empty() : tensor<4xf32>
+    %2 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]}
+        ins(%0 : tensor<4xf32>) outs(%1 : tensor<4xf32>) {
+    ^bb0(%in: f32, %out: f32):
+      %3 = arith.mulf %in, %in : f32
+      linalg.yield %3 : f32
+    } -> tensor<4xf32>
+    %unranked = tensor.cast %2 : tensor<4xf32> to tensor<*xf32>
+    call @printMemrefF32(%unranked) : (tensor<*xf32>) -> ()
+    //      CHECK: Unranked Memref base@ = {{(0x)?[-9a-f]*}}
+    // CHECK-NEXT: [1, 4, 9, 16]
+    return
+  }
+
+  func.func private @printMemrefF32(%ptr : tensor<*xf32>)
+}
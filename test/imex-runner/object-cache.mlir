@@ -0,0 +1,20 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: imex-cpu-runner %s -e main --entry-point-result=i32 -O2 --object-cache-dir=%t | FileCheck %s
+// RUN: ls %t | count 1
+
+// The second run loads the cached object.
+// RUN: imex-cpu-runner %s -e main --entry-point-result=i32 -O2 --object-cache-dir=%t | FileCheck %s
+// RUN: ls %t | count 1
+
+// Another optimization level compiles another object.
+// RUN: env IMEX_OBJECT_CACHE_DIR=%t imex-cpu-runner %s -e main --entry-point-result=i32 -O0 | FileCheck %s
+// RUN: ls %t | count 2
+
+llvm.func @main() -> i32 {
+  %0 = llvm.mlir.constant(40 : i32) : i32
+  %1 = llvm.mlir.constant(2 : i32) : i32
+  %2 = llvm.add %0, %1 : i32
+  llvm.return %2 : i32
+}
+
+// CHECK: 42
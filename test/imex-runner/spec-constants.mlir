@@ -0,0 +1,30 @@
+// RUN: %python_executable %imex_runner -i %s --pass-pipeline-file=%p/spec-constants.pp -n --filecheck
+
+// The loop bound of the kernel is derived from the shape of the input, so
+// the pipeline marks it as a specialization constant and the launch asks the
+// runtime for a kernel specialized to its value.
+module {
+  func.func @halve(%arg0: memref<?xf32>) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c2 = arith.constant 2 : index
+    %n = memref.dim %arg0, %c0 : memref<?xf32>
+    %half = arith.divui %n, %c2 : index
+    gpu.launch blocks(%bx, %by, %bz) in (%gx = %c1, %gy = %c1, %gz = %c1)
+               threads(%tx, %ty, %tz) in (%sx = %c1, %sy = %c1, %sz = %c1) {
+      scf.for %i = %c0 to %half step %c1 {
+        %j = arith.addi %i, %half : index
+        %v = memref.load %arg0[%j] : memref<?xf32>
+        memref.store %v, %arg0[%i] : memref<?xf32>
+      }
+      gpu.terminator
+    }
+    return
+  }
+}
+
+// CHECK-LABEL: llvm.func @halve
+// CHECK: %[[SLOT:.*]] = llvm.mlir.addressof @{{.*}}_kernel_slot_0 : !llvm.ptr
+// CHECK: llvm.call @{{.*}}_get_specialized_kernel(%{{.*}}, %[[SLOT]], %{{.*}}, %{{.*}}, %{{.*}})
+// CHECK: llvm.call @gpuLaunchKernel
+// CHECK: llvm.call @gpuKernelGetSpecialized
@@ -0,0 +1,23 @@
+// Outlines the gpu.launch of a host function, marks the kernel arguments
+// derived from memref shapes as specialization constants and lowers both
+// sides down to the runtime calls.
+builtin.module(
+    gpu-kernel-outlining,
+    canonicalize,
+    cse,
+    imex-mark-spec-constants,
+    set-spirv-capabilities{client-api=opencl},
+    gpu.module(set-spirv-abi-attrs{client-api=opencl}),
+    canonicalize,
+    imex-convert-gpu-to-spirv,
+    spirv.module(spirv-lower-abi-attrs),
+    spirv.module(spirv-update-vce),
+    serialize-spirv,
+    expand-strided-metadata,
+    convert-gpu-to-gpux,
+    convert-func-to-llvm,
+    convert-math-to-llvm,
+    convert-gpux-to-llvm,
+    finalize-memref-to-llvm,
+    reconcile-unrealized-casts
+)
@@ -35,6 +35,7 @@ config.substitutions.append(('%mlir_lib_dir', config.mlir_runner_utils_dir))
 config.substitutions.append(('%imex_tools_dir', config.imex_tools_dir))
 config.substitutions.append(('%mlir_runner_utils', config.mlir_runner_utils))
 config.substitutions.append(('%mlir_c_runner_utils', config.mlir_c_runner_utils))
+config.substitutions.append(('%mlir_async_runtime', config.mlir_async_runtime))
 if config.enable_vulkan_runner:
     config.substitutions.append(('%vulkan_runtime_wrappers', config.vulkan_runtime_wrappers))
 config.substitutions.append(('%imex_runner', config.imex_runner))
@@ -68,7 +69,8 @@ tool_dirs = [os.path.normpath(config.imex_tools_dir),
              os.path.normpath(config.llvm_tools_dir)]
 tools = [
     'imex-opt',
-    'imex-runner.py'
+    'imex-runner.py',
+    'imex-runtime-check'
 ]
 
 llvm_config.add_tool_substitutions(tools, tool_dirs)
@@ -28,10 +28,11 @@
 
 // This file is copied from upstream mlir-cpu-runner
 // https://github.com/llvm/llvm-project/blob/main/mlir/tools/mlir-cpu-runner/mlir-cpu-runner.cpp
+// The JIT runner is imex::JitRunnerMain, which adds an on-disk object cache.
+
+#include "imex/ExecutionEngine/JitRunner.h"
 
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
-#include "mlir/ExecutionEngine/JitRunner.h"
-#include "mlir/ExecutionEngine/OptUtils.h"
 #include "mlir/IR/Dialect.h"
 #include "mlir/Target/LLVMIR/Dialect/All.h"
 
@@ -47,5 +48,5 @@ int main(int argc, char **argv) {
   mlir::DialectRegistry registry;
   mlir::registerAllToLLVMIRTranslations(registry);
 
-  return mlir::JitRunnerMain(argc, argv, registry);
+  return imex::JitRunnerMain(argc, argv, registry);
 }
@@ -0,0 +1,142 @@
+//===- imex-runner.cpp - IMEX compile and run driver ------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the native counterpart of imex-runner.py. It parses an
+// MLIR file once, runs a pass pipeline on it and JIT executes the result in
+// the same process, instead of piping textual IR from imex-opt into
+// imex-cpu-runner. It accepts the flags of imex-cpu-runner, plus the pass
+// pipeline as a string (--pass-pipeline) or as a .pp file
+// (--pass-pipeline-file) in the format of imex-runner.py.
+//
+//===----------------------------------------------------------------------===//
+
+#include "imex/ExecutionEngine/JitRunner.h"
+#include "imex/InitIMEXDialects.h"
+#include "imex/InitIMEXPasses.h"
+
+#include "mlir/IR/Dialect.h"
+#include "mlir/InitAllDialects.h"
+#include "mlir/InitAllExtensions.h"
+#include "mlir/InitAllPasses.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Pass/PassRegistry.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Target/LLVMIR/Dialect/All.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <regex>
+#include <string>
+
+static llvm::cl::OptionCategory runnerCategory("imex-runner options");
+
+static llvm::cl::opt<std::string>
+    passPipeline("pass-pipeline",
+                 llvm::cl::desc("Pass pipeline to run before execution"),
+                 llvm::cl::init(""), llvm::cl::cat(runnerCategory));
+static llvm::cl::alias passPipelineAlias("p",
+                                         llvm::cl::desc("Alias for "
+                                                        "--pass-pipeline"),
+                                         llvm::cl::aliasopt(passPipeline));
+
+static llvm::cl::opt<std::string> passPipelineFile(
+    "pass-pipeline-file",
+    llvm::cl::desc("File defining the pass pipeline to run before execution"),
+    llvm::cl::value_desc("<file>"), llvm::cl::init(""),
+    llvm::cl::cat(runnerCategory));
+static llvm::cl::alias
+    passPipelineFileAlias("f",
+                          llvm::cl::desc("Alias for --pass-pipeline-file"),
+                          llvm::cl::aliasopt(passPipelineFile));
+
+/// Reads a pipeline file like imex-runner.py does: comments are stripped,
+/// lines are joined with ',' and empty list elements are dropped.
+static mlir::FailureOr<std::string> readPipelineFile(llvm::StringRef path) {
+  std::string errorMessage;
+  auto file = mlir::openInputFile(path, &errorMessage);
+  if (!file) {
+    llvm::errs() << errorMessage << "\n";
+    return mlir::failure();
+  }
+
+  llvm::SmallVector<llvm::StringRef> lines;
+  file->getBuffer().split(lines, '\n');
+  std::string pipeline;
+  for (llvm::StringRef line : lines) {
+    line = line.take_front(line.find("//")).trim();
+    if (line.empty())
+      continue;
+    if (!pipeline.empty())
+      pipeline += ',';
+    pipeline += line.str();
+  }
+  pipeline = std::regex_replace(pipeline, std::regex(",+"), ",");
+  pipeline = std::regex_replace(pipeline, std::regex("\\(,"), "(");
+  pipeline = std::regex_replace(pipeline, std::regex(",\\)"), ")");
+  return llvm::StringRef(pipeline).rtrim(',').str();
+}
+
+int main(int argc, char **argv) {
+  llvm::InitLLVM y(argc, argv);
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+  llvm::InitializeNativeTargetAsmParser();
+
+  mlir::registerAllPasses();
+  imex::registerAllPasses();
+  // --mlir-print-ir-before-all and friends.
+  mlir::registerPassManagerCLOptions();
+
+  mlir::DialectRegistry registry;
+  mlir::registerAllDialects(registry);
+  mlir::registerAllExtensions(registry);
+  imex::registerAllDialects(registry);
+  mlir::registerAllToLLVMIRTranslations(registry);
+
+  // The options are parsed by JitRunnerMain, the pipeline is read when the
+  // module is transformed.
+  auto transformer = [](mlir::Operation *module,
+                        mlir::TimingScope &timing) -> mlir::LogicalResult {
+    std::string pipeline = passPipeline;
+    if (!passPipelineFile.empty()) {
+      auto filePipeline = readPipelineFile(passPipelineFile);
+      if (failed(filePipeline))
+        return mlir::failure();
+      pipeline = *filePipeline;
+    }
+    if (pipeline.empty())
+      return mlir::success();
+
+    // The pipeline names the op it is anchored on, e.g. builtin.module(...),
+    // which has to match the parsed module.
+    auto parsed = mlir::parsePassPipeline(pipeline, llvm::errs());
+    if (failed(parsed))
+      return mlir::failure();
+    llvm::StringRef anchor = parsed->getOpAnchorName();
+    if (anchor != mlir::OpPassManager::getAnyOpAnchorName() &&
+        anchor != module->getName().getStringRef())
+      return module->emitError()
+             << "pass pipeline anchored on '" << anchor
+             << "' cannot run on '" << module->getName() << "'";
+
+    mlir::PassManager pm(module->getContext(), anchor);
+    static_cast<mlir::OpPassManager &>(pm) = std::move(*parsed);
+    if (failed(mlir::applyPassManagerCLOptions(pm)))
+      return mlir::failure();
+    pm.enableTiming(timing);
+    return pm.run(module);
+  };
+
+  imex::JitRunnerConfig config;
+  config.mlirTransformer = transformer;
+  return imex::JitRunnerMain(argc, argv, registry, config);
+}
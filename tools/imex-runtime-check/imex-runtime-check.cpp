@@ -0,0 +1,325 @@
+//===- imex-runtime-check.cpp -----------------------------------*- C++ -*-===//
+//
+// Copyright 2024 Intel Corporation
+// Part of the IMEX Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file exercises the host side helpers of the GPU runtime wrappers
+// without a device. Every command prints what it observes, the lit tests
+// check the output with FileCheck.
+//
+//===----------------------------------------------------------------------===//
+
+#include "imex/ExecutionEngine/CachingAllocator.h"
+#include "imex/ExecutionEngine/KernelBinaryCache.h"
+#include "imex/ExecutionEngine/TraceRecorder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct BackendCounters {
+  unsigned allocs = 0;
+  unsigned frees = 0;
+  int outstanding = 0;
+};
+
+// Host memory, counting the requests that reach the backend.
+struct CountingBackend {
+  BackendCounters *counters;
+
+  void *allocate(size_t size, size_t alignment, bool shared) {
+    ++counters->allocs;
+    ++counters->outstanding;
+    return host.allocate(size, alignment, shared);
+  }
+  void deallocate(void *ptr) {
+    ++counters->frees;
+    --counters->outstanding;
+    host.deallocate(ptr);
+  }
+
+  imex::HostMemoryBackend host;
+};
+
+int checkAllocator() {
+  BackendCounters counters;
+  {
+    imex::CachingAllocator<CountingBackend> allocator(
+        CountingBackend{&counters, {}});
+    auto always = [](uint64_t) { return true; };
+    auto noWait = [](uint64_t) {};
+
+    // Steady state: the same sizes are allocated and freed on every
+    // iteration, only the first one reaches the backend.
+    const size_t sizes[] = {100, 5000, 70000};
+    uint64_t fence = 0;
+    for (int iter = 0; iter < 10; ++iter) {
+      void *ptrs[3];
+      for (int i = 0; i < 3; ++i)
+        ptrs[i] = allocator.allocate(sizes[i], 64, false, always);
+      for (int i = 0; i < 3; ++i)
+        allocator.deallocate(ptrs[i], ++fence, noWait);
+      if (iter == 0)
+        printf("first iteration: %u backend allocs\n", counters.allocs);
+    }
+    printf("steady state: %u backend allocs, %u backend frees\n",
+           counters.allocs, counters.frees);
+
+    // A block is not reused before its fence completes.
+    uint64_t completed = 0;
+    auto isComplete = [&](uint64_t f) { return f <= completed; };
+    void *first = allocator.allocate(1 << 20, 64, true, isComplete);
+    allocator.deallocate(first, 5, noWait);
+    completed = 4;
+    void *second = allocator.allocate(1 << 20, 64, true, isComplete);
+    printf("fence pending: %s\n", second == first ? "reused" : "new block");
+    allocator.deallocate(second, 6, noWait);
+    completed = 6;
+    void *third = allocator.allocate(1 << 20, 64, true, isComplete);
+    printf("fence complete: %s\n",
+           third == first || third == second ? "reused" : "new block");
+    allocator.deallocate(third, 7, noWait);
+
+    // Blocks of another kind are never mixed up.
+    void *host = allocator.allocate(1 << 20, 64, false, always);
+    printf("other kind: %s\n",
+           host == first || host == second ? "reused" : "new block");
+    allocator.deallocate(host, 8, noWait);
+
+    printf("before destruction: %d blocks outstanding\n",
+           counters.outstanding);
+  }
+  printf("after destruction: %d blocks outstanding\n", counters.outstanding);
+
+  BackendCounters trimCounters;
+  {
+    imex::CachingAllocator<CountingBackend> allocator(
+        CountingBackend{&trimCounters, {}});
+    auto always = [](uint64_t) { return true; };
+    auto noWait = [](uint64_t) {};
+    const unsigned interval =
+        imex::CachingAllocator<CountingBackend>::kTrimInterval;
+
+    // The stream waits after every kernel. A one-off peak is released, the
+    // blocks of a loop alternating between two size classes are kept.
+    void *peak = allocator.allocate(1 << 20, 64, false, always);
+    allocator.deallocate(peak, 0, noWait);
+    for (unsigned iter = 0; iter < 3 * interval; ++iter) {
+      for (size_t size : {8192, 65536}) {
+        void *ptr = allocator.allocate(size, 64, false, always);
+        allocator.deallocate(ptr, 0, noWait);
+        allocator.trim(always);
+      }
+    }
+    printf("alternating sizes: %u backend allocs, %u backend frees\n",
+           trimCounters.allocs, trimCounters.frees);
+
+    // Blocks are only released once their fence completes.
+    uint64_t completed = 0;
+    auto isComplete = [&](uint64_t f) { return f <= completed; };
+    void *pending = allocator.allocate(1 << 20, 64, false, always);
+    allocator.deallocate(pending, 1, noWait);
+    for (unsigned i = 0; i < 3 * interval; ++i)
+      allocator.trim(isComplete);
+    printf("trim, fence pending: %d blocks outstanding\n",
+           trimCounters.outstanding);
+    completed = 1;
+    for (unsigned i = 0; i < 2 * interval; ++i)
+      allocator.trim(isComplete);
+    printf("trim, fence complete: %d blocks outstanding\n",
+           trimCounters.outstanding);
+
+    // Memory not allocated by the pool goes back to the backend once its
+    // fence completes.
+    void *foreign = allocator.getBackend().host.allocate(64, 64, false);
+    uint64_t waited = 0;
+    allocator.deallocate(foreign, 7, [&](uint64_t f) { waited = f; });
+    printf("foreign block: waited for fence %llu\n",
+           (unsigned long long)waited);
+  }
+  return 0;
+}
+
+// Expects IMEX_KERNEL_CACHE_DIR to name an empty directory.
+int checkBinaryCache() {
+  imex::KernelBinaryCache cache;
+  const char *dir = std::getenv("IMEX_KERNEL_CACHE_DIR");
+  if (!cache.isEnabled() || !dir) {
+    fprintf(stderr, "IMEX_KERNEL_CACHE_DIR is not set\n");
+    return 1;
+  }
+
+  std::vector<uint8_t> spirv = {0x03, 0x02, 0x23, 0x07, 1, 2, 3, 4};
+  std::vector<uint8_t> binary = {'n', 'a', 't', 'i', 'v', 'e'};
+  auto getKey = [&](const std::vector<uint8_t> &spirv, const char *flags,
+                    const std::string &device, const std::string &specs) {
+    return imex::KernelBinaryCache::getKey(spirv.data(), spirv.size(), flags,
+                                           device, specs);
+  };
+  auto key = getKey(spirv, "-O2", "gpu:1.2", "");
+  printf("key: %s\n", key.c_str());
+  printf("same inputs: %s\n",
+         getKey(spirv, "-O2", "gpu:1.2", "") == key ? "same key" : "new key");
+
+  auto lookup = [&](const char *what, const std::string &key) {
+    std::vector<uint8_t> loaded;
+    bool hit = cache.load(key, loaded);
+    printf("%s: %s\n", what,
+           !hit ? "miss" : (loaded == binary ? "hit" : "wrong binary"));
+  };
+  lookup("empty cache", key);
+  cache.store(key, binary);
+  lookup("stored", key);
+
+  // Every component of the key selects another entry.
+  auto changedSpirv = spirv;
+  changedSpirv.back() ^= 1;
+  lookup("other spirv", getKey(changedSpirv, "-O2", "gpu:1.2", ""));
+  lookup("other flags", getKey(spirv, "-O0", "gpu:1.2", ""));
+  lookup("other device", getKey(spirv, "-O2", "gpu:1.3", ""));
+  lookup("other spec constants", getKey(spirv, "-O2", "gpu:1.2", "0=4"));
+
+  auto path = std::filesystem::path(dir) / (key + ".bin");
+  std::ifstream file(path, std::ios::binary);
+  std::vector<uint8_t> entry(std::istreambuf_iterator<char>(file),
+                             (std::istreambuf_iterator<char>()));
+  printf("entry: %zu bytes\n", entry.size());
+  auto overwrite = [&](const std::vector<uint8_t> &contents) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc)
+        .write(reinterpret_cast<const char *>(contents.data()),
+               contents.size());
+  };
+
+  // A damaged entry is a miss.
+  overwrite(std::vector<uint8_t>(entry.begin(), entry.end() - 2));
+  lookup("truncated", key);
+  auto corrupt = entry;
+  corrupt.back() ^= 0xff;
+  overwrite(corrupt);
+  lookup("corrupt", key);
+  overwrite(binary);
+  lookup("no header", key);
+  overwrite({});
+  lookup("empty file", key);
+
+  // Storing again repairs the entry, removing it is a miss.
+  cache.store(key, binary);
+  lookup("stored again", key);
+  cache.remove(key);
+  lookup("removed", key);
+  return 0;
+}
+
+// Expects IMEX_TRACE_FILE to be set. Records nested host scopes and a device
+// command timed with the host clock, writes the trace and checks that the
+// written intervals nest.
+int checkTrace() {
+  auto &recorder = imex::TraceRecorder::get();
+  if (!recorder.isEnabled()) {
+    fprintf(stderr, "IMEX_TRACE_FILE is not set\n");
+    return 1;
+  }
+  printf("host timer: %s\n", recorder.useHostTimer() ? "on" : "off");
+
+  auto sleep = [] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  };
+  uint32_t track = recorder.createDeviceTrack();
+  {
+    imex::TraceScope outer("module", "module \"load\"");
+    outer.setArgs("\"bytes\":64");
+    sleep();
+    {
+      imex::TraceScope inner("alloc", "alloc device");
+      sleep();
+    }
+    {
+      imex::TraceScope inner("free", "free");
+      sleep();
+    }
+    // A device command timed from its submission until the host waited for
+    // it, as the runtimes do with the host timer.
+    uint64_t submitTime = imex::TraceRecorder::now();
+    sleep();
+    imex::TraceEvent kernel;
+    kernel.category = "kernel";
+    kernel.name = "kernel";
+    kernel.deviceTrack = track;
+    recorder.recordSince(std::move(kernel), submitTime);
+  }
+  recorder.dump();
+
+  // Reads back the category, track and interval of every complete event.
+  std::ifstream file(std::getenv("IMEX_TRACE_FILE"));
+  std::map<std::string, std::pair<double, double>> intervals;
+  std::string line;
+  while (std::getline(file, line)) {
+    auto field = [&](const char *key) {
+      auto pos = line.find(key);
+      return pos == std::string::npos ? std::string()
+                                      : line.substr(pos + strlen(key));
+    };
+    if (field("\"ph\":\"X\"").empty())
+      continue;
+    auto category = field("\"cat\":\"");
+    category = category.substr(0, category.find('"'));
+    double ts = std::stod(field("\"ts\":"));
+    double dur = std::stod(field("\"dur\":"));
+    printf("%s: pid %s, tid %s\n", category.c_str(),
+           field("\"pid\":").substr(0, 1).c_str(),
+           field("\"tid\":").substr(0, 1).c_str());
+    intervals[category] = {ts, ts + dur};
+  }
+  auto contains = [&](const char *parent, const char *child) {
+    auto &p = intervals[parent];
+    auto &c = intervals[child];
+    printf("%s in %s: %s\n", child, parent,
+           p.first <= c.first && c.second <= p.second ? "yes" : "no");
+  };
+  contains("module", "alloc");
+  contains("module", "free");
+  contains("module", "kernel");
+  printf("alloc before free: %s\n",
+         intervals["alloc"].second <= intervals["free"].first ? "yes" : "no");
+  return 0;
+}
+
+struct Command {
+  const char *name;
+  int (*run)();
+};
+
+const Command commands[] = {
+    {"allocator", checkAllocator},
+    {"binary-cache", checkBinaryCache},
+    {"trace", checkTrace},
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc == 2) {
+    for (auto &command : commands)
+      if (!strcmp(argv[1], command.name))
+        return command.run();
+  }
+  fprintf(stderr, "usage: %s <command>\ncommands:", argv[0]);
+  for (auto &command : commands)
+    fprintf(stderr, " %s", command.name);
+  fprintf(stderr, "\n");
+  return 1;
+}